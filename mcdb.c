@@ -58,12 +58,27 @@
 #include <limits.h>
 #include <string.h>
 
+#if defined(__linux__) && defined(_THREAD_SAFE)
+#define MCDB_MMAP_WATCH 1
+#include <sys/inotify.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>                  /* snprintf() */
+#endif
+
 #ifdef _THREAD_SAFE
 #include "plasma/plasma_spin.h" /* plasma_spin_lock_t, plasma_spin_lock_*() */
 static plasma_spin_lock_t mcdb_global_spinlock = PLASMA_SPIN_LOCK_INITIALIZER;
 #else
-#define plasma_spin_lock_acquire(spin) (void)0
-#define plasma_spin_lock_release(spin) (void)0
+typedef int plasma_spin_lock_t;
+#define PLASMA_SPIN_LOCK_INITIALIZER 0
+#define plasma_spin_lock_acquire(spin) ((void)(spin))
+#define plasma_spin_lock_release(spin) ((void)(spin))
+static plasma_spin_lock_t mcdb_global_spinlock = PLASMA_SPIN_LOCK_INITIALIZER;
+#endif
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
 #endif
 
 #ifndef O_CLOEXEC /* O_CLOEXEC available since Linux 2.6.23 */
@@ -83,35 +98,80 @@ extern int madvise(caddr_t, size_t, int);
 
 /* Note: tagc of 0 ('\0') is reserved to indicate no tag */
 
-bool
-mcdb_findtagstart(struct mcdb * const restrict m,
-                  const char * const restrict key, const size_t klen,
-                  const unsigned char tagc)
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static inline uint32_t
+mcdb_khash(const struct mcdb_mmap * const restrict map,
+           const char * const restrict key, const size_t klen,
+           const unsigned char tagc);
+
+static inline uint32_t
+mcdb_khash(const struct mcdb_mmap * const restrict map,
+           const char * const restrict key, const size_t klen,
+           const unsigned char tagc)
 {
-    const unsigned char * restrict ptr;
-    uint32_t khash;
-    if (m->map->hash_fn == uint32_hash_djb) {
+    if (map->hash_fn == uint32_hash_djb) {
         const uint32_t khash_init = /*init hash value; hash tagc if tagc not 0*/
           (tagc != 0)
-            ? uint32_hash_djb_uchar(UINT32_HASH_DJB_INIT, tagc)
-            : UINT32_HASH_DJB_INIT;
-        khash = uint32_hash_djb(khash_init, key, klen);
+            ? uint32_hash_djb_uchar(map->hash_init, tagc)
+            : map->hash_init;
+        return uint32_hash_djb(khash_init, key, klen);
+    }
+    else if (map->hash_fn == uint32_hash_xxh32_key) {
+        /* (not incremental; tagc folded into init as in xxh32_key(tagc+key))*/
+        return (tagc != 0)
+          ? uint32_hash_xxh32(uint32_hash_djb_uchar(map->hash_init, tagc),
+                              key, klen)
+          : uint32_hash_xxh32_key(map->hash_init, key, klen);
     }
     else {
         const uint32_t khash_init = /*init hash value; hash tagc if tagc not 0*/
           (tagc != 0)
-            ? m->map->hash_fn(m->map->hash_init, (const char *)&tagc, 1u)
-            : m->map->hash_init;
-        khash = m->map->hash_fn(khash_init, key, klen);
+            ? map->hash_fn(map->hash_init, (const char *)&tagc, 1u)
+            : map->hash_init;
+        return map->hash_fn(khash_init, key, klen);
     }
+}
 
-    /* (hash function should not change on refresh,
-     *  else move mcdb_thread_refresh_self() before khash calculation)*/
-    (void) mcdb_thread_refresh_self(m);
-    /* (ignore rc; continue with previous map in case of failure) */
+/* test negative lookup filter (blocked Bloom filter) (see mcdb.h)
+ * (returns false if key definitely not in mcdb; true if key might be in mcdb)*/
+__attribute_nonnull__()
+__attribute_pure__
+static inline bool
+mcdb_filter_test(const struct mcdb_mmap * const restrict map, uint32_t h);
 
+static inline bool
+mcdb_filter_test(const struct mcdb_mmap * const restrict map, uint32_t h)
+{
+    const unsigned char * restrict blk;
+    uint32_t k = map->filter_k;
+    uint32_t a;
+    uint32_t b;
+    mcdb_filter_remix(h);
+    blk = map->filter
+        + (uintptr_t)mcdb_filter_block(h, map->filter_n) * MCDB_FILTER_BLOCK_SZ;
+    h += 0x9E3779B9u;
+    mcdb_filter_remix(h);
+    a = h >> 23;
+    b = (h >> 14) | 1u;
+    do {
+        if (!(blk[(a & 511u) >> 3] & (1u << (a & 7u))))
+            return false;
+        a += b;
+    } while (--k);
+    return true;
+}
+
+__attribute_nonnull__()
+static inline bool
+mcdb_findtagstart_khash(struct mcdb * const restrict m, const uint32_t khash);
+
+static inline bool
+mcdb_findtagstart_khash(struct mcdb * const restrict m, const uint32_t khash)
+{
     /* (size of data in lvl1 hash table element is 16-bytes (shift 4 bits)) */
-    ptr = m->map->ptr + ((khash & MCDB_SLOT_MASK) << 4);
+    const unsigned char * restrict ptr =
+      m->map->ptr + ((khash & MCDB_SLOT_MASK) << 4);
     m->hpos  = uint64_strunpack_bigendian_aligned_macro(ptr);
     m->hslots= uint32_strunpack_bigendian_aligned_macro(ptr+8);
     m->loop  = 0;
@@ -120,13 +180,273 @@ mcdb_findtagstart(struct mcdb * const restrict m,
     /* (size of data in lvl2 hash table element is 16-bytes (shift 4 bits)) */
     m->kpos  = m->hpos
              +(((uintptr_t)((khash>>MCDB_SLOT_BITS) % m->hslots)) << m->map->b);
-    ptr = m->map->ptr + m->kpos;             /*prefetch for mcdb_findtagnext()*/
+    ptr = m->map->hptr + m->kpos;            /*prefetch for mcdb_findtagnext()*/
     __builtin_prefetch(ptr,0,PLASMA_ATTR_MM_HINT_T1);
     __builtin_prefetch(ptr+64,0,PLASMA_ATTR_MM_HINT_T1);
+    /* (filter tested after prefetch so that, for keys present, load of filter
+     *  block overlaps load of hash table entries) */
+    if (m->map->filter != NULL && !mcdb_filter_test(m->map, khash)) {
+        m->hslots= 0; /*(mcdb_findtagnext() returns false if called anyway)*/
+        return false;
+    }
+    uint32_strpack_bigendian_aligned_macro(&m->khash, khash);/*store bigendian*/
+    return true;
+}
+
+/* locate single mph index entry for key (see mcdb.h)
+ * (entry is presented to mcdb_findtagnext() as a slot with hslots == 1) */
+__attribute_nonnull__()
+static inline bool
+mcdb_findtagstart_mph(struct mcdb * const restrict m,
+                      const char * const restrict key, const size_t klen,
+                      const unsigned char tagc);
+
+static inline bool
+mcdb_findtagstart_mph(struct mcdb * const restrict m,
+                      const char * const restrict key, const size_t klen,
+                      const unsigned char tagc)
+{
+    const struct mcdb_mmap * const restrict map = m->map;
+    const uint32_t khash = mcdb_khash(map, key, klen, tagc);
+    const uint32_t hinit = MCDB_MPH_HASH_HI(map->hash_init);
+    const uint32_t hi = (tagc != 0)
+      ? uint32_hash_xxh32(uint32_hash_djb_uchar(hinit, tagc), key, klen)
+      : uint32_hash_xxh32_key(hinit, key, klen);
+    const unsigned char * restrict ptr;
+    uint64_t x;
+    uint32_t p;
+    m->loop  = 0;
+    m->hslots= 0;
+    if (__builtin_expect((map->mph_n == 0), 0))
+        return false;
+    if (map->filter != NULL && !mcdb_filter_test(map, khash))
+        return false;
+    ptr = map->mph + ((uintptr_t)mcdb_mph_bucket(hi,khash,map->mph_nb) << 1);
+    x = ((uint64_t)map->mph_seed << 32) | (((uint32_t)ptr[0] << 8) | ptr[1]);
+    mcdb_mph_fmix64(x);
+    x ^= ((uint64_t)hi << 32) | khash;
+    mcdb_mph_fmix64(x);
+    p = mcdb_mph_pos(x, map->mph_m);
+    if (p >= map->mph_n)
+        p = uint32_strunpack_bigendian_aligned_macro(
+              map->mph_remap + ((uintptr_t)(p - map->mph_n) << 2));
+    m->hpos  = m->kpos = (uintptr_t)(map->mph_ent - map->hptr)
+                       + ((uintptr_t)p << map->b);
+    m->hslots= 1;
+    __builtin_prefetch(map->hptr+m->kpos,0,PLASMA_ATTR_MM_HINT_T1);
     uint32_strpack_bigendian_aligned_macro(&m->khash, khash);/*store bigendian*/
     return true;
 }
 
+bool
+mcdb_findtagstart(struct mcdb * const restrict m,
+                  const char * const restrict key, const size_t klen,
+                  const unsigned char tagc)
+{
+    /* (refresh before khash calculation; hash function recorded in mcdb
+     *  header might differ between previous map and updated map) */
+    (void) mcdb_thread_refresh_self(m);
+    /* (ignore rc; continue with previous map in case of failure) */
+
+    return (m->map->mph == NULL)
+      ? mcdb_findtagstart_khash(m, mcdb_khash(m->map, key, klen, tagc))
+      : mcdb_findtagstart_mph(m, key, klen, tagc);
+}
+
+/* SIMD scan of open hash table entries in slot
+ *
+ * mcdb_probe_b3() and mcdb_probe_b4() scan up to n contiguous hash table
+ * entries (8-byte entries if b == 3; 16-byte entries if b == 4) and return
+ * number of leading entries which can be skipped: entries that are not empty
+ * (dpos != 0) and whose khash does not match (khash is passed bigendian,
+ * as stored).  Scanning only full vectors; caller handles entry at returned
+ * index (if less than n) with scalar code, whether or not it is candidate.
+ * Function pointers are selected at runtime in mcdb_mmap_init() and are NULL
+ * (scalar code only) if no SIMD kernel is available for the CPU.
+ * First entry probed is handled by scalar code since most lookups resolve on
+ * first entry; SIMD scan is used on longer probe sequences (collisions, misses)
+ * No change to on-disk format; hash tables are as written by mcdb_make_finish()
+ * Compile with -DMCDB_NO_SIMD to disable. */
+
+#if !defined(MCDB_NO_SIMD) \
+ && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))) \
+ && (defined(__clang__) \
+     || (defined(__GNUC__) \
+         && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define MCDB_PROBE_SIMD_X86
+#include <immintrin.h>
+#elif !defined(MCDB_NO_SIMD) && defined(__ARM_NEON) && defined(__GNUC__)
+#define MCDB_PROBE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(MCDB_PROBE_SIMD_X86) || defined(MCDB_PROBE_SIMD_NEON)
+
+static uint32_t (*mcdb_probe_b3)(const unsigned char * restrict,
+                                 uint32_t, uint32_t);
+static uint32_t (*mcdb_probe_b4)(const unsigned char * restrict,
+                                 uint32_t, uint32_t);
+
+#ifdef MCDB_PROBE_SIMD_X86
+
+/* SSE2: 2 entries (b == 3) per 16 bytes
+ * (32-bit lanes: khash, dpos, khash, dpos) */
+__attribute_nonnull__()
+static uint32_t
+mcdb_probe_b3_sse2(const unsigned char * const restrict ptr,
+                   const uint32_t khash, const uint32_t n)
+{
+    const __m128i kh = _mm_set1_epi32((int)khash);
+    const __m128i z  = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(ptr + (i << 3)));
+        const uint32_t c = (uint32_t)
+          (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, kh)))
+           | (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, z))) >> 1))
+          & 0x5u;
+        if (c)
+            return i + ((c & 1u) ? 0 : 1);
+    }
+    return i;
+}
+
+/* AVX2: 4 entries (b == 3) per 32 bytes */
+__attribute__((target("avx2")))
+__attribute_nonnull__()
+static uint32_t
+mcdb_probe_b3_avx2(const unsigned char * const restrict ptr,
+                   const uint32_t khash, const uint32_t n)
+{
+    const __m256i kh = _mm256_set1_epi32((int)khash);
+    const __m256i z  = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i v =
+          _mm256_loadu_si256((const __m256i *)(ptr + (i << 3)));
+        const uint32_t c = (uint32_t)
+          (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, kh)))
+           |(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v,z)))
+             >> 1))
+          & 0x55u;
+        if (c)
+            return i + ((uint32_t)__builtin_ctz(c) >> 1);
+    }
+    return i;
+}
+
+/* AVX2: 2 entries (b == 4) per 32 bytes
+ * (32-bit lanes: khash, klen, dpos hi, dpos lo, khash, klen, dpos hi, dpos lo)
+ * (empty entry is 64-bit dpos == 0) */
+__attribute__((target("avx2")))
+__attribute_nonnull__()
+static uint32_t
+mcdb_probe_b4_avx2(const unsigned char * const restrict ptr,
+                   const uint32_t khash, const uint32_t n)
+{
+    const __m256i kh = _mm256_set1_epi32((int)khash);
+    const __m256i z  = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m256i v =
+          _mm256_loadu_si256((const __m256i *)(ptr + (i << 4)));
+        const uint32_t e = (uint32_t)
+          _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, kh)));
+        const uint32_t d = (uint32_t)
+          _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, z)));
+        const uint32_t c = (e & 0x1u) | ((d & 0x2u) >> 1)   /* entry 0 */
+                         | ((e & 0x10u) >> 3) | ((d & 0x8u) >> 2);/*entry 1*/
+        if (c)
+            return i + ((c & 1u) ? 0 : 1);
+    }
+    return i;
+}
+
+#endif /* MCDB_PROBE_SIMD_X86 */
+
+#ifdef MCDB_PROBE_SIMD_NEON
+
+/* NEON: 2 entries (b == 3) per 16 bytes */
+__attribute_nonnull__()
+static uint32_t
+mcdb_probe_b3_neon(const unsigned char * const restrict ptr,
+                   const uint32_t khash, const uint32_t n)
+{
+    const uint32x4_t kh = vdupq_n_u32(khash);
+    const uint32x4_t z  = vdupq_n_u32(0);
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const uint32x4_t v = vld1q_u32((const uint32_t *)(ptr + (i << 3)));
+        /* (vrev64q_u32 moves dpos == 0 lane onto khash lane of entry) */
+        const uint32x4_t c = vorrq_u32(vceqq_u32(v, kh),
+                                       vrev64q_u32(vceqq_u32(v, z)));
+        if (vgetq_lane_u32(c, 0))
+            return i;
+        if (vgetq_lane_u32(c, 2))
+            return i + 1;
+    }
+    return i;
+}
+
+#endif /* MCDB_PROBE_SIMD_NEON */
+
+/* select SIMD kernels for CPU (idempotent; benign if called concurrently) */
+static void
+mcdb_probe_simd_init(void)
+{
+  #ifdef MCDB_PROBE_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        mcdb_probe_b3 = mcdb_probe_b3_avx2;
+        mcdb_probe_b4 = mcdb_probe_b4_avx2;
+    }
+    else
+        mcdb_probe_b3 = mcdb_probe_b3_sse2;
+  #endif
+  #ifdef MCDB_PROBE_SIMD_NEON
+    mcdb_probe_b3 = mcdb_probe_b3_neon;
+  #endif
+}
+
+/* skip (in bulk) entries which neither match khash nor are empty
+ * (entries skipped are counted in m->loop, same as scalar probe loop) */
+#define mcdb_probe_skip(probe, m, hslots_end, bits)                            \
+  do {                                                                         \
+    uint32_t n_ = (uint32_t)(((hslots_end) - (m)->kpos) >> (bits));            \
+    if (n_ > (m)->hslots - (m)->loop)                                          \
+        n_ = (m)->hslots - (m)->loop;                                          \
+    n_ = (probe)(hptr + (m)->kpos, (m)->khash, n_);                            \
+    (m)->loop += n_;                                                           \
+    (m)->kpos += ((uintptr_t)n_ << (bits));                                    \
+    if (__builtin_expect(((m)->kpos == (hslots_end)), 0))                      \
+        (m)->kpos = (m)->hpos;                                                 \
+  } while (0)
+
+#else
+
+#define mcdb_probe_b3 NULL
+#define mcdb_probe_b4 NULL
+#define mcdb_probe_simd_init() (void)0
+#define mcdb_probe_skip(probe, m, hslots_end, bits) (void)0
+
+#endif
+
+/* key found; alias record resolves to data aliased (see mcdb.h) */
+__attribute_nonnull__()
+static inline bool
+mcdb_findtag_found(struct mcdb * const restrict m);
+
+static inline bool
+mcdb_findtag_found(struct mcdb * const restrict m)
+{
+    m->rpos = m->dpos;
+    if (__builtin_expect((m->dlen & MCDB_DLEN_ALIAS), 0)) {
+        m->dpos -= (uintptr_t)mcdb_alias_dist(m->map->ptr + m->dpos);
+        m->dlen &= ~MCDB_DLEN_ALIAS;
+    }
+    return true;
+}
+
 bool
 mcdb_findtagnext(struct mcdb * const restrict m,
                  const char * const restrict key, const size_t klen,
@@ -134,13 +454,19 @@ mcdb_findtagnext(struct mcdb * const restrict m,
 {
     const unsigned char * ptr;
     const unsigned char * const restrict mptr = m->map->ptr;
+    const unsigned char * const restrict hptr = m->map->hptr;
     const uintptr_t hslots_end= m->hpos + (((uintptr_t)m->hslots) << m->map->b);
     uintptr_t vpos;
     uint32_t khash;
 
     if (m->map->b == 3) {
         while (m->loop < m->hslots) {
-            ptr = mptr + m->kpos;
+            if (mcdb_probe_b3 != NULL && m->loop != 0) {
+                mcdb_probe_skip(mcdb_probe_b3, m, hslots_end, 3);
+                if (m->loop == m->hslots)
+                    break;
+            }
+            ptr = hptr + m->kpos;
             m->kpos += 8;
             if (__builtin_expect((m->kpos == hslots_end), 0))
                 m->kpos = m->hpos;
@@ -156,13 +482,18 @@ mcdb_findtagnext(struct mcdb * const restrict m,
                 m->dpos = vpos + 8 + m->klen;
                 if (m->klen == klen+(tagc!=0)
                     && (tagc == 0 || tagc == *ptr++) && memcmp(key,ptr,klen)==0)
-                    return true;
+                    return mcdb_findtag_found(m);
             }
         }
     }
     else {
         while (m->loop < m->hslots) {
-            ptr = mptr + m->kpos;
+            if (mcdb_probe_b4 != NULL && m->loop != 0) {
+                mcdb_probe_skip(mcdb_probe_b4, m, hslots_end, 4);
+                if (m->loop == m->hslots)
+                    break;
+            }
+            ptr = hptr + m->kpos;
             m->kpos += 16;
             if (__builtin_expect((m->kpos == hslots_end), 0))
                 m->kpos = m->hpos;
@@ -177,13 +508,88 @@ mcdb_findtagnext(struct mcdb * const restrict m,
                 ptr = mptr + vpos + 8;
                 m->dlen = uint32_strunpack_bigendian_macro(ptr-4);
                 if ((tagc == 0 || tagc == *ptr++) && memcmp(key,ptr,klen) == 0)
-                    return true;
+                    return mcdb_findtag_found(m);
             }
         }
     }
     return (m->loop = false);
 }
 
+/* prefetch data record of first entry probed in slot hash table if khash
+ * matches (entry itself was prefetched by mcdb_findtagstart_khash()) */
+__attribute_nonnull__()
+static inline void
+mcdb_findtag_prefetch_rec(const struct mcdb * const restrict m);
+
+static inline void
+mcdb_findtag_prefetch_rec(const struct mcdb * const restrict m)
+{
+    const unsigned char * const restrict ptr = m->map->hptr + m->kpos;
+    const uintptr_t vpos = (m->map->b == 3)
+      ? uint32_strunpack_bigendian_aligned_macro(ptr+4)
+      : uint64_strunpack_bigendian_aligned_macro(ptr+8);
+    if (*(uint32_t *)ptr == m->khash && vpos) /* m->khash stored bigendian */
+        __builtin_prefetch(m->map->ptr+vpos,0,PLASMA_ATTR_MM_HINT_T0);
+}
+
+/* look up batch of keys, overlapping memory latency of lookups for many keys
+ * (stage 1: hash keys and prefetch hash table entries in slots,
+ *  stage 2: load hash table entries and prefetch data records,
+ *  stage 3: resolve keys (as with mcdb_findtagnext()) while data is in cache)
+ * Each q[i].key and q[i].klen must be set by caller.  For each key found,
+ * q[i].dpos and q[i].dlen are set to first data found for key; else set to 0.
+ * Returns number of keys found.  Positions in results are valid for m->map
+ * upon return (mcdb_thread_refresh_self() is called once per batch) */
+size_t
+mcdb_findtagbatch(struct mcdb * const restrict m,
+                  struct mcdb_batch * const restrict q, const size_t n,
+                  const unsigned char tagc)
+{
+    struct mcdb mq[MCDB_BATCH_WINDOW];
+    struct mcdb_batch * restrict b;
+    size_t found = 0;
+    size_t i;
+    uint32_t j;
+    uint32_t w;
+
+    (void) mcdb_thread_refresh_self(m);
+    /* (ignore rc; continue with previous map in case of failure) */
+
+    for (i = 0; i < n; i += w) {
+        b = q + i;
+        w = (n - i < MCDB_BATCH_WINDOW) ? (uint32_t)(n - i) : MCDB_BATCH_WINDOW;
+
+        for (j = 0; j < w; ++j) {
+            mq[j].map = m->map;
+            if (m->map->mph == NULL)
+                (void)mcdb_findtagstart_khash(mq+j,
+                                mcdb_khash(m->map, b[j].key, b[j].klen, tagc));
+            else
+                (void)mcdb_findtagstart_mph(mq+j, b[j].key, b[j].klen, tagc);
+        }
+
+        for (j = 0; j < w; ++j) {
+            if (mq[j].hslots)
+                mcdb_findtag_prefetch_rec(mq+j);
+        }
+
+        for (j = 0; j < w; ++j) {
+            if (mq[j].hslots
+                && mcdb_findtagnext(mq+j, b[j].key, b[j].klen, tagc)) {
+                b[j].dpos = mq[j].dpos;
+                b[j].dlen = mq[j].dlen;
+                ++found;
+            }
+            else {
+                b[j].dpos = 0;
+                b[j].dlen = 0;
+            }
+        }
+    }
+
+    return found;
+}
+
 /* read value from mmap const db into buffer and return pointer to buffer
  * (return NULL if position (offset) or length to read will be out-of-bounds)
  * Note: caller must terminate with '\0' if desired, i.e. buf[len] = '\0';
@@ -234,7 +640,8 @@ mcdb_validate_slots(struct mcdb * const restrict m)
         else
             return false;
     } while ((u += 16) < MCDB_HEADER_SZ);
-    m->map->n = numrecs >> 1;  /* (hslots / 2) */
+    if (m->map->mph == NULL)   /* (mph index: n from header (see mcdb.h)) */
+        m->map->n = numrecs >> 1;  /* (hslots / 2) */
     return (hpos_next == m->map->size);
 }
 
@@ -244,11 +651,20 @@ mcdb_iter(struct mcdb_iter * const restrict iter)
     if (iter->ptr < iter->eod) {
         iter->klen = uint32_strunpack_bigendian_macro(iter->ptr);
         iter->dlen = uint32_strunpack_bigendian_macro(iter->ptr+4);
-        iter->ptr += 8 + iter->klen + iter->dlen;
         if (iter->klen != ~0) {  /* (klen == ~0 padding at end of data) */
             /* klen <= INT_MAX-8 (see mcdb_make.c), so no need to also check
              *   (iter->ptr >= iter->eod-(MCDB_PAD_MASK-7))
-             * (using original iter->ptr value before update above) */
+             * (using original iter->ptr value before update below) */
+            iter->kptr = iter->ptr + 8;
+            iter->dptr = iter->kptr + iter->klen;
+            if (__builtin_expect((iter->dlen & MCDB_DLEN_ALIAS), 0)) {
+                /* alias record (see mcdb.h) */
+                iter->ptr   = iter->dptr + 8;
+                iter->dptr -= (uintptr_t)mcdb_alias_dist(iter->dptr);
+                iter->dlen &= ~MCDB_DLEN_ALIAS;
+            }
+            else
+                iter->ptr = iter->dptr + iter->dlen;
             __builtin_prefetch(iter->ptr, 0, PLASMA_ATTR_MM_HINT_T0);
             return true;
         }
@@ -275,6 +691,8 @@ mcdb_iter_init(struct mcdb_iter * const restrict iter,
     iter->klen = 0;                     /*(non-faulting prefetch ld if 0 recs)*/
     iter->dlen = 0;
     iter->map  = m->map;
+    iter->kptr = iter->ptr;
+    iter->dptr = iter->ptr;
     /* Note: callers that intend to iterate through entire mcdb might call
      * posix_madvise(iter->map, (size_t)(iter->eod - iter->map),
      *               POSIX_MADV_SEQUENTIAL);
@@ -282,6 +700,37 @@ mcdb_iter_init(struct mcdb_iter * const restrict iter,
      */
 }
 
+bool
+mcdb_iter_init_range(struct mcdb_iter * const restrict iter,
+                     struct mcdb * const restrict m,
+                     const uint32_t part, const uint32_t nparts)
+{
+    const struct mcdb_mmap * const restrict map = m->map;
+    uint64_t b, e;
+    uint32_t i;
+    if (part >= nparts)
+        return (errno = EINVAL, false);
+    mcdb_iter_init(iter, m);
+    if (map->sparse_n == 0) {   /*(no sparse index; part 0 is entire data)*/
+        if (part != 0)
+            iter->ptr = iter->eod;
+        return true;
+    }
+    /* (sparse index entries map to parts; entries are never past eod+7) */
+    i = (uint32_t)(((uint64_t)part * map->sparse_n) / nparts);
+    b = uint64_strunpack_bigendian_aligned_macro(map->sparse+((uintptr_t)i<<3));
+    i = (uint32_t)(((uint64_t)(part+1) * map->sparse_n) / nparts);
+    e = (part+1 == nparts)
+      ? (uint64_t)(iter->eod - map->ptr)
+      : uint64_strunpack_bigendian_aligned_macro(map->sparse+((uintptr_t)i<<3));
+    if (b < MCDB_HEADER_SZ || b > e || e > (uint64_t)(iter->eod - map->ptr) + 7)
+        return (errno = EINVAL, false); /*(invalid sparse index)*/
+    iter->ptr = map->ptr + (uintptr_t)b;
+    iter->eod = map->ptr + (uintptr_t)e;
+    __builtin_prefetch(iter->ptr,0,PLASMA_ATTR_MM_HINT_T0);
+    return true;
+}
+
 
 /* Note: __attribute_noinline__ is used to mark less frequent code paths
  * to prevent inlining of seldoms used paths, hopefully improving instruction
@@ -298,12 +747,194 @@ inline
 static void
 mcdb_mmap_unmap(struct mcdb_mmap * const restrict map)
 {
+    if (map->hcopy)
+        munmap(map->hcopy, map->hcopy_sz);
+    map->hcopy = NULL;
+    map->hcopy_sz = 0;
     if (map->ptr)
         munmap(map->ptr, map->size);
     map->ptr  = NULL;
     map->size = 0;    /* map->size initialization required for mcdb_read() */
 }
 
+/* parse mcdb header extension words (see mcdb.h)
+ * select hash function recorded in mcdb header; locate optional filter
+ * (legacy mcdb (version 0) and MCDB_HASH_CUSTOM default to djb hash;
+ *  application using MCDB_HASH_CUSTOM must set map->hash_fn after init) */
+bool
+mcdb_mmap_hdr(struct mcdb_mmap * const restrict map)
+{
+    const unsigned char * const restrict ptr = map->ptr;
+    uint64_t fpos;
+    uint32_t u;
+    map->hash_id   = MCDB_HASH_DJB;
+    map->hash_init = UINT32_HASH_DJB_INIT;
+    map->hash_fn   = uint32_hash_djb;
+    map->filter    = NULL;
+    map->filter_n  = 0;
+    map->filter_k  = 0;
+    map->mph       = NULL;
+    map->sparse    = NULL;
+    map->sparse_n  = 0;
+    map->sparse_sz = 0;
+    if (map->size < MCDB_HEADER_SZ
+        || uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_VERSION) == 0)
+        return true; /*(legacy mcdb; header extension words all 0)*/
+    if (uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_FEATURES)
+        & ~MCDB_FEATURES_SUPPORTED)
+        return (errno = ENOTSUP, false); /*(mcdb requires unsupported feature)*/
+    map->hash_id   =
+      uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_HASH_ID);
+    map->hash_init =
+      uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_HASH_INIT);
+    switch (map->hash_id) {
+      case MCDB_HASH_DJB:      map->hash_fn = uint32_hash_djb;       break;
+      case MCDB_HASH_IDENTITY: map->hash_fn = uint32_hash_identity;  break;
+      case MCDB_HASH_XXH32:    map->hash_fn = uint32_hash_xxh32_key; break;
+      case MCDB_HASH_CUSTOM:   map->hash_fn = uint32_hash_djb;       break;
+      default: return (errno = ENOTSUP, false); /*(unknown hash function)*/
+    }
+
+    /* optional filter; ignored if unknown type or out-of-bounds
+     * (filter must end at or before beginning of hash tables) */
+    u = uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_FILTER);
+    fpos = ((uint64_t)
+            uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_FILTER_POSH)
+            << 32)
+         | uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_FILTER_POSL);
+    map->filter_n =
+      uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_FILTER_N);
+    if ((u >> 8) == MCDB_FILTER_BLOCKED_BLOOM
+        && (u & 0xFFu) - 1u < 16u  /*(1 <= k <= 16)*/
+        && map->filter_n != 0
+        && fpos >= MCDB_HEADER_SZ && (fpos & (MCDB_FILTER_BLOCK_SZ-1)) == 0
+        && fpos + (uint64_t)map->filter_n * MCDB_FILTER_BLOCK_SZ
+           <= uint64_strunpack_bigendian_aligned_macro(ptr)
+        && uint64_strunpack_bigendian_aligned_macro(ptr) <= map->size) {
+        map->filter   = ptr + (uintptr_t)fpos;
+        map->filter_k = u & 0xFFu;
+    }
+    else
+        map->filter_n = 0;
+
+    /* optional sparse record offset index; ignored if out-of-bounds
+     * (entries are validated in mcdb_iter_init_range()) */
+    u = uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_SPARSE_N);
+    fpos = ((uint64_t)
+            uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_SPARSE_POSH)
+            << 32)
+         | uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_SPARSE_POSL);
+    if (u != 0
+        && uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_SPARSE_SZ) != 0
+        && fpos >= MCDB_HEADER_SZ && (fpos & 7u) == 0
+        && fpos + ((uint64_t)u << 3) <= map->size) {
+        map->sparse    = ptr + (uintptr_t)fpos;
+        map->sparse_n  = u;
+        map->sparse_sz =
+          uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_SPARSE_SZ);
+    }
+
+    /* mph index (required if MCDB_FEATURE_MPH) (see mcdb.h) */
+    if (uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_FEATURES)
+        & MCDB_FEATURE_MPH) {
+        const uint64_t end = uint64_strunpack_bigendian_aligned_macro(ptr);
+        uint64_t rpos, epos;
+        map->mph_n    =
+          uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_N);
+        map->mph_nb   =
+          uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_NB);
+        map->mph_m    =
+          uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_M);
+        map->mph_seed =
+          uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_SEED);
+        u = uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_BITS);
+        fpos = ((uint64_t)
+                uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_POSH)
+                << 32)
+             | uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_POSL);
+        rpos = fpos + ((((uint64_t)map->mph_nb << 1) + 15u) & ~(uint64_t)15u);
+        epos = rpos + ((((uint64_t)(map->mph_m - map->mph_n) << 2) + 15u)
+                       & ~(uint64_t)15u);
+        if (map->hash_id != MCDB_HASH_XXH32
+            || (u != 3 && u != 4)
+            || map->mph_m < map->mph_n
+            || (map->mph_n != 0 && map->mph_nb == 0)
+            || fpos < MCDB_HEADER_SZ || (fpos & (MCDB_FILTER_BLOCK_SZ-1)) != 0
+            || epos + ((uint64_t)map->mph_n << u) > end
+            || end != map->size)
+            return (errno = EINVAL, false); /*(invalid mph index)*/
+        map->mph       = ptr + (uintptr_t)fpos;
+        map->mph_remap = ptr + (uintptr_t)rpos;
+        map->mph_ent   = ptr + (uintptr_t)epos;
+        map->b = u;
+        map->n =
+          uint32_strunpack_bigendian_aligned_macro(ptr+MCDB_HDR_MPH_NRECS);
+    }
+
+    return true;
+}
+
+/* copy index region (from start of filter, mph index, or hash tables to EOF)
+ * into anonymous memory backed by huge pages (see MCDB_MMAP_HUGEPAGE_INDEX)
+ * (map->hptr is set so that map->hptr + kpos addresses copy for kpos offsets
+ *  in mcdb file; map->filter and map->mph* are relocated into the copy)
+ * (index is left in file mmap if copy can not be allocated) */
+__attribute_noinline__
+__attribute_nonnull__()
+static void
+mcdb_mmap_hugepage_index(struct mcdb_mmap * const restrict map);
+
+static void
+mcdb_mmap_hugepage_index(struct mcdb_mmap * const restrict map)
+{
+  #ifdef MAP_ANONYMOUS
+    uintptr_t ipos =
+      (uintptr_t)uint64_strunpack_bigendian_aligned_macro(map->ptr);
+    uintptr_t len, sz, a;
+    unsigned char *x = MAP_FAILED;
+    if (map->filter != NULL && (uintptr_t)(map->filter - map->ptr) < ipos)
+        ipos = (uintptr_t)(map->filter - map->ptr);
+    if (map->mph != NULL && (uintptr_t)(map->mph - map->ptr) < ipos)
+        ipos = (uintptr_t)(map->mph - map->ptr);
+    if (ipos >= map->size)
+        return;
+    len = map->size - ipos;
+    sz  = (len + (MCDB_HUGEPAGE_SZ-1)) & ~(uintptr_t)(MCDB_HUGEPAGE_SZ-1);
+  #ifdef MAP_HUGETLB /*(fails unless huge pages reserved; vm.nr_hugepages)*/
+    x = mmap(0, sz, PROT_READ|PROT_WRITE,
+             MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+  #endif
+    if (x == MAP_FAILED) {
+        /* transparent huge pages; align copy to huge page boundary */
+        x = mmap(0, sz + MCDB_HUGEPAGE_SZ, PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (x == MAP_FAILED)
+            return;
+        a = ((uintptr_t)x + (MCDB_HUGEPAGE_SZ-1))
+          & ~(uintptr_t)(MCDB_HUGEPAGE_SZ-1);
+        if (a != (uintptr_t)x)
+            munmap(x, a - (uintptr_t)x);
+        munmap((unsigned char *)a + sz, MCDB_HUGEPAGE_SZ - (a - (uintptr_t)x));
+        x = (unsigned char *)a;
+      #ifdef MADV_HUGEPAGE
+        madvise(x, sz, MADV_HUGEPAGE);
+      #endif
+    }
+    memcpy(x, map->ptr + ipos, len);
+    mprotect(x, sz, PROT_READ);
+    map->hcopy    = x;
+    map->hcopy_sz = sz;
+    map->hptr     = (const unsigned char *)((uintptr_t)x - ipos);
+    if (map->filter != NULL)
+        map->filter    = map->hptr + (map->filter - map->ptr);
+    if (map->mph != NULL) {
+        map->mph       = map->hptr + (map->mph - map->ptr);
+        map->mph_remap = map->hptr + (map->mph_remap - map->ptr);
+        map->mph_ent   = map->hptr + (map->mph_ent - map->ptr);
+    }
+  #endif
+}
+
 __attribute_noinline__
 bool
 mcdb_mmap_init(struct mcdb_mmap * const restrict map, int fd)
@@ -336,11 +967,19 @@ mcdb_mmap_init(struct mcdb_mmap * const restrict map, int fd)
     map->size  = (uintptr_t)st.st_size;
     map->b     = st.st_size < UINT_MAX || *(uint32_t *)x == 0 ? 3u : 4u;
     map->n     = ~0;
+    map->hptr  = map->ptr;
     map->mtime = st.st_mtime;
     map->next  = NULL;
     map->refcnt= 0;
-    map->hash_init = UINT32_HASH_DJB_INIT;
-    map->hash_fn   = uint32_hash_djb;
+    if (!mcdb_mmap_hdr(map)) {
+        const int errnum = errno;
+        mcdb_mmap_unmap(map);
+        errno = errnum;
+        return false;
+    }
+    if (map->flags & MCDB_MMAP_HUGEPAGE_INDEX)
+        mcdb_mmap_hugepage_index(map);
+    mcdb_probe_simd_init();
     return true;
 }
 
@@ -379,6 +1018,248 @@ mcdb_mmap_prefault(const struct mcdb_mmap * const restrict map)
     posix_madvise(((char *)map->ptr), map->size, POSIX_MADV_WILLNEED);
 }
 
+/* per-map epoch reclamation
+ *
+ * Generations of a map (replaced by mcdb_mmap_reopen_threadsafe()) share an
+ * epoch domain (struct mcdb_mmap_epoch), allocated by mcdb_mmap_create().
+ * Domain lock protects reader slot allocation, map refcnt, and the list of
+ * maps pending release (ep->head (oldest) ... ep->newest, linked by 'next').
+ * Threads registered with mcdb_thread_epoch_register() each own a reader slot
+ * (own cache line) in which the thread stores the domain epoch at which it
+ * loaded its current map (m->map), or MCDB_EPOCH_QUIESCENT when unregistered.
+ * m->rd is used only after it is found among reader slots of domain with
+ * slot owner m (m->rd might be uninitialized in struct mcdb of callers which
+ * use mcdb_thread_register() (refcnt) and set only m.map).
+ * Query path (mcdb_thread_refresh_self()) only loads m->map->next.  When a new
+ * map has been published, reader stores the current epoch into its own slot,
+ * then loads ep->newest.  No lock and no shared write on query path.
+ * Replacing a map increments ep->epoch and records it in map->retire.  A
+ * replaced map is released (munmap) once no reader slot holds an epoch prior
+ * to map->retire and no mcdb_mmap_thread_registration() reference remains
+ * (refcnt == 0).  Reclamation is performed (under domain lock) by the thread
+ * which replaces a map, drops a refcnt, or advances/unregisters a reader on a
+ * replaced map.
+ * struct mcdb_mmap of released maps are kept on domain free list for reuse by
+ * next generation (and free'd with domain in mcdb_mmap_destroy()), so that a
+ * (stale) map pointer can still be used to find the domain lock.
+ * (file-scoped spinlock remains only for maps not created by mcdb_mmap_create,
+ *  e.g. mcdb_mmap_init() on caller struct, until a domain is created for map)
+ * (epoch is 32-bit and compared modulo 2^32; one increment per map replaced)
+ */
+
+#define MCDB_EPOCH_QUIESCENT (~0u)
+#define MCDB_EPOCH_SLOTS 63u         /* num reader slots per block */
+#define MCDB_EPOCH_LINE  64u         /* cache line size */
+
+struct mcdb_reader {
+  uint32_t epoch;                    /* epoch at which reader loaded m->map */
+  uint32_t inuse;                    /* slot allocated to reader */
+  const struct mcdb *owner;          /* struct mcdb to which slot allocated */
+  char pad[MCDB_EPOCH_LINE-8-sizeof(void *)];/*(separate cache line per rdr)*/
+};
+
+struct mcdb_reader_block {
+  union {
+    struct {
+      struct mcdb_reader_block *next;
+      void *mem;                     /* allocation (before alignment) */
+    } h;
+    char line[MCDB_EPOCH_LINE];
+  } u;
+  struct mcdb_reader rd[MCDB_EPOCH_SLOTS];
+};
+
+struct mcdb_mmap_epoch {
+  plasma_spin_lock_t lock;           /* domain lock */
+  uint32_t epoch;                    /* current epoch (incr per map replaced) */
+  struct mcdb_mmap *newest;          /* newest map (published) */
+  struct mcdb_mmap *head;            /* oldest map not yet released */
+  struct mcdb_mmap *free;            /* released maps (struct reuse) */
+  struct mcdb_reader_block *blocks;  /* reader slots */
+  struct mcdb_mmap_watch *watch;     /* inotify watcher (MCDB_MMAP_INOTIFY) */
+  void * (*fn_malloc)(size_t);       /* fn ptr to malloc() */
+  void (*fn_free)(void *);           /* fn ptr to free() */
+};
+
+/* inotify watcher (MCDB_MMAP_INOTIFY)
+ *
+ * Helper thread blocks in read() on inotify fd watching directory of mcdb and
+ * increments w->gen upon event naming mcdb file (create, rename into place,
+ * close after write, attribute (mtime) change, delete) or queue overflow.
+ * mcdb_mmap_reopen() records w->gen in map->wgen before opening mcdb, and
+ * mcdb_mmap_refresh_check() compares map->wgen with w->gen (single load; no
+ * syscall).  Event for another file in same directory does not change w->gen.
+ * If watch is lost (IN_IGNORED) or read() fails, w->live is cleared and
+ * mcdb_mmap_refresh_check() falls back to stat().
+ * Helper thread does not exist in child of fork(), where w->gen would never
+ * change; pthread_atfork() child handler increments mcdb_mmap_watch_forks, and
+ * watch is live only while w->forks matches, so child falls back to stat().
+ * (w->gen and w->live are written only by helper thread; readers tolerate a
+ *  stale value for the short time until the store becomes visible, as they
+ *  would tolerate a stat() issued just before the mcdb file was replaced) */
+struct mcdb_mmap_watch {
+  volatile uint32_t gen;             /* incremented upon change to mcdb file */
+  volatile uint32_t live;            /* watch active (else use stat()) */
+  uint32_t forks;                    /* mcdb_mmap_watch_forks at create */
+  int ifd;                           /* inotify fd */
+  int wd;                            /* inotify watch descriptor */
+ #ifdef MCDB_MMAP_WATCH
+  pthread_t thread;                  /* helper thread */
+ #endif
+  char name[];                       /* basename of mcdb file */
+};
+
+/* num fork() in (ancestors of) this process since first watcher created */
+static volatile uint32_t mcdb_mmap_watch_forks;
+
+#define mcdb_mmap_watch_live(w) \
+  ((w)->live && (w)->forks == mcdb_mmap_watch_forks)
+
+#ifdef MCDB_MMAP_WATCH
+
+static pthread_once_t mcdb_mmap_watch_once = PTHREAD_ONCE_INIT;
+static int mcdb_mmap_watch_atfork_rc = -1;
+
+static void
+mcdb_mmap_watch_atfork_child(void)
+{
+    ++mcdb_mmap_watch_forks;
+}
+
+static void
+mcdb_mmap_watch_atfork(void)
+{
+    mcdb_mmap_watch_atfork_rc =
+      pthread_atfork(NULL, NULL, mcdb_mmap_watch_atfork_child);
+}
+
+static void *
+mcdb_mmap_watch_thread(void * const arg)
+{
+    struct mcdb_mmap_watch * const restrict w = arg;
+    const struct inotify_event *ev;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    size_t i;
+    for (;;) {
+        if ((n = read(w->ifd, buf, sizeof(buf))) <= 0) {
+            if (n == -1 && errno == EINTR)
+                continue;
+            break;
+        }
+        for (i = 0; i < (size_t)n; i += sizeof(struct inotify_event)+ev->len) {
+            ev = (const struct inotify_event *)(buf+i);
+            if (ev->mask & IN_IGNORED)
+                w->live = 0;
+            else if (!(ev->mask & IN_Q_OVERFLOW)
+                     && (ev->len == 0 || 0 != strcmp(ev->name, w->name)))
+                continue;
+            plasma_membar_StoreStore();
+            ++w->gen;
+        }
+        if (!w->live)
+            break;
+    }
+    w->live = 0;
+    return NULL;
+}
+
+/* start inotify watcher on directory of mcdb (failure leaves stat() path) */
+__attribute_cold__
+__attribute_noinline__
+__attribute_nonnull__()
+static void
+mcdb_mmap_watch_create(struct mcdb_mmap_epoch * const restrict ep,
+                       const struct mcdb_mmap * const restrict map);
+
+static void
+mcdb_mmap_watch_create(struct mcdb_mmap_epoch * const restrict ep,
+                       const struct mcdb_mmap * const restrict map)
+{
+    struct mcdb_mmap_watch * restrict w;
+    const char * const slash = strrchr(map->fname, '/');
+    const char * const name = slash != NULL ? slash+1 : map->fname;
+    const size_t nlen = strlen(name);
+    char dir[PATH_MAX];
+    sigset_t set, oset;
+    int rc;
+
+    if (map->dfd != -1)
+        rc = snprintf(dir, sizeof(dir), "/proc/self/fd/%d", map->dfd);
+    else if (slash == map->fname)
+        rc = snprintf(dir, sizeof(dir), "/");
+    else if (slash != NULL)
+        rc = snprintf(dir, sizeof(dir), "%.*s",
+                      (int)(slash - map->fname), map->fname);
+    else
+        rc = snprintf(dir, sizeof(dir), ".");
+    if (rc < 0 || (size_t)rc >= sizeof(dir))
+        return;
+
+    /* (watch is not used without child handler to invalidate it in child) */
+    if (pthread_once(&mcdb_mmap_watch_once, mcdb_mmap_watch_atfork) != 0
+        || mcdb_mmap_watch_atfork_rc != 0)
+        return;
+
+    w = ep->fn_malloc(sizeof(struct mcdb_mmap_watch) + nlen + 1);
+    if (w == NULL)
+        return;
+    w->gen  = 0;
+    w->live = 1;
+    w->forks = mcdb_mmap_watch_forks;
+    memcpy(w->name, name, nlen+1);
+    if ((w->ifd = inotify_init1(IN_CLOEXEC)) == -1) {
+        ep->fn_free(w);
+        return;
+    }
+    w->wd = inotify_add_watch(w->ifd, dir, IN_CLOSE_WRITE | IN_MOVED_TO
+                                         | IN_MOVED_FROM | IN_CREATE | IN_DELETE
+                                         | IN_ATTRIB | IN_ONLYDIR);
+    if (w->wd == -1) {
+        (void) nointr_close(w->ifd);
+        ep->fn_free(w);
+        return;
+    }
+    /* helper thread does not handle signals (application threads do) */
+    sigfillset(&set);
+    rc = pthread_sigmask(SIG_SETMASK, &set, &oset);
+    if (rc == 0) {
+        rc = pthread_create(&w->thread, NULL, mcdb_mmap_watch_thread, w);
+        (void) pthread_sigmask(SIG_SETMASK, &oset, NULL);
+    }
+    if (rc != 0) {
+        (void) nointr_close(w->ifd);
+        ep->fn_free(w);
+        return;
+    }
+    ep->watch = w;
+}
+
+/* stop inotify watcher */
+__attribute_cold__
+__attribute_noinline__
+__attribute_nonnull__()
+static void
+mcdb_mmap_watch_destroy(struct mcdb_mmap_epoch * const restrict ep);
+
+static void
+mcdb_mmap_watch_destroy(struct mcdb_mmap_epoch * const restrict ep)
+{
+    struct mcdb_mmap_watch * const restrict w = ep->watch;
+    ep->watch = NULL;
+    /* removing watch queues IN_IGNORED, on which helper thread exits
+     * (fails if watch already lost, in which case helper thread has exited)
+     * (helper thread was not created in this process if forked since) */
+    if (w->forks == mcdb_mmap_watch_forks) {
+        (void) inotify_rm_watch(w->ifd, w->wd);
+        (void) pthread_join(w->thread, NULL);
+    }
+    (void) nointr_close(w->ifd);
+    ep->fn_free(w);
+}
+
+#endif /* MCDB_MMAP_WATCH */
+
 __attribute_noinline__
 void
 mcdb_mmap_free(struct mcdb_mmap * const restrict map)
@@ -395,12 +1276,26 @@ mcdb_mmap_free(struct mcdb_mmap * const restrict map)
     }
 }
 
+/* per-map epoch domain (see "per-map epoch reclamation" above) */
+__attribute_noinline__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_mmap_epoch_create(struct mcdb_mmap * const restrict map);
+
+__attribute_noinline__
+__attribute_nonnull__()
+static void
+mcdb_mmap_epoch_destroy(struct mcdb_mmap * const restrict map);
+
 __attribute_noinline__
 void
 mcdb_mmap_destroy(struct mcdb_mmap * const restrict map)
 {
-  #ifdef AT_FDCWD
     if (map == NULL) return;
+    if (map->ep != NULL)
+        mcdb_mmap_epoch_destroy(map);
+  #ifdef AT_FDCWD
     if (map->dfd != -1) {
         (void) nointr_close(map->dfd);
         map->dfd = -1;
@@ -417,6 +1312,10 @@ mcdb_mmap_reopen(struct mcdb_mmap * const restrict map)
     bool rc;
 
     const int oflags = O_RDONLY | O_NONBLOCK | O_CLOEXEC;
+    if (map->ep != NULL && map->ep->watch != NULL) {
+        map->wgen = map->ep->watch->gen; /*(before open; change reopens)*/
+        plasma_membar_LoadLoad();
+    }
   #ifdef AT_FDCWD
     if (map->dfd != -1) {
         if ((fd = nointr_openat(map->dfd, map->fname, oflags, 0)) == -1)
@@ -438,7 +1337,11 @@ bool
 mcdb_mmap_refresh_check(const struct mcdb_mmap * const restrict map)
 {
     struct stat st;
+    const struct mcdb_mmap_watch * const w =
+      map->ep != NULL ? map->ep->watch : NULL;
     plasma_membar_ld_datadep(); /*(thread ld order dep b/w map and map->ptr)*/
+    if (w != NULL && __builtin_expect( (mcdb_mmap_watch_live(w)), 1))
+        return (map->ptr == NULL || map->wgen != w->gen);
     return (map->ptr == NULL
             || ( (
                   #ifdef AT_FDCWD
@@ -465,6 +1368,8 @@ mcdb_mmap_refresh_check(const struct mcdb_mmap * const restrict map)
  *   querying threads:   mcdb_thread_register(m)
  *   querying threads:   mcdb_find(m,key,klen)         (repeat for many lookups)
  *   querying threads:   mcdb_thread_unregister(m)
+ *   (or mcdb_thread_epoch_register(m) and mcdb_thread_epoch_unregister(m),
+ *    with struct mcdb zero-initialized, for no shared write on query path)
  *
  *   maintenance thread: mcdb_mmap_destroy(map)
  *
@@ -489,9 +1394,20 @@ mcdb_mmap_refresh_check(const struct mcdb_mmap * const restrict map)
 __attribute_noinline__
 struct mcdb_mmap *
 mcdb_mmap_create(struct mcdb_mmap * restrict map,
-                 const char * const dname  __attribute_unused__,
+                 const char * const dname,
                  const char * const fname,
                  void * (*fn_malloc)(size_t), void (*fn_free)(void *))
+{
+    return mcdb_mmap_create_flags(map, dname, fname, fn_malloc, fn_free, 0);
+}
+
+__attribute_noinline__
+struct mcdb_mmap *
+mcdb_mmap_create_flags(struct mcdb_mmap * restrict map,
+                       const char * const dname  __attribute_unused__,
+                       const char * const fname,
+                       void * (*fn_malloc)(size_t), void (*fn_free)(void *),
+                       const uint32_t flags)
 {
     char *fbuf;
     size_t flen;
@@ -509,6 +1425,7 @@ mcdb_mmap_create(struct mcdb_mmap * restrict map,
     map->fn_free   = fn_free;
     map->allocated = allocated;
     map->dfd       = -1;
+    map->flags     = flags;
     flen           = strlen(fname);
 
   #if defined(AT_FDCWD)
@@ -550,6 +1467,16 @@ mcdb_mmap_create(struct mcdb_mmap * restrict map,
     }
     map->fname = fbuf;
 
+    /* (watcher started before mcdb is opened so that no change is missed) */
+    if (!mcdb_mmap_epoch_create(map)) {
+        mcdb_mmap_destroy_h(map);
+        return NULL;
+    }
+  #ifdef MCDB_MMAP_WATCH
+    if (flags & MCDB_MMAP_INOTIFY)
+        mcdb_mmap_watch_create(map->ep, map);
+  #endif
+
     if (mcdb_mmap_reopen(map)) {
         ++map->refcnt;
         return map;
@@ -560,29 +1487,159 @@ mcdb_mmap_create(struct mcdb_mmap * restrict map,
     }
 }
 
+/* create epoch domain for map (and for subsequent generations of map) */
+static bool
+mcdb_mmap_epoch_create(struct mcdb_mmap * const restrict map)
+{
+    struct mcdb_mmap_epoch * restrict ep;
+    if (map->fn_malloc == NULL
+        || (ep = map->fn_malloc(sizeof(struct mcdb_mmap_epoch))) == NULL)
+        return false;
+    memset(ep, '\0', sizeof(struct mcdb_mmap_epoch));
+    ep->lock      = (plasma_spin_lock_t)PLASMA_SPIN_LOCK_INITIALIZER;
+    ep->newest    = map;
+    ep->head      = map;
+    ep->fn_malloc = map->fn_malloc;
+    ep->fn_free   = map->fn_free;
+    map->ep       = ep;
+    return true;
+}
+
+/* collect maps which are no longer visible to any reader into *unmap list
+ * (caller must hold domain lock) */
+__attribute_nonnull__()
+static bool
+mcdb_mmap_epoch_reclaim(struct mcdb_mmap_epoch * const restrict ep,
+                        struct mcdb_mmap ** const restrict unmap);
+
+static bool
+mcdb_mmap_epoch_reclaim(struct mcdb_mmap_epoch * const restrict ep,
+                        struct mcdb_mmap ** const restrict unmap)
+{
+    const struct mcdb_reader_block * restrict b;
+    struct mcdb_mmap * restrict map;
+    uint32_t min = ep->epoch;
+    uint32_t e;
+    uint32_t i;
+    bool readers = false;
+    /* (order publish of ep->newest, ep->epoch before load of reader epochs;
+     *  pairs with plasma_membar_StoreLoad() in mcdb_thread_epoch_enter()) */
+    plasma_membar_StoreLoad();
+    for (b = ep->blocks; b != NULL; b = b->u.h.next) {
+        for (i = 0; i < MCDB_EPOCH_SLOTS; ++i) {
+            if (!b->rd[i].inuse)
+                continue;
+            readers = true;
+            e = b->rd[i].epoch;
+            if (e != MCDB_EPOCH_QUIESCENT && (int32_t)(e - min) < 0)
+                min = e;
+        }
+    }
+    plasma_membar_LoadStore();
+    while ((map = ep->head) != ep->newest
+           && map->refcnt == 0 && (int32_t)(min - map->retire) >= 0) {
+        ep->head  = map->next;
+        map->next = *unmap;
+        *unmap    = map;
+    }
+    return readers;
+}
+
+/* munmap maps collected by mcdb_mmap_epoch_reclaim() and retain struct
+ * for reuse (called without holding domain lock, to minimize lock hold time)*/
+__attribute_noinline__
+static void
+mcdb_mmap_epoch_release(struct mcdb_mmap_epoch * const restrict ep,
+                        struct mcdb_mmap * restrict unmap);
+
+static void
+mcdb_mmap_epoch_release(struct mcdb_mmap_epoch * const restrict ep,
+                        struct mcdb_mmap * restrict unmap)
+{
+    struct mcdb_mmap *map;
+    struct mcdb_mmap *reuse = NULL;
+    struct mcdb_mmap *tail = NULL;
+    while ((map = unmap) != NULL) {
+        unmap = map->next;
+        mcdb_mmap_unmap(map);
+        if (!map->allocated) {   /*(caller-provided struct is not reused)*/
+            map->next = reuse;
+            if ((reuse = map)->next == NULL)
+                tail = map;
+        }
+    }
+    if (reuse != NULL) {
+        (void) plasma_spin_lock_acquire(&ep->lock);
+        tail->next = ep->free;
+        ep->free   = reuse;
+        plasma_spin_lock_release(&ep->lock);
+    }
+}
+
+/* free epoch domain: munmap and free all generations of map except map,
+ * free released maps and reader slots (no readers may remain registered) */
+static void
+mcdb_mmap_epoch_destroy(struct mcdb_mmap * const restrict map)
+{
+    struct mcdb_mmap_epoch * const restrict ep = map->ep;
+    struct mcdb_mmap *list[2] = { ep->head, ep->free };
+    struct mcdb_mmap *next;
+    struct mcdb_reader_block *b;
+    int i;
+  #ifdef MCDB_MMAP_WATCH
+    if (ep->watch != NULL)
+        mcdb_mmap_watch_destroy(ep);
+  #endif
+    for (i = 0; i < 2; ++i) {
+        while ((next = list[i]) != NULL) {
+            list[i] = next->next;
+            if (next == map)
+                continue;
+            mcdb_mmap_unmap(next);
+            if (!next->allocated)
+                ep->fn_free(next);  /*(fname shared with map; not free'd)*/
+        }
+    }
+    while ((b = ep->blocks) != NULL) {
+        ep->blocks = b->u.h.next;
+        ep->fn_free(b->u.h.mem);
+    }
+    map->next = NULL;
+    map->ep   = NULL;
+    ep->fn_free(ep);
+}
+
 __attribute_noinline__
 struct mcdb_mmap *
 mcdb_mmap_thread_registration(struct mcdb_mmap ** const restrict mapptr,
                               const int flags)
 {
-    struct mcdb_mmap *map;
-    struct mcdb_mmap *next = NULL;
+    struct mcdb_mmap *map = *mapptr;
+    struct mcdb_mmap *next;
     struct mcdb_mmap *unmap = NULL;
+    struct mcdb_mmap_epoch *ep;
+    plasma_spin_lock_t *lock;
+    bool last = false;
     const bool register_use_incr = ((flags & MCDB_REGISTER_USE_INCR) != 0);
     #define register_use_decr (!register_use_incr)
 
-    /* use file-scoped global spinlock to protect scan of multiple mcdb_mmap's
-     * (care has been taken to avoid blocking operations while holding lock) */
+    if (__builtin_expect( (map == NULL), 0))
+        return (struct mcdb_mmap *)(uintptr_t)(!register_use_incr);
+
+    /* use per-map domain lock (map->ep is same for all generations of map,
+     * and struct mcdb_mmap remains valid while domain exists (see above)) */
+    ep   = map->ep;
+    lock = (ep != NULL) ? &ep->lock : &mcdb_global_spinlock;
 
     if (__builtin_expect( (!(flags & MCDB_REGISTER_ALREADY_LOCKED)), 1))
-        (void) plasma_spin_lock_acquire(&mcdb_global_spinlock);
+        (void) plasma_spin_lock_acquire(lock);
     plasma_membar_ccfence();
 
     map = *mapptr;
 
     if (__builtin_expect( (map == NULL), 0)
         || (__builtin_expect( (map->ptr == NULL), 0) && register_use_incr)) {
-        plasma_spin_lock_release(&mcdb_global_spinlock);
+        plasma_spin_lock_release(lock);
         /* succeed if unregister; fail if register */ /*(NULL is failure)*/
         return (struct mcdb_mmap *)(uintptr_t)(!register_use_incr);
         /* If registering, possibly detected race condition in which another
@@ -591,44 +1648,201 @@ mcdb_mmap_thread_registration(struct mcdb_mmap ** const restrict mapptr,
          * of a resource that has been released.  Caller can detect and reopen*/
     }
 
+    next = map;
     if (register_use_incr) {
-        if ((next = map->next) == NULL)
-            ++map->refcnt;
-        else {
-            while (next->next != NULL)
-                next = next->next;
-            ++next->refcnt;
+        if (ep != NULL)
+            next = ep->newest;
+        ++next->refcnt;
+        if (next != map)
             *mapptr = next;
-        }
     }
 
-    if ((register_use_decr || next != NULL) && --map->refcnt == 0) {
-        while ((next = map->next) != NULL && (next->refcnt & ~0x40000000) == 0){
-            map->next = next->next;
-            next->next = unmap;
-            (unmap = next)->fname = NULL;   /* do not free(next->fname) yet */
-        }
-        if (next != NULL)
-            next->refcnt &= ~0x40000000;    /* unmark; now oldest map in chain*/
-        map->next = unmap;
-        (unmap = map)->fname = NULL;        /* do not free(map->fname) yet */
-        if (register_use_decr)
-            *mapptr = NULL;
-        /*(map will be free'd but map value still not NULL for return val)*/
+    if ((register_use_decr || next != map) && --map->refcnt == 0) {
+        if (ep == NULL)
+            last = true;  /*(no domain; map not replaced (no generations))*/
+        else if (!mcdb_mmap_epoch_reclaim(ep, &unmap) && map == ep->newest
+                 && map == ep->head && unmap == NULL)
+            last = true;  /*(final reference and no readers; release domain)*/
     }
+    if (register_use_decr)
+        *mapptr = NULL;
     #undef register_use_decr
 
-    plasma_spin_lock_release(&mcdb_global_spinlock);
+    plasma_spin_lock_release(lock);
 
     /* release unused maps after releasing lock to minimize time holding lock */
-    next = unmap;
-    while (next != NULL) {
-        next = (unmap = next)->next;
-        mcdb_mmap_free(unmap);
+    if (unmap != NULL)
+        mcdb_mmap_epoch_release(ep, unmap);
+    if (last) {
+        if (ep != NULL)
+            mcdb_mmap_epoch_destroy(map);
+        map->fname = NULL;  /* do not free(map->fname) */
+        mcdb_mmap_free(map);
+        /*(map might be free'd but map value still not NULL for return val)*/
     }
 
     /* return map on which incr refcnt to avoid race after unlocking */
-    return map; /*(for decr refcnt, non-NULL is success, even if map free'd)*/
+    return register_use_incr ? next : map;
+    /*(for decr refcnt, non-NULL is success, even if map free'd)*/
+}
+
+/* reader enters epoch and loads newest map
+ * (no shared write: store to reader's own slot and memory barrier) */
+__attribute_nonnull__()
+static inline void
+mcdb_thread_epoch_enter(struct mcdb * const restrict m,
+                        const struct mcdb_mmap_epoch * const restrict ep);
+
+static inline void
+mcdb_thread_epoch_enter(struct mcdb * const restrict m,
+                        const struct mcdb_mmap_epoch * const restrict ep)
+{
+    plasma_membar_LoadLoad(); /*(m->map->next loaded before ep->epoch)*/
+    m->rd->epoch = ep->epoch;
+    plasma_membar_StoreLoad();
+    m->map = ep->newest;
+    plasma_membar_ld_datadep(); /*(thread ld order dep b/w map and map->ptr)*/
+}
+
+/* reader slot of m in epoch domain of map, or NULL if m is not registered
+ * (m->rd is not dereferenced unless it is a reader slot in domain; m->rd might
+ *  be uninitialized if caller set only m.map, as is sufficient for refcnt) */
+__attribute_nonnull__()
+static struct mcdb_reader *
+mcdb_thread_reader(const struct mcdb * const restrict m,
+                   struct mcdb_mmap_epoch * const restrict ep);
+
+static struct mcdb_reader *
+mcdb_thread_reader(const struct mcdb * const restrict m,
+                   struct mcdb_mmap_epoch * const restrict ep)
+{
+    struct mcdb_reader * const rd = m->rd;
+    const struct mcdb_reader_block *b;
+    uintptr_t off;
+    (void) plasma_spin_lock_acquire(&ep->lock);
+    for (b = ep->blocks; b != NULL; b = b->u.h.next) {
+        off = (uintptr_t)rd - (uintptr_t)b->rd;
+        if (off < sizeof(b->rd) && off % sizeof(struct mcdb_reader) == 0)
+            break;
+    }
+    if (b != NULL && !(rd->inuse && rd->owner == m))
+        b = NULL;
+    plasma_spin_lock_release(&ep->lock);
+    return (b != NULL) ? rd : NULL;
+}
+
+/* register struct mcdb (used by single thread) as reader of map (m->map)
+ * MCDB_REGISTER_USE_INCR: (with EPOCH) allocate reader slot, load newest map
+ * MCDB_REGISTER_USE_DECR: release reader slot; sets m->map = NULL
+ * MCDB_REGISTER_REFRESH_SELF: advance registered reader to newest map
+ *   (or move mcdb_mmap_thread_registration() refcnt if m not registered)
+ * MCDB_REGISTER_REOPEN: (with REFRESH_SELF) reopen mcdb for registered reader
+ *   (mcdb_mmap_reopen_threadsafe() on temporary refcnt held on newest map)
+ * MCDB_REGISTER_EPOCH: allocate reader slot if m not registered
+ * (m not registered as reader (or map without epoch domain) falls back to
+ *  mcdb_mmap_thread_registration(), i.e. refcnt held by mcdb_thread_register())
+ */
+__attribute_noinline__
+struct mcdb_mmap *
+mcdb_thread_registration(struct mcdb * const restrict m, const int flags)
+{
+    struct mcdb_mmap *map = m->map;
+    struct mcdb_mmap *unmap = NULL;
+    struct mcdb_mmap_epoch *ep = (map != NULL) ? map->ep : NULL;
+    struct mcdb_reader_block *b;
+    struct mcdb_reader *rd;
+    uint32_t i;
+
+    rd = (ep != NULL && m->rd != NULL) ? mcdb_thread_reader(m, ep) : NULL;
+    if (rd == NULL
+        && (ep == NULL
+            || (flags & (MCDB_REGISTER_USE_INCR|MCDB_REGISTER_EPOCH
+                        |MCDB_REGISTER_REFRESH_SELF))
+               != (MCDB_REGISTER_USE_INCR|MCDB_REGISTER_EPOCH))) {
+        if (flags & MCDB_REGISTER_REOPEN)
+            return mcdb_mmap_reopen_threadsafe_h(&m->map) ? m->map : NULL;
+        return mcdb_mmap_thread_registration_h(&m->map,
+                                               flags & MCDB_REGISTER_USE_INCR);
+    }
+
+    if (!(flags & MCDB_REGISTER_USE_INCR)) {
+        const bool replaced = (map->next != NULL);
+        plasma_membar_LoadStore(); /*(complete use of map before quiescent)*/
+        rd->epoch = MCDB_EPOCH_QUIESCENT;
+        plasma_membar_StoreStore();
+        rd->owner = NULL;
+        rd->inuse = 0;
+        m->rd  = NULL;
+        m->map = NULL;
+        /*(map might be released as soon as rd->epoch is quiescent)*/
+        if (replaced) {
+            (void) plasma_spin_lock_acquire(&ep->lock);
+            mcdb_mmap_epoch_reclaim(ep, &unmap);
+            plasma_spin_lock_release(&ep->lock);
+            if (unmap != NULL)
+                mcdb_mmap_epoch_release(ep, unmap);
+        }
+        return map; /*(non-NULL is success, even if map released)*/
+    }
+
+    if (rd == NULL) {
+        /* allocate reader slot (slow path; once per struct mcdb registered) */
+        (void) plasma_spin_lock_acquire(&ep->lock);
+        for (b = ep->blocks; b != NULL; b = b->u.h.next) {
+            for (i = 0; i < MCDB_EPOCH_SLOTS && b->rd[i].inuse; ++i) ;
+            if (i != MCDB_EPOCH_SLOTS)
+                break;
+        }
+        if (b == NULL) {
+            void * const mem = ep->fn_malloc(sizeof(struct mcdb_reader_block)
+                                             + MCDB_EPOCH_LINE-1);
+            if (mem != NULL) {
+                b = (struct mcdb_reader_block *)
+                  (((uintptr_t)mem + MCDB_EPOCH_LINE-1)
+                   & ~(uintptr_t)(MCDB_EPOCH_LINE-1));
+                memset(b, '\0', sizeof(struct mcdb_reader_block));
+                b->u.h.mem  = mem;
+                b->u.h.next = ep->blocks;
+                ep->blocks  = b;
+                i = 0;
+            }
+        }
+        if (b != NULL) {
+            rd = &b->rd[i];
+            rd->epoch = MCDB_EPOCH_QUIESCENT;
+            rd->owner = m;
+            rd->inuse = 1;
+        }
+        plasma_spin_lock_release(&ep->lock);
+        if (rd == NULL)
+            return NULL;
+        m->rd = rd;
+        mcdb_thread_epoch_enter(m, ep);
+        return m->map;
+    }
+
+    if (flags & MCDB_REGISTER_REOPEN) {
+        struct mcdb_mmap *tmp;
+        bool rc;
+        (void) plasma_spin_lock_acquire(&ep->lock);
+        ++(tmp = ep->newest)->refcnt;
+        plasma_spin_lock_release(&ep->lock);
+        rc = mcdb_mmap_reopen_threadsafe_h(&tmp);
+        (void) mcdb_mmap_thread_registration_h(&tmp, MCDB_REGISTER_USE_DECR);
+        if (!rc)
+            return NULL;
+    }
+
+    /* advance registered reader to newest map; reclaim replaced maps
+     * (slow path; once per map generation per reader) */
+    mcdb_thread_epoch_enter(m, ep);
+    /*(map might be released as soon as rd->epoch is updated)*/
+    (void) plasma_spin_lock_acquire(&ep->lock);
+    mcdb_mmap_epoch_reclaim(ep, &unmap);
+    plasma_spin_lock_release(&ep->lock);
+    if (unmap != NULL)
+        mcdb_mmap_epoch_release(ep, unmap);
+    return m->map;
 }
 
 /* theaded programs (while multiple threads are using same struct mcdb_mmap)
@@ -640,40 +1854,72 @@ mcdb_mmap_reopen_threadsafe(struct mcdb_mmap ** const restrict mapptr)
 {
     struct mcdb_mmap * const map = *mapptr;
     struct mcdb_mmap *next;
+    struct mcdb_mmap_epoch *ep;
     bool rc;
 
+    /* create epoch domain if map was not created by mcdb_mmap_create() */
+    if (__builtin_expect( (map->ep == NULL), 0)) {
+        (void) plasma_spin_lock_acquire(&mcdb_global_spinlock);
+        rc = (map->ep != NULL || mcdb_mmap_epoch_create(map));
+        plasma_spin_lock_release(&mcdb_global_spinlock);
+        if (!rc)
+            return false; /*(misconfigured mcdb_mmap or map->fn_malloc failed)*/
+    }
+    ep = map->ep;
+
     /* use high bit of refcnt to guard that one thread attempts reopen
      * (must lock since others modify refcnt while holding same spinlock) */
-    (void) plasma_spin_lock_acquire(&mcdb_global_spinlock);
+    (void) plasma_spin_lock_acquire(&ep->lock);
     if (map->next != NULL)
         return NULL !=                      /* registration releases spinlock */
           mcdb_mmap_thread_registration_h(mapptr, MCDB_REGISTER_USE_INCR
                                                  |MCDB_REGISTER_ALREADY_LOCKED);
-    if ((rc = (map->refcnt < 0x80000000u))) /*(0!=(map->refcnt & 0x80000000u))*/
+    if ((rc = (map->refcnt < 0x80000000u))) { /*(0==(refcnt & 0x80000000u))*/
         map->refcnt |= 0x80000000u;
-    plasma_spin_lock_release(&mcdb_global_spinlock);
+        if ((next = ep->free) != NULL)  /* reuse struct of released map */
+            ep->free = next->next;
+    }
+    plasma_spin_lock_release(&ep->lock);
     if (!rc)
         return true; /*other threads return, even though mcdb not reopened yet*/
 
-    if (__builtin_expect( (map->fn_malloc == NULL), 0)
-        || (next = map->fn_malloc(sizeof(struct mcdb_mmap))) == NULL)
-        return false; /*(misconfigured mcdb_mmap or map->fn_malloc failed)*/
+    if (next == NULL
+        && (next = ep->fn_malloc(sizeof(struct mcdb_mmap))) == NULL) {
+        (void) plasma_spin_lock_acquire(&ep->lock);
+        map->refcnt &= ~0x80000000u;
+        plasma_spin_lock_release(&ep->lock);
+        return false; /*(map->fn_malloc failed)*/
+    }
 
     memcpy(next, map, sizeof(struct mcdb_mmap));
-    next->ptr = NULL; /*(skip munmap() in mcdb_mmap_reopen())*/
+    next->ptr   = NULL; /*(skip munmap() in mcdb_mmap_reopen())*/
+    next->hcopy = NULL;
+    next->next  = NULL;
+    next->refcnt = 0;
+    next->retire = 0;
+    next->allocated = 0; /*(allocated by mcdb; free'd with domain)*/
     if (map->fname == map->fnamebuf)
         next->fname = next->fnamebuf;
     rc = mcdb_mmap_reopen(next);
+    (void) plasma_spin_lock_acquire(&ep->lock);
     if (__builtin_expect((!rc), 0)) {
-        map->fn_free(next);
+        next->next = ep->free;
+        ep->free   = next;
+        map->refcnt &= ~0x80000000u;
+        plasma_spin_lock_release(&ep->lock);
         return false;
     }
-    next->hash_init = map->hash_init;
-    next->hash_fn   = map->hash_fn;
-    next->refcnt   |= 0x40000000u;    /* flag to indicate not oldest in chain */
+    if (next->hash_id == MCDB_HASH_CUSTOM) { /*(custom hash set by app)*/
+        next->hash_init = map->hash_init;
+        next->hash_fn   = map->hash_fn;
+    }
+    /* publish: ep->newest, then ep->epoch (map->retire), then map->next
+     * (reader which sees map->next != NULL loads epoch >= map->retire) */
+    ep->newest      = next;
+    plasma_membar_StoreStore();
+    map->retire     = ++ep->epoch;
     plasma_membar_StoreStore();
     map->next       = next;
-    (void) plasma_spin_lock_acquire(&mcdb_global_spinlock);
     map->refcnt    &= ~0x80000000u;         /* registration releases spinlock */
     return NULL !=
       mcdb_mmap_thread_registration_h(mapptr, MCDB_REGISTER_USE_INCR
@@ -702,6 +1948,9 @@ HIDDEN extern __typeof (mcdb_iter_init)
 HIDDEN extern __typeof (mcdb_mmap_create)
                         mcdb_mmap_create_h
   __attribute_alias__ ("mcdb_mmap_create");
+HIDDEN extern __typeof (mcdb_mmap_create_flags)
+                        mcdb_mmap_create_flags_h
+  __attribute_alias__ ("mcdb_mmap_create_flags");
 HIDDEN extern __typeof (mcdb_mmap_destroy)
                         mcdb_mmap_destroy_h
   __attribute_alias__ ("mcdb_mmap_destroy");
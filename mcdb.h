@@ -45,16 +45,37 @@ PLASMA_ATTR_Pragma_once
 extern "C" {
 #endif
 
+struct mcdb_mmap_epoch;      /* epoch domain of map generations (see mcdb.c)*/
+struct mcdb_reader;          /* reader epoch slot (see mcdb.c) */
+
 struct mcdb_mmap {
   unsigned char *ptr;         /* mmap pointer */
   uint32_t b;                 /* hash table stride bits: (data < 4GB) ? 3 : 4 */
   uint32_t n;                 /* num records in mcdb */
   uint32_t hash_init;         /* hash init value */
-  uint32_t hash_pad;          /* (padding)*/
+  uint32_t hash_id;           /* hash id (MCDB_HASH_*) recorded in mcdb hdr */
   uint32_t (*hash_fn)(uint32_t, const void * restrict, size_t); /* hash func */
+  const unsigned char *filter;/* negative lookup filter (NULL if none) */
+  uint32_t filter_n;          /* num filter blocks (MCDB_FILTER_BLOCK_SZ) */
+  uint32_t filter_k;          /* num bits set per key in filter block */
+  const unsigned char *mph;   /* mph index pilots (NULL if hash tables) */
+  const unsigned char *mph_remap; /* mph index remap of positions >= mph_n */
+  const unsigned char *mph_ent;   /* mph index entries */
+  uint32_t mph_n;             /* num keys (entries) in mph index */
+  uint32_t mph_nb;            /* num buckets (pilots) in mph index */
+  uint32_t mph_m;             /* num positions in mph (before remap) */
+  uint32_t mph_seed;          /* mph pilot seed */
+  const unsigned char *sparse;/* sparse record offset index (NULL if none) */
+  uint32_t sparse_n;          /* num sparse index entries */
+  uint32_t sparse_sz;         /* sparse index interval (data bytes) */
+  const unsigned char *hptr;  /* index (hash tables) base: ptr or copy - hpos*/
+  unsigned char *hcopy;       /* huge page copy of index region (or NULL) */
+  size_t hcopy_sz;            /* huge page copy mmap size */
+  uint32_t flags;             /* MCDB_MMAP_* load options (set before init) */
   uintptr_t size;             /* mmap size */
   time_t mtime;               /* mmap file mtime */
   struct mcdb_mmap *next;     /* updated (new) mcdb_mmap */
+  struct mcdb_mmap_epoch *ep; /* epoch domain shared by map generations */
   void * (*fn_malloc)(size_t);/* fn ptr to malloc() */
   void (*fn_free)(void *);    /* fn ptr to free() */
   char *fname;                /* basename of mmap file, relative to dir fd */
@@ -62,6 +83,8 @@ struct mcdb_mmap {
   int allocated;              /* flag if struct allocated in mcdb_mmap_create */
   int dfd;                    /* fd open to dir in which mmap file resides */
   uint32_t refcnt;            /* registered access reference count */
+  uint32_t retire;            /* epoch at which map was replaced by next */
+  uint32_t wgen;              /* watcher generation at (re)open (see mcdb.c)*/
 };
 /* aside: char fnamebuf[] sized to separate 'next' and 'refcnt' by 128 bytes
  * (L2 cache lines on modern hardware are 64-bytes and 128-bytes)
@@ -75,12 +98,18 @@ struct mcdb {
   uintptr_t kpos;  /* initialized if mcdb_findtagstart() returns true */
   uintptr_t hpos;  /* initialized if mcdb_findtagstart() returns true */
   uintptr_t dpos;  /* initialized if mcdb_findtagnext() returns true */
+  uintptr_t rpos;  /* end of key found (dpos unless alias record; see below) */
   uint32_t dlen;   /* initialized if mcdb_findtagnext() returns true */
   uint32_t klen;   /* initialized if mcdb_findtagnext() returns true */
   uint32_t khash;  /* initialized by call to mcdb_findtagstart() */
   uint32_t pad0;   /* padding */
   void *vp;        /* user-provided extension data */
+  struct mcdb_reader *rd; /* epoch slot if mcdb_thread_epoch_register() */
 };
+/* (rd need not be initialized by callers which only set m.map, e.g. struct
+ *  mcdb on stack; rd is used only once verified to be reader slot in epoch
+ *  domain of m->map allocated for m by mcdb_thread_epoch_register().  Still,
+ *  zero-initialize struct mcdb (e.g. memset()) so that rd is NULL) */
 
 __attribute_hot__
 __attribute_nonnull__()
@@ -104,6 +133,27 @@ mcdb_findtagnext(struct mcdb * restrict, const char * restrict, size_t,
   (__builtin_expect((mcdb_findstart((m),(key),(klen))), 1) \
                   && mcdb_findnext((m),(key),(klen)))
 
+/* batch lookup; overlaps memory latency of lookups of many keys
+ * (caller sets key, klen; result dpos, dlen is first data found for key) */
+struct mcdb_batch {
+  const char *key; /* key to look up (set by caller) */
+  size_t klen;     /* key length     (set by caller) */
+  uintptr_t dpos;  /* data position; 0 if key not found */
+  uint32_t dlen;   /* data length;   0 if key not found */
+  uint32_t pad0;   /* padding */
+};
+
+#define MCDB_BATCH_WINDOW 16  /* num keys in flight in mcdb_findtagbatch() */
+
+__attribute_hot__
+__attribute_nonnull__()
+__attribute_nothrow__
+EXPORT extern size_t
+mcdb_findtagbatch(struct mcdb * restrict, struct mcdb_batch * restrict, size_t,
+                  unsigned char);/* note: must be 0 or cast to (unsigned char)*/
+
+#define mcdb_findbatch(m,q,n) mcdb_findtagbatch((m),(q),(n),0)
+
 __attribute_nonnull__()
 __attribute_nothrow__
 __attribute_warn_unused_result__
@@ -126,23 +176,30 @@ mcdb_validate_slots(struct mcdb * restrict);
 #define mcdb_datapos(m)      ((m)->dpos)
 #define mcdb_datalen(m)      ((m)->dlen)
 #define mcdb_dataptr(m)      ((m)->map->ptr+(m)->dpos)
-#define mcdb_keyptr(m)       ((m)->map->ptr+(m)->dpos-(m)->klen)
+#define mcdb_keyptr(m)       ((m)->map->ptr+(m)->rpos-(m)->klen)
 #define mcdb_keylen(m)       ((m)->klen)
 
+/* (macros valid for struct mcdb_batch *b after mcdb_findtagbatch() returns) */
+#define mcdb_batch_found(b)        ((b)->dpos != 0)
+#define mcdb_batch_dataptr(m,b)    ((m)->map->ptr+(b)->dpos)
+#define mcdb_batch_datalen(b)      ((b)->dlen)
+
 struct mcdb_iter {
   unsigned char *ptr;
   unsigned char *eod;
   uint32_t klen;
   uint32_t dlen;
   struct mcdb_mmap *map;
+  unsigned char *kptr;  /* key of record */
+  unsigned char *dptr;  /* data of record (data aliased if alias record) */
 };
 
 /* (macros valid only after mcdb_iter() returns true) */
-#define mcdb_iter_datapos(iter) ((iter)->ptr-(iter)->dlen-(iter)->map->ptr)
+#define mcdb_iter_datapos(iter) ((iter)->dptr-(iter)->map->ptr)
 #define mcdb_iter_datalen(iter) ((iter)->dlen)
-#define mcdb_iter_dataptr(iter) ((iter)->ptr-(iter)->dlen)
+#define mcdb_iter_dataptr(iter) ((iter)->dptr)
 #define mcdb_iter_keylen(iter)  ((iter)->klen)
-#define mcdb_iter_keyptr(iter)  ((iter)->ptr-(iter)->dlen-(iter)->klen)
+#define mcdb_iter_keyptr(iter)  ((iter)->kptr)
 
 __attribute_nonnull__()
 __attribute_nothrow__
@@ -155,6 +212,18 @@ __attribute_nothrow__
 EXPORT extern void
 mcdb_iter_init(struct mcdb_iter * restrict, struct mcdb * restrict);
 
+/* initialize iter for part of data section (part in [0, nparts)), so that
+ * nparts threads can iterate disjoint ranges which together are all records.
+ * Ranges begin at sparse index entries (see MCDB_HDR_SPARSE_N); if mcdb has no
+ * sparse index, part 0 is entire data section and other parts are empty.
+ * (nparts greater than map->sparse_n results in some empty parts) */
+__attribute_nonnull__()
+__attribute_nothrow__
+__attribute_warn_unused_result__
+EXPORT extern bool
+mcdb_iter_init_range(struct mcdb_iter * restrict, struct mcdb * restrict,
+                     uint32_t, uint32_t);
+
 __attribute_malloc__
 __attribute_nonnull__((3,4,5))
 __attribute_warn_unused_result__
@@ -170,6 +239,7 @@ mcdb_mmap_destroy(struct mcdb_mmap * restrict);
  * caller may call mcdb_mmap_refresh() before mcdb_find() or mcdb_findstart(),
  * or at other scheduled intervals, or not at all, depending on program need.
  * Note: threaded programs should use thread-safe mcdb_thread_refresh()
+ * (or mcdb_thread_epoch_refresh(); see mcdb_thread_epoch_register())
  * (which passes a ptr to the map ptr and might update value of that ptr ptr) */
 #define mcdb_mmap_refresh(map) \
   (__builtin_expect(!mcdb_mmap_refresh_check(map), true) \
@@ -184,6 +254,44 @@ __attribute_warn_unused_result__
 EXPORT extern bool
 mcdb_mmap_init(struct mcdb_mmap * restrict, int);
 
+/* parse mcdb header at map->ptr (map->size and map->b set from mcdb file);
+ * filter, mph index, and sparse index pointers are set to map->ptr + offset
+ * (internal to libmcdb; not exported) (used by mcdb_mmap_init(), mcdb_uring)*/
+__attribute_nonnull__()
+__attribute_nothrow__
+__attribute_warn_unused_result__
+extern bool
+mcdb_mmap_hdr(struct mcdb_mmap * restrict);
+
+/* mcdb_mmap load options (map->flags; preserved across refresh/reopen)
+ * MCDB_MMAP_HUGEPAGE_INDEX: copy index region (filter, mph index, hash tables;
+ *   from start of index to EOF) into anonymous memory backed by huge pages
+ *   (MAP_HUGETLB if available, else transparent huge pages (MADV_HUGEPAGE))
+ *   to reduce TLB misses of random lookups in large mcdb.  Data section
+ *   remains file-mapped.  Copy is rebuilt by mcdb_mmap_init() for each new
+ *   mmap (refresh/reopen).  If copy can not be allocated, index is used from
+ *   file mmap (not an error).
+ * Set map->flags before mcdb_mmap_init(), or pass to mcdb_mmap_create_flags()*/
+#define MCDB_MMAP_HUGEPAGE_INDEX 0x1u
+#define MCDB_HUGEPAGE_SZ (1u<<21)  /* 2 MB (x86_64 huge page size) */
+/* MCDB_MMAP_INOTIFY: (Linux, _THREAD_SAFE) watch directory of mcdb with
+ *   inotify, serviced by a helper thread started by mcdb_mmap_create_flags().
+ *   mcdb_mmap_refresh_check() then compares a generation counter incremented
+ *   by the helper thread upon change to mcdb file, instead of stat() per call.
+ *   If inotify is unavailable or the watch is lost (e.g. directory removed),
+ *   mcdb_mmap_refresh_check() falls back to stat().
+ *   (helper thread is not inherited across fork(); in child, refresh check
+ *    of map created with MCDB_MMAP_INOTIFY in parent falls back to stat()) */
+#define MCDB_MMAP_INOTIFY 0x2u
+
+__attribute_malloc__
+__attribute_nonnull__((3,4,5))
+__attribute_warn_unused_result__
+EXPORT extern struct mcdb_mmap *
+mcdb_mmap_create_flags(struct mcdb_mmap * restrict,
+                       const char *,const char *,
+                       void * (*)(size_t),void (*)(void *),uint32_t);
+
 #define MCDB_MADV_NORMAL      0
 #define MCDB_MADV_RANDOM      1
 #define MCDB_MADV_SEQUENTIAL  2
@@ -220,19 +328,41 @@ mcdb_mmap_refresh_check(const struct mcdb_mmap * restrict);
 enum mcdb_flags {
   MCDB_REGISTER_USE_DECR = 0,
   MCDB_REGISTER_USE_INCR = 1,
-  MCDB_REGISTER_ALREADY_LOCKED = 2
+  MCDB_REGISTER_ALREADY_LOCKED = 2,
+  MCDB_REGISTER_REFRESH_SELF = 4,
+  MCDB_REGISTER_REOPEN = 8,
+  MCDB_REGISTER_EPOCH = 16
 };
 
+/* mcdb_mmap_thread_registration() holds reference count on map (*mapptr)
+ * (for use by caller sharing a map pointer among threads, e.g. nss_mcdb.c)
+ * mcdb_thread_registration() with MCDB_REGISTER_EPOCH registers struct mcdb
+ * (one per thread) as reader in epoch domain of map; no shared write on query
+ * path (see mcdb.c); without MCDB_REGISTER_EPOCH, struct mcdb which is not
+ * registered as reader falls back to mcdb_mmap_thread_registration(&m->map) */
 __attribute_nonnull__()
 EXPORT extern struct mcdb_mmap *
 mcdb_mmap_thread_registration(struct mcdb_mmap ** restrict, int);
 
+__attribute_nonnull__()
+EXPORT extern struct mcdb_mmap *
+mcdb_thread_registration(struct mcdb * restrict, int);
+
 __attribute_nonnull__()
 __attribute_warn_unused_result__
 EXPORT extern bool
 mcdb_mmap_reopen_threadsafe(struct mcdb_mmap ** restrict);
 
 
+/* mcdb_thread_register() holds reference count on m->map (see above)
+ * mcdb_thread_epoch_register() instead allocates reader slot (m->rd) in epoch
+ * domain of m->map; no lock and no shared write on query path.  Reader slot is
+ * released by mcdb_thread_epoch_unregister() (not mcdb_thread_unregister()).
+ * Threaded programs registered with mcdb_thread_epoch_register() should use
+ * mcdb_thread_epoch_refresh() in place of mcdb_thread_refresh().
+ * mcdb_thread_refresh_self() (called by mcdb_findtagstart()) serves both.
+ * (struct mcdb need not be zero-initialized for mcdb_thread_register();
+ *  see struct mcdb) */
 #define mcdb_thread_register(mcdb) \
   mcdb_mmap_thread_registration(&(mcdb)->map, MCDB_REGISTER_USE_INCR)
 #define mcdb_thread_unregister(mcdb) \
@@ -241,7 +371,22 @@ mcdb_mmap_reopen_threadsafe(struct mcdb_mmap ** restrict);
   mcdb_mmap_refresh_threadsafe(&(mcdb)->map)
 #define mcdb_thread_refresh_self(mcdb) \
   (__builtin_expect((mcdb)->map->next == NULL, true) \
-   || __builtin_expect(mcdb_thread_register(mcdb) != NULL, true))
+   || __builtin_expect(mcdb_thread_registration((mcdb), \
+                                                MCDB_REGISTER_USE_INCR   \
+                                               |MCDB_REGISTER_REFRESH_SELF) \
+                       != NULL, true))
+#define mcdb_thread_epoch_register(mcdb) \
+  mcdb_thread_registration((mcdb), MCDB_REGISTER_USE_INCR|MCDB_REGISTER_EPOCH)
+#define mcdb_thread_epoch_unregister(mcdb) \
+  mcdb_thread_registration((mcdb), MCDB_REGISTER_USE_DECR|MCDB_REGISTER_EPOCH)
+#define mcdb_thread_epoch_refresh(mcdb) \
+  (__builtin_expect(!mcdb_mmap_refresh_check((mcdb)->map), true) \
+   || __builtin_expect(mcdb_thread_registration((mcdb), \
+                                                MCDB_REGISTER_USE_INCR   \
+                                               |MCDB_REGISTER_REFRESH_SELF \
+                                               |MCDB_REGISTER_REOPEN \
+                                               |MCDB_REGISTER_EPOCH) \
+                       != NULL, true))
 
 
 #define MCDB_SLOT_BITS 8                  /* 2^8 = 256 */
@@ -250,10 +395,158 @@ mcdb_mmap_reopen_threadsafe(struct mcdb_mmap ** restrict);
 #define MCDB_HEADER_SZ (MCDB_SLOTS<<4)    /* MCDB_SLOTS * 16  (256*16=4096) */
 #define MCDB_MMAP_SZ (1u<<19)             /* 512KB; must be >  MCDB_HEADER_SZ */
 #define MCDB_BLOCK_SZ (1u<<22)            /*   4MB; must be >= MCDB_MMAP_SZ */
+#define MCDB_MMAP_MAX (1u<<26)            /*  64MB; must be >= MCDB_BLOCK_SZ*/
 
 #define MCDB_PAD_ALIGN 16
 #define MCDB_PAD_MASK (MCDB_PAD_ALIGN-1)
 
+/* mcdb header extension words
+ * Each 16-byte header slot is 8-byte hpos, 4-byte hslots, 4-byte word which
+ * was historically written as 0 and ignored by readers.  The 4-byte word in
+ * header slot i (at offset (i<<4)+12) is available for mcdb header extensions.
+ * (values stored big-endian, as are all other mcdb header values)
+ * (mcdb files with version 0 (all words 0) use djb hash with default init) */
+#define MCDB_HDR_WORD(i)     (((i)<<4)+12)
+#define MCDB_HDR_VERSION     MCDB_HDR_WORD(0)  /* mcdb header version */
+#define MCDB_HDR_FEATURES    MCDB_HDR_WORD(1)  /* MCDB_FEATURE_* flags */
+#define MCDB_HDR_HASH_ID     MCDB_HDR_WORD(2)  /* MCDB_HASH_* */
+#define MCDB_HDR_HASH_INIT   MCDB_HDR_WORD(3)  /* hash init value (seed) */
+#define MCDB_HDR_FILTER      MCDB_HDR_WORD(4)  /* filter type, k (or 0) */
+#define MCDB_HDR_FILTER_N    MCDB_HDR_WORD(5)  /* num filter blocks */
+#define MCDB_HDR_FILTER_POSH MCDB_HDR_WORD(6)  /* filter offset (high 32) */
+#define MCDB_HDR_FILTER_POSL MCDB_HDR_WORD(7)  /* filter offset (low 32) */
+#define MCDB_HDR_MPH_N       MCDB_HDR_WORD(8)  /* mph num keys */
+#define MCDB_HDR_MPH_NB      MCDB_HDR_WORD(9)  /* mph num buckets */
+#define MCDB_HDR_MPH_M       MCDB_HDR_WORD(10) /* mph num positions */
+#define MCDB_HDR_MPH_SEED    MCDB_HDR_WORD(11) /* mph pilot seed */
+#define MCDB_HDR_MPH_POSH    MCDB_HDR_WORD(12) /* mph offset (high 32) */
+#define MCDB_HDR_MPH_POSL    MCDB_HDR_WORD(13) /* mph offset (low 32) */
+#define MCDB_HDR_MPH_NRECS   MCDB_HDR_WORD(14) /* num records in mcdb */
+#define MCDB_HDR_MPH_BITS    MCDB_HDR_WORD(15) /* mph entry size bits (3,4) */
+#define MCDB_HDR_SPARSE_N    MCDB_HDR_WORD(16) /* num sparse index entries */
+#define MCDB_HDR_SPARSE_SZ   MCDB_HDR_WORD(17) /* sparse index interval */
+#define MCDB_HDR_SPARSE_POSH MCDB_HDR_WORD(18) /* sparse offset (high 32) */
+#define MCDB_HDR_SPARSE_POSL MCDB_HDR_WORD(19) /* sparse offset (low 32) */
+
+#define MCDB_VERSION 1u
+
+/* mcdb readers refuse to open mcdb with feature flags they do not support
+ * (feature flags are set only when readers must use feature to read mcdb) */
+#define MCDB_FEATURE_MPH   0x1u /* minimal perfect hash index (no hash tables)*/
+#define MCDB_FEATURE_ALIAS 0x2u /* alias records (MCDB_DLEN_ALIAS) */
+#define MCDB_FEATURES_SUPPORTED (MCDB_FEATURE_MPH|MCDB_FEATURE_ALIAS)
+
+/* alias records (MCDB_FEATURE_ALIAS)
+ * Record with high bit of dlen set (MCDB_DLEN_ALIAS) is an alias record; its
+ * key maps to data of an earlier record, so that data shared by many keys
+ * (e.g. nss hosts entry by name, by aliases and by address) is stored once:
+ *   klen, MCDB_DLEN_ALIAS | dlen, key, d (64-bit big-endian)
+ * where dlen is length of data aliased, which begins d bytes before d.
+ * (dlen <= INT_MAX-8 (see mcdb_make.c), so high bit is otherwise unused)
+ * (d is a distance instead of an offset so that records are position
+ *  independent, e.g. records of mcdb_make_thread_start() handles)
+ * mcdb_findtagnext() and mcdb_iter() resolve alias records: data pos, len and
+ * ptr are those of data aliased; key is key of alias record.
+ * MCDB_FEATURE_ALIAS is set in header of mcdb with alias records.  It is
+ * refused only by readers which check MCDB_HDR_FEATURES (readers which also
+ * read MCDB_HDR_HASH_ID, and later) and do not support alias records; earlier
+ * readers do not read MCDB_HDR_FEATURES and do not refuse the mcdb: they
+ * would return MCDB_DLEN_ALIAS | dlen as data len and the distance as data.
+ * Do not write alias records to mcdb which may be read by earlier readers
+ * (nss_mcdbctl writes alias records only with -a; mcdbctl make only with -a).
+ * (mcdb_alias_dist() requires uint32.h) */
+#define MCDB_DLEN_ALIAS 0x80000000u
+#define mcdb_alias_dist(p) \
+  (((uint64_t)uint32_strunpack_bigendian_macro(p) << 32) \
+   | uint32_strunpack_bigendian_macro((p)+4))
+
+/* hash functions (MCDB_HDR_HASH_ID)
+ * MCDB_HASH_CUSTOM indicates that application-provided hash function was used
+ * to create mcdb; application must set map->hash_fn (and map->hash_init)
+ * after mcdb_mmap_init() in order to query mcdb
+ * (mcdb_mmap_reopen_threadsafe() carries custom hash_fn forward to new map) */
+enum {
+  MCDB_HASH_DJB      = 0,    /* uint32_hash_djb() (default; cdb-compatible) */
+  MCDB_HASH_IDENTITY = 1,    /* uint32_hash_identity() (keys >= 4 bytes) */
+  MCDB_HASH_XXH32    = 2,    /* uint32_hash_xxh32_key() (fast, seeded) */
+  MCDB_HASH_CUSTOM   = 0xFF  /* application-provided hash function */
+};
+
+#define MCDB_HASH_DJB_INIT 5381u  /* djb hash init (UINT32_HASH_DJB_INIT) */
+
+/* negative lookup filter (MCDB_HDR_FILTER)
+ * Blocked Bloom filter: array of 64-byte (cache line) blocks placed between
+ * end of data and start of hash tables, preceded by at least 8 bytes of ~0
+ * padding (so that mcdb_iter() (and older readers) stop at end of data).
+ * Key khash selects block; k bits in block are also derived from khash.
+ * mcdb_findtagstart() returns false for most absent keys after touching
+ * single cache line of filter instead of probing slot hash table.
+ * Filter is optional; readers not supporting filter ignore it and hash table
+ * is unchanged, so filter does not set an MCDB_HDR_FEATURES flag.
+ * MCDB_HDR_FILTER is (MCDB_FILTER_BLOCKED_BLOOM << 8) | k  (k in 1..16) */
+#define MCDB_FILTER_BLOCKED_BLOOM 1u
+#define MCDB_FILTER_BLOCK_SZ 64u
+#define MCDB_FILTER_BITS_DEFAULT 10u  /* filter bits per key (~1% false pos) */
+/* khash is remixed (murmur3 fmix32) since khash (e.g. djb) is not uniform;
+ * block index is mcdb_filter_block() of h = remixed khash (multiply-shift maps
+ * h into [0, n)); h is then remixed again (h + 0x9E3779B9) for bit positions
+ * independent of block index: bit i (0 <= i < k) is (a + i*b) & 511 with
+ * a = h >> 23 and b = (h >> 14) | 1 */
+#define mcdb_filter_remix(h) \
+  ((h) ^= (h) >> 16, (h) *= 0x85EBCA6Bu, (h) ^= (h) >> 13, \
+   (h) *= 0xC2B2AE35u, (h) ^= (h) >> 16)
+#define mcdb_filter_block(h,n) \
+  ((uint32_t)(((uint64_t)(h) * (n)) >> 32))
+
+/* sparse record offset index (MCDB_HDR_SPARSE_N)
+ * Array of n 64-bit big-endian file offsets placed between end of data and
+ * filter (or mph index or hash tables), after the ~0 padding which ends data.
+ * Entry i is offset of first record which begins at or after data offset
+ * MCDB_HEADER_SZ + i * MCDB_HDR_SPARSE_SZ, or end of data if none, so that
+ * iteration can begin at a record boundary in middle of data section
+ * (mcdb_iter_init_range()).  Index is optional; readers not supporting it
+ * ignore it, so it does not set an MCDB_HDR_FEATURES flag. */
+
+/* index types
+ * MCDB_INDEX_HASH: 256 slot open hash tables (50% load) (cdb-compatible)
+ * MCDB_INDEX_MPH:  minimal perfect hash (MCDB_FEATURE_MPH)
+ *
+ * mph index (PTHash-style hash-and-displace) replaces slot hash tables with
+ * array of n entries (one per distinct key), indexed by 64-bit key hash:
+ *   lo = xxh32 key hash (MCDB_HASH_XXH32 khash; fingerprint in entry, filter)
+ *   hi = xxh32 key hash seeded with MCDB_MPH_HASH_HI(hash_init)
+ *   bucket = mcdb_mph_bucket(hi, lo, nb)  (skewed: 60% of keys into 30% of
+ *            buckets, so that dense buckets are placed while mph is sparse)
+ *   x = fmix64(seed:pilot[bucket]) ^ (hi:lo);  p = mcdb_mph_pos(fmix64(x), m)
+ *   if (p >= n) p = remap[p - n]
+ * Entry layout is same as hash table entry ([khash, dpos32] if bits == 3,
+ * [khash, klen, dpos64] if bits == 4); key lookup is one pilot access,
+ * one entry access and one data access.  mph section is 64-byte aligned:
+ *   pilots (16-bit big-endian, nb) padded to 16 bytes,
+ *   remap (32-bit big-endian, m - n) padded to 16 bytes, entries (n)
+ * Header slots all have hslots 0 and hpos at EOF (older readers find no keys
+ * and mcdb readers without mph support refuse MCDB_FEATURE_MPH).
+ * Duplicate keys: mph index contains first record added for each key; later
+ * records with same key remain in data section (mcdb_iter()), but are not
+ * returned by mcdb_findtagnext(), which returns at most one record per key.
+ */
+enum {
+  MCDB_INDEX_HASH = 0,
+  MCDB_INDEX_MPH  = 1
+};
+#define MCDB_MPH_HASH_HI(hash_init) ((hash_init) ^ 0x9E3779B9u)
+#define mcdb_mph_fmix64(x) \
+  ((x) ^= (x) >> 33, (x) *= UINT64_C(0xFF51AFD7ED558CCD), (x) ^= (x) >> 33, \
+   (x) *= UINT64_C(0xC4CEB9FE1A85EC53), (x) ^= (x) >> 33)
+#define mcdb_mph_bucket(hi,lo,nb) \
+  (((hi) < 0x9999999Au) /*(0.6 * 2^32)*/ \
+   ? mcdb_filter_block((lo), mcdb_mph_nb1(nb)) \
+   : mcdb_mph_nb1(nb) + mcdb_filter_block((lo), (nb) - mcdb_mph_nb1(nb)))
+#define mcdb_mph_nb1(nb) /*(0.3 * nb)*/ \
+  ((uint32_t)(((uint64_t)(nb) * 0x4CCCCCCDu) >> 32))
+#define mcdb_mph_pos(x,m) \
+  ((uint32_t)((((x) >> 32) * (uint64_t)(m)) >> 32))
+
 
 /* alias symbols with hidden visibility for use in DSO linking static mcdb.o
  * (Reference: "How to Write Shared Libraries", by Ulrich Drepper)
@@ -287,6 +580,11 @@ __attribute_nonnull__((3,4,5))
 __attribute_warn_unused_result__
 HIDDEN extern __typeof (mcdb_mmap_create)
                         mcdb_mmap_create_h;
+__attribute_malloc__
+__attribute_nonnull__((3,4,5))
+__attribute_warn_unused_result__
+HIDDEN extern __typeof (mcdb_mmap_create_flags)
+                        mcdb_mmap_create_flags_h;
 HIDDEN extern __typeof (mcdb_mmap_destroy)
                         mcdb_mmap_destroy_h;
 __attribute_nonnull__()
@@ -307,6 +605,7 @@ HIDDEN extern __typeof (mcdb_mmap_reopen_threadsafe)
 #define mcdb_iter_h                      mcdb_iter
 #define mcdb_iter_init_h                 mcdb_iter_init
 #define mcdb_mmap_create_h               mcdb_mmap_create
+#define mcdb_mmap_create_flags_h         mcdb_mmap_create_flags
 #define mcdb_mmap_destroy_h              mcdb_mmap_destroy
 #define mcdb_mmap_refresh_check_h        mcdb_mmap_refresh_check
 #define mcdb_mmap_thread_registration_h  mcdb_mmap_thread_registration 
@@ -28,6 +28,9 @@
 #ifndef _XOPEN_SOURCE /* posix_fallocate() requires _XOPEN_SOURCE 600 */
 #define _XOPEN_SOURCE 600
 #endif
+#ifndef _GNU_SOURCE /* mremap() on Linux */
+#define _GNU_SOURCE 1
+#endif
 /* gcc -std=c99 hides MAP_ANONYMOUS
  * _BSD_SOURCE or _SVID_SOURCE needed for mmap MAP_ANONYMOUS on Linux */
 #ifndef _BSD_SOURCE
@@ -56,9 +59,14 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>   /* posix_fallocate() */
+#include <stdlib.h>  /* mkstemp(), getenv() */
 #include <string.h>  /* memcpy() */
 #include <limits.h>  /* UINT_MAX, INT_MAX */
 
+#ifdef _THREAD_SAFE
+#include <pthread.h>
+#endif
+
 #ifdef _AIX
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS 0x10
@@ -91,6 +99,20 @@ struct mcdb_hplist {
   struct mcdb_hp hp[MCDB_HPLIST];
 };
 
+/* hp entries spilled to temporary files (see mcdb_make_spill())
+ * (full hplists of a slot are appended (oldest first) to spill file of slot
+ *  when more than max hplists of slot are in memory, and are then reused) */
+struct mcdb_make_spill {
+  uint32_t max;                  /* num hplists per slot kept in memory */
+  uint32_t nmem[MCDB_SLOTS];     /* num hplists per slot in memory */
+  uint32_t nspill[MCDB_SLOTS];   /* num hplists per slot in spill file */
+  int fd[MCDB_SLOTS];            /* spill file per slot (-1 until needed) */
+  char tmpl[];                   /* mkstemp() template for spill files */
+};
+
+/* num hplists read back from spill file at a time in mcdb_make_finish() */
+#define MCDB_SPILL_CHUNK 64
+
 /* routine marked to indicate unlikely branch;
  * __attribute_cold__ can be used instead of __builtin_expect() */
 __attribute_cold__
@@ -103,6 +125,65 @@ mcdb_make_err(struct mcdb_make * const restrict m, int errnum)
     return -1;
 }
 
+/* write full hplists of slot to spill file of slot and reuse hplists */
+__attribute_noinline__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_spill_slot(struct mcdb_make * const restrict m, const uint32_t i);
+
+static bool
+mcdb_make_spill_slot(struct mcdb_make * const restrict m, const uint32_t i)
+{
+    struct mcdb_make_spill * const restrict s = m->spill;
+    struct mcdb_hplist * const head = m->head[i];
+    struct mcdb_hplist *pend = head->pend;
+    struct mcdb_hplist *x;
+    struct mcdb_hplist *n;
+    uint32_t u = 0;
+
+    if (s->fd[i] == -1) {
+        const size_t len = strlen(s->tmpl);
+        if ((s->fd[i] = mkstemp(s->tmpl)) == -1)
+            return false;
+        unlink(s->tmpl);
+        memcpy(s->tmpl + len - 6, "XXXXXX", 6);
+    }
+
+    /* reverse list (newest first) to write hplists oldest first */
+    for (x = NULL, n = head; n; ) {
+        struct mcdb_hplist * const next = n->next;
+        n->next = x;
+        x = n;
+        n = next;
+    }
+    for (n = x; n; n = n->next, ++u) {
+        if (nointr_write(s->fd[i], (char *)n->hp, sizeof(n->hp)) == -1) {
+            for (n = NULL; x; ) { /*(restore list order)*/
+                struct mcdb_hplist * const next = x->next;
+                x->next = n;
+                n = x;
+                x = next;
+            }
+            return false;
+        }
+    }
+
+    /* reuse hplists; head hplist (newest) remains head of (now empty) list */
+    for (n = x; n != head; n = x) {
+        x = n->next;
+        n->num  = 0;
+        n->pend = pend;
+        pend = n;
+    }
+    head->num  = 0;
+    head->next = NULL;
+    head->pend = pend;
+    s->nmem[i] = 1;
+    s->nspill[i] += u;
+    return true;
+}
+
 __attribute_noinline__
 __attribute_nonnull__()
 __attribute_warn_unused_result__
@@ -115,9 +196,17 @@ mcdb_hplist_alloc(struct mcdb_make * const restrict m)
     uint32_t i = m->hp.h & MCDB_SLOT_MASK;
     struct mcdb_hplist * const head = m->head[i];
     struct mcdb_hplist * const pend = head->pend;
+    if (m->spill != NULL) {
+        /* (num slot hash table entries (count << 1) must fit in uint32_t) */
+        if (m->count[i] > INT_MAX - MCDB_HPLIST)
+            return (errno = ENOMEM, false);
+        if (m->spill->nmem[i] >= m->spill->max)
+            return mcdb_make_spill_slot(m, i);
+    }
     if (pend != NULL) {
         pend->next = head;
         m->head[i] = pend;
+        if (m->spill != NULL) ++m->spill->nmem[i];
         return true;
     }
     else {
@@ -137,12 +226,16 @@ mcdb_hplist_alloc(struct mcdb_make * const restrict m)
             else {
                 hplist[i].next = m->head[i];
                 m->head[i] = hplist+i;
+                if (m->spill != NULL) ++m->spill->nmem[i];
             }
             cnt += count[i];
         }
         /* detect if we have already passed 2 gibibyte records
-         * (not exact, but ok; will abort in mcdb_make_finish() if > INT_MAX) */
-        return (cnt < INT_MAX) ? true : (errno = ENOMEM, false);
+         * (not exact, but ok; will abort in mcdb_make_finish() if > INT_MAX)
+         * (with spill, limit is per slot; see mcdb_make_spill_slot()) */
+        return (cnt < INT_MAX || m->spill != NULL)
+          ? true
+          : (errno = ENOMEM, false);
     }
 }
 
@@ -255,6 +348,96 @@ mcdb_mmap_commit(struct mcdb_make * const restrict m,
      * OS crashes, then the updated mcdb can be corrupted. */
 }
 
+/* start writeback of mcdb file up to offset end (do not wait) so that dirty
+ * pages do not accumulate and fdatasync() after mcdb_make_finish() is short */
+__attribute_nonnull__()
+static void
+mcdb_make_writeback(struct mcdb_make * const restrict m, const size_t end);
+
+static void
+mcdb_make_writeback(struct mcdb_make * const restrict m, const size_t end)
+{
+  #if defined(__linux__) && defined(SYNC_FILE_RANGE_WRITE)
+    if (m->fd != -1 && end > m->wbpos) {
+        (void)sync_file_range(m->fd, (off_t)m->wbpos, (off_t)(end - m->wbpos),
+                              SYNC_FILE_RANGE_WRITE);
+        m->wbpos = end;
+    }
+  #else
+    (void)m;
+    (void)end;
+  #endif
+}
+
+/* write mcdb file from offset off up to offset end and drop it from page cache
+ * (mcdb_make_nocache(); must not be mapped; errors are reported by caller
+ *  fdatasync() or are otherwise advisory) */
+__attribute_noinline__
+__attribute_nonnull__()
+static void
+mcdb_make_dropcache(struct mcdb_make * const restrict m,
+                    const size_t off, const size_t end);
+
+__attribute_noinline__
+static void
+mcdb_make_dropcache(struct mcdb_make * const restrict m,
+                    const size_t off, const size_t end)
+{
+  #if defined(__linux__) && defined(SYNC_FILE_RANGE_WRITE)
+    /* (POSIX_FADV_DONTNEED skips dirty pages; wait for writeback first) */
+    (void)sync_file_range(m->fd, (off_t)off, (off_t)(end - off),
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+                          | SYNC_FILE_RANGE_WAIT_AFTER);
+  #endif
+  #ifdef POSIX_FADV_DONTNEED
+    (void)posix_fadvise(m->fd, (off_t)off, (off_t)(end - off),
+                        POSIX_FADV_DONTNEED);
+  #else
+    (void)m;
+    (void)off;
+    (void)end;
+  #endif
+}
+
+__attribute_noinline__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_fgrow(struct mcdb_make * const restrict m, const size_t fsz);
+
+__attribute_noinline__
+static bool
+mcdb_make_fgrow(struct mcdb_make * const restrict m, const size_t fsz)
+{
+    m->fsz = fsz;
+  #if defined(__GLIBC__)/* glibc emulates if not natively supported by fs */
+    if ((errno = posix_fallocate(m->fd, (off_t)m->osz,
+                                 (off_t)(m->fsz-m->osz))) == 0)
+  #elif defined(__SunOS_5_11)/*not sure about Solaris 11; not tested by me*/
+    /* disabled for defined(_AIX) since mcdb_make_fallocate() is faster
+     * and because posix_fallocate() in 32-bit can result in SIGSEGV.
+     * Observed on AIX TL6 SP3: posix_fallocate() fails on initial resize
+     * and mcdb_make_fallocate() succeeds, but then posix_fallocate()
+     * returns 0 on second call to extend file, but later access invalid.
+     * Prior issues others had with posix_fallocate() on AIX:
+     * http://thr3ads.net/dovecot/2009/07/1089409-AIX-and-posix_fallocate
+     * https://www-304.ibm.com/support/docview.wss?uid=isg1IZ46957 */
+    /*defined(_AIX)*//*AIX errno=ENOTSUP if not natively supported by fs*/
+    if ((errno = posix_fallocate(m->fd, (off_t)m->osz,
+                                 (off_t)(m->fsz-m->osz))) == 0
+        || (errno != ENOSPC
+            && (errno = mcdb_make_fallocate(m->fd, (off_t)m->osz,
+                                            (off_t)(m->fsz-m->osz))) == 0))
+  #else /*emulate posix_fallocate() on earlier __sun, on __hpux and others*/
+    if ((errno = mcdb_make_fallocate(m->fd, (off_t)m->osz,
+                                     (off_t)(m->fsz-m->osz))) == 0)
+  #endif
+        m->osz = m->fsz;
+    else
+        return false;
+    return true;
+}
+
 __attribute_noinline__
 __attribute_nonnull__()
 __attribute_warn_unused_result__
@@ -267,8 +450,9 @@ static bool
 mcdb_mmap_upsize(struct mcdb_make * const restrict m, const size_t sz,
                  const bool sequential)
 {
-    const size_t offset = m->pos & m->pgalign; /* mmap offset must be aligned */
+    size_t offset = m->pos & m->pgalign; /* mmap offset must be aligned */
     size_t msz;
+    char *map;
 
     /*(caller should check size and not call upsize unless resize needed)*/
     /*(avoid overhead of less-frequently called subroutine; marked noinline)*/
@@ -278,45 +462,50 @@ mcdb_mmap_upsize(struct mcdb_make * const restrict m, const size_t sz,
     if (sz > (UINT_MAX & m->pgalign)) { errno = EOVERFLOW; return false; }
   #endif
 
-    msz = (MCDB_MMAP_SZ > sz - offset)
-      ? MCDB_MMAP_SZ
-      : (sz - offset + ~m->pgalign) & m->pgalign;
+    /* (records before m->pos are complete while adding records (sequential))*/
+    if (sequential && m->pos > m->wbpos && m->pos - m->wbpos >= MCDB_BLOCK_SZ)
+        mcdb_make_writeback(m, m->pos & m->pgalign);
+
+    /* grow current mmap (at least doubling) while it fits in MCDB_MMAP_MAX,
+     * else slide mmap (of same size) to current position.  Mapping is replaced
+     * once per MCDB_MMAP_MAX written instead of once per MCDB_MMAP_SZ, and
+     * file is extended per mapping.
+     * (not if m->fd == -1; large mcdb size tests discard mmap as it slides) */
+    if (m->map == MAP_FAILED || m->fd == -1)
+        msz = MCDB_MMAP_SZ;
+    else if (sz - m->offset <= MCDB_MMAP_MAX) {
+        offset = m->offset;
+        msz = (m->msz < (MCDB_MMAP_MAX >> 1)) ? m->msz << 1 : MCDB_MMAP_MAX;
+    }
+    else
+        msz = m->msz;
+    if (msz < sz - offset)
+        msz = (sz - offset + ~m->pgalign) & m->pgalign;
   #if !defined(_LP64) && !defined(__LP64__)  /* (no 4 GB limit in 64-bit) */
     if (offset > (UINT_MAX & m->pgalign) - msz)
         msz = (UINT_MAX & m->pgalign) - offset;
   #endif
 
     /* increase file size by at least msz (prefer multiple of disk block size)
-     * (reduce to MCDB_MMAP_SZ for 1st (and maybe 2nd) mmap for small mcdb) */
-    if (m->fd != -1 && m->fsz < offset + msz) {
-        m->fsz = (m->offset != 0)
+     * (reduce to MCDB_MMAP_SZ for 1st (and maybe 2nd) mmap for small mcdb)
+     * (file may have been preallocated larger by mcdb_make_start_sized()) */
+    if (m->fd != -1 && m->fsz < offset + msz
+        && !mcdb_make_fgrow(m, (m->offset != 0 || msz > MCDB_MMAP_SZ)
           ? ((offset + msz + (MCDB_BLOCK_SZ-1)) & ~(size_t)(MCDB_BLOCK_SZ-1))
-          : ((offset + msz + (MCDB_MMAP_SZ-1))  & ~(size_t)(MCDB_MMAP_SZ-1));
-      #if defined(__GLIBC__)/* glibc emulates if not natively supported by fs */
-        if ((errno = posix_fallocate(m->fd, (off_t)m->osz,
-                                     (off_t)(m->fsz-m->osz))) == 0)
-      #elif defined(__SunOS_5_11)/*not sure about Solaris 11; not tested by me*/
-        /* disabled for defined(_AIX) since mcdb_make_fallocate() is faster
-         * and because posix_fallocate() in 32-bit can result in SIGSEGV.
-         * Observed on AIX TL6 SP3: posix_fallocate() fails on initial resize
-         * and mcdb_make_fallocate() succeeds, but then posix_fallocate()
-         * returns 0 on second call to extend file, but later access invalid.
-         * Prior issues others had with posix_fallocate() on AIX:
-         * http://thr3ads.net/dovecot/2009/07/1089409-AIX-and-posix_fallocate
-         * https://www-304.ibm.com/support/docview.wss?uid=isg1IZ46957 */
-        /*defined(_AIX)*//*AIX errno=ENOTSUP if not natively supported by fs*/
-        if ((errno = posix_fallocate(m->fd, (off_t)m->osz,
-                                     (off_t)(m->fsz-m->osz))) == 0
-            || (errno != ENOSPC
-                && (errno = mcdb_make_fallocate(m->fd, (off_t)m->osz,
-                                                (off_t)(m->fsz-m->osz))) == 0))
-      #else /*emulate posix_fallocate() on earlier __sun, on __hpux and others*/
-        if ((errno = mcdb_make_fallocate(m->fd, (off_t)m->osz,
-                                         (off_t)(m->fsz-m->osz))) == 0)
+          : ((offset + msz + (MCDB_MMAP_SZ-1))  & ~(size_t)(MCDB_MMAP_SZ-1))))
+        return false;
+
+    if (m->map != MAP_FAILED && offset == m->offset) {
+      #if defined(__linux__) && defined(MREMAP_MAYMOVE)
+        /* grow mmap in place (or move it; no need to msync, munmap, mmap) */
+        map = (char *)mremap(m->map, m->msz, msz, MREMAP_MAYMOVE);
+        if (map == MAP_FAILED) return false;
+        m->map = map;
+        m->msz = msz;
+        if (sequential)
+            posix_madvise(m->map, msz, POSIX_MADV_SEQUENTIAL);
+        return true;
       #endif
-            m->osz = m->fsz;
-        else
-            return false;
     }
 
     /* flush and munmap prior mmap */
@@ -328,13 +517,16 @@ mcdb_mmap_upsize(struct mcdb_make * const restrict m, const size_t sz,
             m->map = MAP_FAILED;
         else
             return false;
+        if (m->nocache && m->fd != -1 && offset > m->offset)
+            mcdb_make_dropcache(m, m->offset, offset);
     }
 
     /* (compilation with large file support enables off_t max > 2 GB in cast) */
-    m->map = (m->fd != -1) /* (m->fd == -1 during some large mcdb size tests) */
+    map = (m->fd != -1) /* (m->fd == -1 during some large mcdb size tests) */
       ? (char *)mmap(0, msz, PROT_WRITE, MAP_SHARED, m->fd, (off_t)offset)
       : (char *)mmap(0, msz, PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
-    if (m->map == MAP_FAILED) return false;
+    if (map == MAP_FAILED) return false;
+    m->map = map;
     m->offset = offset;
     m->msz = msz;
     if (sequential)
@@ -384,19 +576,67 @@ mcdb_make_addbuf_key(struct mcdb_make * const restrict m,
 {
     /* len validated in mcdb_make_addbegin(); passing any other len is wrong,
      * unless the len is shorter from partial contents of buf. */
-    m->hp.h = (m->hash_fn == uint32_hash_djb)
-      ? uint32_hash_djb(m->hp.h, buf, len)
-      : m->hash_fn(m->hp.h, buf, len);
+    if (m->hash_fn == uint32_hash_djb)
+        m->hp.h = uint32_hash_djb(m->hp.h, buf, len);
+    else if (m->hash_fn != uint32_hash_xxh32_key) /*(xxh32 in addend)*/
+        m->hp.h = m->hash_fn(m->hp.h, buf, len);
     mcdb_make_addbuf_data(m, buf, len);
 }
 
+/* alias record (see mcdb.h): d is distance from d (at p) to data aliased */
+#define mcdb_make_alias_dist(p,d) \
+  (uint32_strpack_bigendian_macro((p),(uint32_t)((uint64_t)(d) >> 32)), \
+   uint32_strpack_bigendian_macro((p)+4,(uint32_t)(d)))
+
+/* replace data of record just added with alias to data of prior record added
+ * if data is the same and prior data is still mapped (see mcdb_make_dedup())*/
+__attribute_noinline__
+__attribute_nonnull__()
+static void
+mcdb_make_dedup_rec(struct mcdb_make * const restrict m);
+
+static void
+mcdb_make_dedup_rec(struct mcdb_make * const restrict m)
+{
+    char * const restrict p = m->map + m->hp.p - m->offset;
+    const size_t dpos = m->hp.p + 8 + uint32_strunpack_bigendian_macro(p);
+    const uint32_t dlen = uint32_strunpack_bigendian_macro(p+4);
+    if (dlen & MCDB_DLEN_ALIAS)  /*(mcdb_make_add_alias())*/
+        return;
+    if (dlen == m->adlen && dlen > 8 && m->adpos != 0 && m->adpos >= m->offset
+        && memcmp(m->map + m->adpos - m->offset,
+                  m->map + dpos - m->offset, dlen) == 0) {
+        uint32_strpack_bigendian_macro(p+4, MCDB_DLEN_ALIAS | dlen);
+        mcdb_make_alias_dist(m->map + dpos - m->offset, dpos - m->adpos);
+        m->pos = dpos + 8;
+        m->features |= MCDB_FEATURE_ALIAS;
+    }
+    else {
+        m->adpos = dpos;
+        m->adlen = dlen;
+    }
+}
+
 void  inline
 mcdb_make_addend(struct mcdb_make * const restrict m)
 {
     /* copy hp data structure into list for hp slot mask */
-    const uint32_t slot_idx = m->hp.h & MCDB_SLOT_MASK;
-    const uint32_t i = m->head[slot_idx]->num++;
+    uint32_t slot_idx;
+    uint32_t i;
+    if (m->dedup)
+        mcdb_make_dedup_rec(m);
+    if (m->hash_fn == uint32_hash_xxh32_key) /* (hash is not incremental;
+        * key is complete and mapped (record mapped in mcdb_make_addbegin())) */
+        m->hp.h = uint32_hash_xxh32_key(m->hash_init,
+                                        m->map + m->hp.p + 8 - m->offset,
+                                        m->hp.l);
+    slot_idx = m->hp.h & MCDB_SLOT_MASK;
+    i = m->head[slot_idx]->num++;
     m->head[slot_idx]->hp[i] = m->hp;
+    if (m->index == MCDB_INDEX_MPH) /*(hi 32 bits of 64-bit key hash for mph)*/
+        m->head[slot_idx]->hp[i].l =      /*(replaces klen; see mcdb.h)*/
+          uint32_hash_xxh32_key(MCDB_MPH_HASH_HI(m->hash_init),
+                                m->map + m->hp.p + 8 - m->offset, m->hp.l);
     ++m->count[slot_idx];
     if (i == MCDB_HPLIST-1)
         m->hp.l = ~0; /* set flag for mcdb_make_start() to allocate lists */
@@ -406,6 +646,8 @@ void  inline
 mcdb_make_addrevert(struct mcdb_make * const restrict m)
 {   /* e.g. discard in-progress incremental addbuf, or immediately prior add */
     m->pos = m->hp.p;  /* addrevert can be used up until next add or addbegin */
+    if (m->adpos > m->pos)
+        m->adpos = 0;
 }
 
 int
@@ -422,6 +664,62 @@ mcdb_make_add(struct mcdb_make * const restrict m,
     return -1;
 }
 
+int
+mcdb_make_add_alias(struct mcdb_make * const restrict m,
+                    const char * const restrict key, const size_t keylen)
+{
+    /* alias record for key to data of record most recently added */
+    char d[8];
+    const char *p;
+    size_t dpos;
+    uint32_t dlen;
+    if (m->map == MAP_FAILED || m->pos == m->hp.p /*(no record just added)*/
+        || m->unique != MCDB_MAKE_UNIQUE_NONE)
+        return mcdb_make_err(NULL, EINVAL);
+    p = m->map + m->hp.p - m->offset;
+    dpos = m->hp.p + 8 + uint32_strunpack_bigendian_macro(p);
+    dlen = uint32_strunpack_bigendian_macro(p+4);
+    if (dlen & MCDB_DLEN_ALIAS) {  /*(alias of alias is alias of data)*/
+        dpos -= (size_t)mcdb_alias_dist(m->map + dpos - m->offset);
+        dlen &= ~MCDB_DLEN_ALIAS;
+    }
+    else if (dlen <= 8) {          /*(data no larger than alias; copy)*/
+        memcpy(d, m->map + dpos - m->offset, dlen);
+        return mcdb_make_add(m, key, keylen, d, dlen);
+    }
+    if (mcdb_make_addbegin(m, keylen, 8) != 0)
+        return -1;
+    uint32_strpack_bigendian_macro(m->map + m->hp.p + 4 - m->offset,
+                                   MCDB_DLEN_ALIAS | dlen);
+    mcdb_make_addbuf_key(m, key, keylen);
+    mcdb_make_alias_dist(d, m->pos - dpos);
+    mcdb_make_addbuf_data(m, d, 8);
+    m->features |= MCDB_FEATURE_ALIAS;
+    mcdb_make_addend(m);
+    return 0;
+}
+
+#ifndef MCDB_FILL_PART_MIN
+#define MCDB_FILL_PART_MIN    (16u << 20) /* 16 MB */
+#endif
+
+/* slot hash table size (bytes) above which table is filled partitioned
+ * (see MCDB_FILL_WINDOW_BITS); $MCDB_FILL_PART_MIN overrides default */
+__attribute_cold__
+static size_t
+mcdb_make_fill_part_min(void);
+
+static size_t
+mcdb_make_fill_part_min(void)
+{
+    const char * const s = getenv("MCDB_FILL_PART_MIN");
+    char *e;
+    unsigned long n;
+    if (s != NULL && *s != '\0' && (n = strtoul(s, &e, 10), *e == '\0'))
+        return (size_t)n;
+    return MCDB_FILL_PART_MIN;
+}
+
 /* Note: it is recommended that fd be the fd returned from a call to mkstemp()
  * and that the temporary file be renamed (by the caller) upon success */
 int
@@ -432,10 +730,24 @@ mcdb_make_start(struct mcdb_make * const restrict m, const int fd,
     m->pos       = MCDB_HEADER_SZ;
     m->offset    = 0;
     m->hash_init = UINT32_HASH_DJB_INIT;
+    m->hash_id   = MCDB_HASH_DJB;
     m->hash_fn   = uint32_hash_djb;
+    m->filter_bits = 0;
+    m->index     = MCDB_INDEX_HASH;
+    m->sparse_sz = 0;
+    m->nthreads  = 1;
+    m->fill_part_min = mcdb_make_fill_part_min();
+    m->nocache   = false;
+    m->dedup     = false;
+    m->unique    = MCDB_MAKE_UNIQUE_NONE;
+    m->features  = 0;
+    m->adlen     = 0;
+    m->adpos     = 0;
+    m->spill     = NULL;
     m->fsz       = 0;
     m->osz       = 0;
     m->msz       = 0;
+    m->wbpos     = MCDB_HEADER_SZ;
     m->hp.p      = MCDB_HEADER_SZ;
     m->hp.h      = 0;
     m->hp.l      = 0;
@@ -464,6 +776,1269 @@ mcdb_make_start(struct mcdb_make * const restrict m, const int fd,
     }
 }
 
+/* mcdb_make_start() and preallocate file of expected size sz (bytes) at once
+ * (file is extended as needed if mcdb grows larger; truncated to size upon
+ *  mcdb_make_finish() if smaller) */
+int
+mcdb_make_start_sized(struct mcdb_make * const restrict m, const int fd,
+                      size_t sz, void * (*fn_malloc)(size_t),
+                      void (*fn_free)(void *))
+{
+    if (mcdb_make_start(m, fd, fn_malloc, fn_free) != 0) return -1;
+  #if !defined(_LP64) && !defined(__LP64__)  /* (no 4 GB limit in 64-bit) */
+    if (sz > (UINT_MAX & m->pgalign)) sz = (UINT_MAX & m->pgalign);
+  #endif
+    sz = (sz + (MCDB_BLOCK_SZ-1)) & ~(size_t)(MCDB_BLOCK_SZ-1);
+    if (fd != -1 && m->fsz < sz && !mcdb_make_fgrow(m, sz))
+        return mcdb_make_err(m, errno);
+    return 0;
+}
+
+/* per-thread builder handle (see mcdb_make.h)
+ * h appends records to its own data region in spill file fd (at same offsets
+ * as in an mcdb, i.e. starting at MCDB_HEADER_SZ) and has its own hplists */
+int
+mcdb_make_thread_start(struct mcdb_make * const restrict h,
+                       const struct mcdb_make * const restrict m, const int fd)
+{
+    if (fd == -1 || m->map == MAP_FAILED)     return mcdb_make_err(NULL,EINVAL);
+    if (mcdb_make_start(h, fd, m->fn_malloc, m->fn_free) != 0) return -1;
+    h->hash_init = m->hash_init;
+    h->hash_id   = m->hash_id;
+    h->hash_fn   = m->hash_fn;
+    h->index     = m->index;
+    h->dedup     = m->dedup;
+    h->wbpos     = ~(size_t)0; /* no writeback of spill file */
+    return 0;
+}
+
+/* append records of h to m; h is destroyed (whether or not successful)
+ * (data region of h is copied to end of m and positions in hp rebased; hp of h
+ *  are appended to hplists of m in the order added to h, so the result is
+ *  identical to adding records of h to m directly, after all prior records) */
+int
+mcdb_make_thread_merge(struct mcdb_make * const restrict m,
+                       struct mcdb_make * const restrict h)
+{
+    struct mcdb_hplist *x;
+    struct mcdb_hplist *n;
+    struct mcdb_hplist *node;
+    size_t pos = MCDB_HEADER_SZ;
+    const size_t delta = m->pos - MCDB_HEADER_SZ;
+    uint64_t nrecs = 0;
+    uint32_t i;
+    uint32_t j;
+    if (m->map == MAP_FAILED || h->map == MAP_FAILED || h->fd == -1
+        || h->hash_init != m->hash_init || h->hash_fn != m->hash_fn
+        || h->index != m->index) {
+        mcdb_make_destroy(h);
+        return mcdb_make_err(NULL, EINVAL);
+    }
+  #if !defined(_LP64) && !defined(__LP64__)  /* (no 4 GB limit in 64-bit) */
+    if (m->pos > UINT_MAX - (h->pos - MCDB_HEADER_SZ)) {
+        mcdb_make_destroy(h);
+        return mcdb_make_err(NULL, ENOMEM);
+    }
+  #endif
+
+    /* check combined record counts before modifying m (same limits as are
+     * checked in mcdb_hplist_alloc() as records are added, but exact here):
+     * total records < INT_MAX, or with spill, per slot (count << 1 fits) */
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        const uint64_t c = (uint64_t)m->count[i] + h->count[i];
+        nrecs += c;
+        if (m->spill != NULL ? c > INT_MAX - MCDB_HPLIST : nrecs >= INT_MAX) {
+            mcdb_make_destroy(h);
+            return mcdb_make_err(NULL, ENOMEM);
+        }
+    }
+
+    /* copy data region (records written to mmap of h->fd are visible to pread
+     * with unified VM page cache; see comments in mcdb_mmap_commit()) */
+    while (pos < h->pos) {
+        ssize_t r;
+        const size_t len = (h->pos - pos < MCDB_BLOCK_SZ)
+          ? h->pos - pos
+          : MCDB_BLOCK_SZ;
+        if (m->offset+m->msz < m->pos+len
+            && !mcdb_mmap_upsize(m, m->pos+len, true))
+            break;
+        r = pread(h->fd, m->map + m->pos - m->offset, len, (off_t)pos);
+        if (r > 0) {
+            pos    += (size_t)r;
+            m->pos += (size_t)r;
+        }
+        else if (r == 0 || errno != EINTR) {
+            if (r == 0) errno = EIO;
+            break;
+        }
+    }
+    if (pos != h->pos) {
+        mcdb_make_destroy(h);
+        return mcdb_make_err(NULL, errno);
+    }
+
+    /* (allocate lists deferred by flag set in mcdb_make_addend()) */
+    if (m->hp.l == ~0 && !mcdb_hplist_alloc(m)) {
+        mcdb_make_destroy(h);
+        return mcdb_make_err(NULL, errno);
+    }
+
+    /* append hp to lists for each slot, rebasing offsets of records
+     * (lists of h are newest first; reverse each list to walk in add order)
+     * (lists of m are kept non-full, allocating when filled, instead of
+     *  deferring allocation to next mcdb_make_addbegin() with flag) */
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        struct mcdb_hplist * const pend = h->head[i]->pend;
+        for (x = NULL, node = h->head[i]; node; node = n) {
+            n = node->next;
+            node->next = x;
+            x = node;
+        }
+        h->head[i] = x;
+        x->pend = pend;  /*(preserve for mcdb_make_destroy() of h)*/
+        for (; x; x = x->next) {
+            for (j = 0; j < x->num; ++j) {
+                node = m->head[i];
+                node->hp[node->num] = x->hp[j];
+                node->hp[node->num].p += delta;
+                ++m->count[i];
+                if (++node->num == MCDB_HPLIST) {
+                    m->hp.h = i;
+                    if (!mcdb_hplist_alloc(m)) {
+                        m->hp.l = ~0;
+                        mcdb_make_destroy(h);
+                        return mcdb_make_err(NULL, errno);
+                    }
+                }
+            }
+        }
+    }
+    m->hp.p = m->pos;
+    m->hp.l = 0;
+    m->adpos = 0;
+    m->features |= h->features;
+
+    mcdb_make_destroy(h);
+    return 0;
+}
+
+/* pass hp entries of slot i to fn, one hplist at a time, in the same order
+ * with or without spill: hplists in memory (newest first) and then hplists
+ * read back from spill file of slot (newest first) (see mcdb_make_spill()) */
+__attribute_nonnull__((1,3))
+__attribute_warn_unused_result__
+static bool
+mcdb_make_slot_hp(const struct mcdb_make * const restrict m, const uint32_t i,
+                  void (*fn)(void *, const struct mcdb_hp *, uint32_t),
+                  void * const arg);
+
+static bool
+mcdb_make_slot_hp(const struct mcdb_make * const restrict m, const uint32_t i,
+                  void (*fn)(void *, const struct mcdb_hp *, uint32_t),
+                  void * const arg)
+{
+    const size_t sz = sizeof(struct mcdb_hp) * MCDB_HPLIST;
+    struct mcdb_hp *buf;
+    uint32_t n;
+    for (const struct mcdb_hplist *x = m->head[i]; x; x = x->next)
+        fn(arg, x->hp, x->num);
+    if (m->spill == NULL || (n = m->spill->nspill[i]) == 0)
+        return true;
+    buf = (struct mcdb_hp *)m->fn_malloc(sz * MCDB_SPILL_CHUNK);
+    if (buf == NULL) { errno = ENOMEM; return false; }
+    while (n) {
+        const uint32_t k = n < MCDB_SPILL_CHUNK ? n : MCDB_SPILL_CHUNK;
+        size_t len = sz * k;
+        size_t rd = 0;
+        ssize_t r;
+        n -= k;
+        do {
+            r = pread(m->spill->fd[i], (char *)buf + rd, len - rd,
+                      (off_t)((uint64_t)n * sz + rd));
+        } while (r > 0 ? (rd += (size_t)r) < len : (r == -1 && errno == EINTR));
+        if (rd != len) {
+            if (r == 0) errno = EIO;
+            m->fn_free(buf);
+            return false;
+        }
+        for (uint32_t j = k; j; --j)
+            fn(arg, buf + (size_t)(j-1) * MCDB_HPLIST, MCDB_HPLIST);
+    }
+    m->fn_free(buf);
+    return true;
+}
+
+/* minimal perfect hash index (see mcdb.h)
+ * (PTHash-style: keys distributed into buckets of avg MCDB_MPH_LAMBDA keys;
+ *  buckets processed largest first, searching for 16-bit pilot that places
+ *  all keys in bucket in free positions; load factor approx 0.95 and then
+ *  positions >= n remapped to free positions < n for minimal index)
+ * (memory: 16 bytes per record (64-bit) in addition to hplists) */
+
+#define MCDB_MPH_LAMBDA 4u   /* avg num keys per bucket */
+#define MCDB_MPH_SEEDS  16u  /* num pilot seeds tried before failing */
+
+struct mcdb_make_mph {
+  uintptr_t pos;             /* offset of mph section */
+  uint32_t n;                /* num keys (entries) */
+  uint32_t nb;               /* num buckets (pilots) */
+  uint32_t m;                /* num positions (before remap) */
+  uint32_t seed;             /* pilot seed */
+  uint32_t b;                /* entry size bits (3 or 4) */
+};
+
+#define mcdb_make_mph_taken(t,q) ((t)[(q)>>6] & (UINT64_C(1) << ((q) & 63)))
+
+/* position of key (before remap) for pilot mix pm */
+__attribute_nonnull__()
+__attribute_pure__
+static inline uint32_t
+mcdb_make_mph_pos(const struct mcdb_hp * const restrict hp, uint64_t pm,
+                  const uint32_t mm);
+
+static inline uint32_t
+mcdb_make_mph_pos(const struct mcdb_hp * const restrict hp, uint64_t pm,
+                  const uint32_t mm)
+{
+    pm ^= ((uint64_t)hp->l << 32) | hp->h;
+    mcdb_mph_fmix64(pm);
+    return mcdb_mph_pos(pm, mm);
+}
+
+/* map data section of mcdb under construction read-only (to compare keys)
+ * (not possible if m->fd == -1; data not retained after window is unmapped)*/
+__attribute_noinline__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static const unsigned char *
+mcdb_make_mph_romap(const struct mcdb_make * const restrict m,
+                    const uintptr_t dend);
+
+static const unsigned char *
+mcdb_make_mph_romap(const struct mcdb_make * const restrict m,
+                    const uintptr_t dend)
+{
+    void * const x = (m->fd != -1)
+      ? mmap(0, (size_t)dend, PROT_READ, MAP_SHARED, m->fd, 0)
+      : MAP_FAILED;
+    if (m->fd == -1)
+        errno = EINVAL;
+    return (x != MAP_FAILED) ? (const unsigned char *)x : NULL;
+}
+
+__attribute_noinline__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_mph(struct mcdb_make * const restrict m, const uint32_t nrecs,
+              const uintptr_t dend, struct mcdb_make_mph * const restrict h);
+
+static bool
+mcdb_make_mph(struct mcdb_make * const restrict m, const uint32_t nrecs,
+              const uintptr_t dend, struct mcdb_make_mph * const restrict h)
+{
+    struct mcdb_hp * restrict kh = NULL;
+    uint32_t * restrict boff = NULL;
+    uint32_t * restrict order = NULL;
+    uint32_t * restrict pos = NULL;
+    uint16_t * restrict pilots = NULL;
+    uint64_t * restrict taken = NULL;
+    const unsigned char *ro = NULL;
+    unsigned char * restrict p;
+    uint64_t pm;
+    uintptr_t total = 0;
+    uint32_t i, j, k, c, q, t, nb, mm, n, pilot, nbo;
+    uint32_t maxsz = 0;
+    bool rc = false;
+
+    h->pos = m->pos;
+    h->b   = (dend < UINT_MAX) ? 3u : 4u;
+    if (nrecs == 0)
+        return true;  /*(empty mph index; n == 0)*/
+    h->nb = nb = nrecs / MCDB_MPH_LAMBDA + 1;
+
+    kh     = (struct mcdb_hp *)m->fn_malloc(nrecs*sizeof(struct mcdb_hp));
+    boff   = (uint32_t *)m->fn_malloc(((size_t)nb+1) * sizeof(uint32_t));
+    order  = (uint32_t *)m->fn_malloc((size_t)nb * sizeof(uint32_t));
+    pilots = (uint16_t *)m->fn_malloc((size_t)nb * sizeof(uint16_t));
+    if (!kh || !boff || !order || !pilots) { errno = ENOMEM; goto done; }
+
+    /* counting sort of keys into buckets */
+    memset(boff, 0, ((size_t)nb+1) * sizeof(uint32_t));
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        for (const struct mcdb_hplist *x = m->head[i]; x; x = x->next) {
+            for (j = 0; j < x->num; ++j)
+                ++boff[mcdb_mph_bucket(x->hp[j].l, x->hp[j].h, nb)+1];
+        }
+    }
+    for (j = 0; j < nb; ++j)
+        boff[j+1] += boff[j];
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        for (const struct mcdb_hplist *x = m->head[i]; x; x = x->next) {
+            for (j = 0; j < x->num; ++j)
+                kh[boff[mcdb_mph_bucket(x->hp[j].l,x->hp[j].h,nb)]++]=x->hp[j];
+        }
+    }
+    for (j = nb; j; --j)
+        boff[j] = boff[j-1];
+    boff[0] = 0;
+
+    /* sort keys in each bucket by 64-bit hash, then by position (dpos);
+     * drop later records with duplicate keys (p = 0) (keep first added) */
+    n = nrecs;
+    for (j = 0; j < nb; ++j) {
+        for (i = boff[j]+1; i < boff[j+1]; ++i) {
+            const struct mcdb_hp e = kh[i];
+            for (k = i; k > boff[j]
+                        && (kh[k-1].l > e.l
+                            || (kh[k-1].l == e.l
+                                && (kh[k-1].h > e.h
+                                    || (kh[k-1].h == e.h && kh[k-1].p > e.p))));
+                 --k)
+                kh[k] = kh[k-1];
+            kh[k] = e;
+        }
+        for (c = 0, i = boff[j]; i < boff[j+1]; ++i) {
+            if (i != boff[j] && kh[i].l == kh[i-1].l && kh[i].h == kh[i-1].h) {
+                for (k = i-1; kh[k].p == 0; --k) ;
+                if (ro == NULL && (ro = mcdb_make_mph_romap(m, dend)) == NULL)
+                    goto done;
+                q = uint32_strunpack_bigendian_macro(ro+kh[k].p);
+                if (q != uint32_strunpack_bigendian_macro(ro+kh[i].p)
+                    || memcmp(ro+kh[k].p+8, ro+kh[i].p+8, q) != 0) {
+                    errno = EINVAL; /*(64-bit hash collision, distinct keys)*/
+                    goto done;
+                }
+                kh[i].p = 0;
+                --n;
+            }
+            else
+                ++c;
+        }
+        if (maxsz < c)
+            maxsz = c;
+    }
+
+    /* order buckets largest first (counting sort by num keys in bucket) */
+    pos = (uint32_t *)m->fn_malloc(((size_t)maxsz+2) * sizeof(uint32_t));
+    if (!pos) { errno = ENOMEM; goto done; }
+    memset(pos, 0, ((size_t)maxsz+2) * sizeof(uint32_t));
+    for (j = 0; j < nb; ++j) {
+        for (c = 0, i = boff[j]; i < boff[j+1]; ++i)
+            c += (kh[i].p != 0);
+        ++pos[maxsz-c+1];
+        pilots[j] = 0;
+    }
+    for (c = 0; c <= maxsz; ++c)
+        pos[c+1] += pos[c];
+    nbo = pos[maxsz];  /*(num non-empty buckets)*/
+    for (j = 0; j < nb; ++j) {
+        for (c = 0, i = boff[j]; i < boff[j+1]; ++i)
+            c += (kh[i].p != 0);
+        order[pos[maxsz-c]++] = j;
+    }
+
+    /* search for pilot for each bucket */
+    h->n = n;
+    h->m = mm = n + n / 20u + 1u;  /* load factor approx 0.95 */
+    taken = (uint64_t *)m->fn_malloc((((size_t)mm+63)>>6) * sizeof(uint64_t));
+    if (!taken) { errno = ENOMEM; goto done; }
+    for (h->seed = 0; h->seed < MCDB_MPH_SEEDS; ++h->seed) {
+        memset(taken, 0, (((size_t)mm+63)>>6) * sizeof(uint64_t));
+        for (k = 0; k < nbo; ++k) {
+            j = order[k];
+            for (pilot = 0; pilot <= 0xFFFFu; ++pilot) {
+                pm = ((uint64_t)h->seed << 32) | pilot;
+                mcdb_mph_fmix64(pm);
+                for (c = 0, i = boff[j]; i < boff[j+1]; ++i) {
+                    if (kh[i].p == 0) continue;
+                    q = mcdb_make_mph_pos(kh+i, pm, mm);
+                    if (mcdb_make_mph_taken(taken, q)) break;
+                    for (t = 0; t < c && pos[t] != q; ++t) ;
+                    if (t != c) break;
+                    pos[c++] = q;
+                }
+                if (i == boff[j+1]) break;
+            }
+            if (pilot > 0xFFFFu) break;
+            pilots[j] = (uint16_t)pilot;
+            for (t = 0; t < c; ++t)
+                taken[pos[t]>>6] |= (UINT64_C(1) << (pos[t] & 63));
+        }
+        if (k == nbo) break;
+    }
+    if (h->seed == MCDB_MPH_SEEDS) { errno = EAGAIN; goto done; }
+
+    /* write mph section: pilots, remap, entries (see mcdb.h) */
+    total = (((uintptr_t)nb << 1) + 15u) & ~(uintptr_t)15u;
+    c = (uint32_t)total;  /*(offset of remap)*/
+    total += (((uintptr_t)(mm - n) << 2) + 15u) & ~(uintptr_t)15u;
+    k = (uint32_t)total;  /*(offset of entries)*/
+    total += (uintptr_t)n << h->b;
+  #if !defined(_LP64) && !defined(__LP64__)
+    if (total > UINT_MAX - m->pos) { errno = ENOMEM; goto done; }
+  #endif
+    if (m->offset+m->msz < m->pos+total
+        && !mcdb_mmap_upsize(m, m->pos+total, false))
+        goto done;
+    p = (unsigned char *)m->map + m->pos - m->offset;
+    memset(p, 0, (size_t)total);
+    for (j = 0; j < nb; ++j) {
+        p[j<<1]     = (unsigned char)(pilots[j] >> 8);
+        p[(j<<1)+1] = (unsigned char)(pilots[j]);
+    }
+    for (q = 0, t = n; t < mm; ++t) {
+        if (mcdb_make_mph_taken(taken, t)) {
+            while (mcdb_make_mph_taken(taken, q))
+                ++q;
+            uint32_strpack_bigendian_aligned_macro(p+c+((t-n)<<2), q);
+            ++q;
+        }
+    }
+    if (h->b == 4 && ro == NULL && (ro = mcdb_make_mph_romap(m, dend)) == NULL)
+        goto done;
+    for (j = 0; j < nb; ++j) {
+        pm = ((uint64_t)h->seed << 32) | pilots[j];
+        mcdb_mph_fmix64(pm);
+        for (i = boff[j]; i < boff[j+1]; ++i) {
+            unsigned char * restrict ent;
+            if (kh[i].p == 0) continue;
+            q = mcdb_make_mph_pos(kh+i, pm, mm);
+            if (q >= n)
+                q = uint32_strunpack_bigendian_aligned_macro(p+c+((q-n)<<2));
+            ent = p + k + ((uintptr_t)q << h->b);
+            uint32_strpack_bigendian_aligned_macro(ent, kh[i].h);
+            if (h->b == 3)
+                uint32_strpack_bigendian_aligned_macro(ent+4,(uint32_t)kh[i].p);
+            else {
+                uint32_strpack_bigendian_aligned_macro(ent+4,
+                  uint32_strunpack_bigendian_macro(ro+kh[i].p));  /*(klen)*/
+                uint64_strpack_bigendian_aligned_macro(ent+8,(uint64_t)kh[i].p);
+            }
+        }
+    }
+    m->pos += total;
+    rc = true;
+
+  done:
+    if (ro != NULL) {
+        const int errnum = errno;
+        munmap((void *)(uintptr_t)ro, (size_t)dend);
+        errno = errnum;
+    }
+    if (taken)  m->fn_free(taken);
+    if (pos)    m->fn_free(pos);
+    if (pilots) m->fn_free(pilots);
+    if (order)  m->fn_free(order);
+    if (boff)   m->fn_free(boff);
+    if (kh)     m->fn_free(kh);
+    return rc;
+}
+
+/* num bits set per key in negative lookup filter block
+ * (k ~= bits per key * ln 2, limited to 1 <= k <= 16) */
+#define mcdb_make_filter_k(m) \
+  ((m)->filter_bits < 3u ? 1u : (m)->filter_bits > 23u ? 16u \
+   : (m)->filter_bits * 69u / 100u)
+
+/* set filter bits for each key khash (see mcdb.h) */
+struct mcdb_make_filter_arg {
+  unsigned char *filter;
+  uint32_t fn;
+  uint32_t k;
+};
+
+static void
+mcdb_make_filter_fill_hp(void * const arg, const struct mcdb_hp *hp, uint32_t w)
+{
+    unsigned char * const restrict filter =
+      ((struct mcdb_make_filter_arg *)arg)->filter;
+    const uint32_t fn = ((struct mcdb_make_filter_arg *)arg)->fn;
+    const uint32_t k  = ((struct mcdb_make_filter_arg *)arg)->k;
+    for (; w; --w, ++hp) {
+        unsigned char * restrict blk;
+        uint32_t h = hp->h;
+        uint32_t a;
+        uint32_t b;
+        mcdb_filter_remix(h);
+        blk = filter
+            + (uintptr_t)mcdb_filter_block(h,fn) * MCDB_FILTER_BLOCK_SZ;
+        h += 0x9E3779B9u;
+        mcdb_filter_remix(h);
+        a = h >> 23;
+        b = (h >> 14) | 1u;
+        for (uint32_t j = 0; j < k; ++j, a += b)
+            blk[(a & 511u) >> 3] |= (unsigned char)(1u << (a & 7u));
+    }
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_filter_fill(const struct mcdb_make * const restrict m,
+                      unsigned char * const restrict filter, const uint32_t fn);
+
+static bool
+mcdb_make_filter_fill(const struct mcdb_make * const restrict m,
+                      unsigned char * const restrict filter, const uint32_t fn)
+{
+    struct mcdb_make_filter_arg f = { filter, fn, mcdb_make_filter_k(m) };
+    for (uint32_t i = 0; i < MCDB_SLOTS; ++i) {
+        if (!mcdb_make_slot_hp(m, i, mcdb_make_filter_fill_hp, &f))
+            return false;
+    }
+    return true;
+}
+
+/* enable negative lookup filter with bits_per_key (0 disables) (see mcdb.h);
+ * must be called before mcdb_make_finish() */
+int
+mcdb_make_filter(struct mcdb_make * const restrict m,
+                 const uint32_t bits_per_key)
+{
+    if (bits_per_key > 64)                    return mcdb_make_err(NULL,EINVAL);
+    m->filter_bits = bits_per_key;
+    return 0;
+}
+
+/* select index type (MCDB_INDEX_*) (see mcdb.h);
+ * must be called after mcdb_make_start() and before adding first record
+ * (MCDB_INDEX_MPH requires MCDB_HASH_XXH32, which is selected if not already)*/
+int
+mcdb_make_index(struct mcdb_make * const restrict m, const uint32_t index)
+{
+    if (index > MCDB_INDEX_MPH)               return mcdb_make_err(NULL,EINVAL);
+    if (m->pos != MCDB_HEADER_SZ)             return mcdb_make_err(NULL,EINVAL);
+    if (index == MCDB_INDEX_MPH
+        && (m->spill != NULL || m->unique != MCDB_MAKE_UNIQUE_NONE))
+                                              return mcdb_make_err(NULL,EINVAL);
+    if (index == MCDB_INDEX_MPH && m->hash_id != MCDB_HASH_XXH32) {
+        m->hash_id   = MCDB_HASH_XXH32;
+        m->hash_fn   = uint32_hash_xxh32_key;
+    }
+    m->index = index;
+    return 0;
+}
+
+/* enable sparse record offset index with interval of data bytes (0 disables)
+ * (see mcdb.h); must be called before mcdb_make_finish() */
+int
+mcdb_make_sparse(struct mcdb_make * const restrict m, const uint32_t sz)
+{
+    m->sparse_sz = sz;
+    return 0;
+}
+
+/* build slot hash tables in mcdb_make_finish() with up to n threads
+ * (must be called before mcdb_make_finish()) */
+int
+mcdb_make_threads(struct mcdb_make * const restrict m, const uint32_t n)
+{
+    m->nthreads = (n != 0) ? n : 1;
+    return 0;
+}
+
+/* duplicate key policy (MCDB_MAKE_UNIQUE_*) applied in mcdb_make_finish()
+ * (see mcdb_make.h) */
+int
+mcdb_make_unique(struct mcdb_make * const restrict m, const uint32_t policy)
+{
+    if (policy > MCDB_MAKE_UNIQUE_REJECT)     return mcdb_make_err(NULL,EINVAL);
+    if (policy != MCDB_MAKE_UNIQUE_NONE && m->index == MCDB_INDEX_MPH)
+                                              return mcdb_make_err(NULL,EINVAL);
+    if (policy != MCDB_MAKE_UNIQUE_NONE
+        && (m->dedup || (m->features & MCDB_FEATURE_ALIAS)))
+                                              return mcdb_make_err(NULL,EINVAL);
+    m->unique = policy;
+    return 0;
+}
+
+/* alias records with same data as prior record (see mcdb_make.h) */
+int
+mcdb_make_dedup(struct mcdb_make * const restrict m, const bool dedup)
+{
+    if (dedup && m->unique != MCDB_MAKE_UNIQUE_NONE)
+                                              return mcdb_make_err(NULL,EINVAL);
+    m->dedup = dedup;
+    return 0;
+}
+
+/* drop pages of mcdb from page cache once written (see mcdb_make.h) */
+int
+mcdb_make_nocache(struct mcdb_make * const restrict m, const bool nocache)
+{
+    m->nocache = nocache;
+    return 0;
+}
+
+/* spill hp entries to temporary files in dir (NULL: $TMPDIR or /tmp) so that
+ * hplists use approx sz bytes of memory, independent of num records (0: off)
+ * (see mcdb_make.h); must be called before adding first record */
+int
+mcdb_make_spill(struct mcdb_make * const restrict m, const size_t sz,
+                const char * restrict dir)
+{
+    static const char tmpl[] = "/mcdb.spill.XXXXXX";
+    struct mcdb_make_spill * restrict s;
+    size_t len;
+    size_t max;
+    if (m->pos != MCDB_HEADER_SZ)             return mcdb_make_err(NULL,EINVAL);
+    if (m->index == MCDB_INDEX_MPH && sz != 0)return mcdb_make_err(NULL,EINVAL);
+    if (m->spill != NULL) {
+        m->fn_free(m->spill);
+        m->spill = NULL;
+    }
+    if (sz == 0)
+        return 0;
+    if (dir == NULL && (dir = getenv("TMPDIR")) == NULL)
+        dir = "/tmp";
+    len = strlen(dir);
+    s = (struct mcdb_make_spill *)
+      m->fn_malloc(sizeof(struct mcdb_make_spill) + len + sizeof(tmpl));
+    if (s == NULL)                            return mcdb_make_err(NULL,ENOMEM);
+    max = sz / (sizeof(struct mcdb_hplist) * MCDB_SLOTS);
+    s->max = max > 1 ? (max < INT_MAX ? (uint32_t)max : INT_MAX) : 1;
+    for (uint32_t i = 0; i < MCDB_SLOTS; ++i) {
+        s->nmem[i]   = 1;
+        s->nspill[i] = 0;
+        s->fd[i]     = -1;
+    }
+    memcpy(s->tmpl, dir, len);
+    memcpy(s->tmpl+len, tmpl, sizeof(tmpl));
+    m->spill = s;
+    return 0;
+}
+
+/* sparse record offset index (see mcdb.h)
+ * (record offsets are taken from hplists; data section is not read) */
+struct mcdb_make_sparse_arg {
+  uint64_t *ent;
+  uintptr_t sz;
+};
+
+static void
+mcdb_make_sparse_fill_hp(void * const arg, const struct mcdb_hp *hp, uint32_t w)
+{
+    uint64_t * const restrict ent = ((struct mcdb_make_sparse_arg *)arg)->ent;
+    const uintptr_t sz = ((struct mcdb_make_sparse_arg *)arg)->sz;
+    for (; w; --w, ++hp) {
+        uintptr_t k;
+        if (hp->p == 0) continue;  /*(superseded; see mcdb_make_uniq())*/
+        k = (hp->p - MCDB_HEADER_SZ) / sz;
+        if (ent[k] > hp->p)
+            ent[k] = hp->p;
+    }
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_sparse_fill(const struct mcdb_make * const restrict m,
+                      char * const restrict p, const uint32_t n,
+                      const uintptr_t dend);
+
+static bool
+mcdb_make_sparse_fill(const struct mcdb_make * const restrict m,
+                      char * const restrict p, const uint32_t n,
+                      const uintptr_t dend)
+{
+    uint64_t * const restrict ent = (uint64_t *)p; /*(64-byte aligned)*/
+    struct mcdb_make_sparse_arg sa = { ent, m->sparse_sz };
+    uint32_t i;
+    for (i = 0; i < n; ++i)
+        ent[i] = dend;
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        if (!mcdb_make_slot_hp(m, i, mcdb_make_sparse_fill_hp, &sa))
+            return false;
+    }
+    /* interval in which no record begins: first record of following interval*/
+    for (i = n-1; i-- != 0; ) {
+        if (ent[i] > ent[i+1])
+            ent[i] = ent[i+1];
+    }
+    for (i = 0; i < n; ++i) {
+        const uint64_t u = ent[i];
+        uint64_strpack_bigendian_aligned_macro(p+((uintptr_t)i<<3), u);
+    }
+    return true;
+}
+
+/* select hash function (MCDB_HASH_*) and hash init value (seed) to use;
+ * must be called after mcdb_make_start() and before adding first record
+ * (hash id and init are recorded in mcdb header; readers use same hash) */
+int
+mcdb_make_hash(struct mcdb_make * const restrict m,
+               const uint32_t hash_id, const uint32_t hash_init)
+{
+    uint32_t (*hash_fn)(uint32_t, const void * restrict, size_t);
+    switch (hash_id) {
+      case MCDB_HASH_DJB:      hash_fn = uint32_hash_djb;       break;
+      case MCDB_HASH_IDENTITY: hash_fn = uint32_hash_identity;  break;
+      case MCDB_HASH_XXH32:    hash_fn = uint32_hash_xxh32_key; break;
+      default:                                return mcdb_make_err(NULL,EINVAL);
+    }
+    if (m->pos != MCDB_HEADER_SZ)             return mcdb_make_err(NULL,EINVAL);
+    if (m->index == MCDB_INDEX_MPH && hash_id != MCDB_HASH_XXH32)
+                                              return mcdb_make_err(NULL,EINVAL);
+    m->hash_id   = hash_id;
+    m->hash_init = hash_init;
+    m->hash_fn   = hash_fn;
+    return 0;
+}
+
+/* slot hash table entry start position is (khash >> 8) % len (see mcdb.h)
+ * (remainder computed with multiplications instead of division (Lemire,
+ *  Kaser, Kurz, "Faster Remainder by Direct Computation", 2019); exact for
+ *  32-bit operands with M = UINT64_MAX / len + 1, so tables are unchanged) */
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 mcdb_make_uint128_t;
+#define mcdb_make_fastmod_M(d)    (UINT64_C(0xFFFFFFFFFFFFFFFF) / (d) + 1)
+#define mcdb_make_fastmod(x,M,d) \
+  ((uint32_t)(((mcdb_make_uint128_t)((uint64_t)(M) * (x)) * (d)) >> 64))
+#else
+#define mcdb_make_fastmod_M(d)    0
+#define mcdb_make_fastmod(x,M,d)  ((x) % (d))
+#endif
+
+/* slot hash tables larger than m->fill_part_min bytes are filled window by
+ * window (MCDB_FILL_WINDOW_BITS) after radix partitioning entries by start
+ * position, so that probes and writes into table stay within cache (L2)
+ * instead of missing cache on nearly every entry.  (Smaller tables are filled
+ * directly; they stay within last level cache, where partitioning costs more
+ * than it saves.)  Partitioning goes through a software write-combining
+ * buffer per partition (a cache line of entries in memory, or a larger buffer
+ * if partitions are written to spill file of slot).
+ * m->fill_part_min is MCDB_FILL_PART_MIN unless $MCDB_FILL_PART_MIN is set in
+ * environment at mcdb_make_start() (e.g. 0 to partition every table in tests)*/
+#define MCDB_FILL_WINDOW_BITS 18u /* 256 KB */
+#define MCDB_FILL_WC          4u  /* 4 * sizeof(struct mcdb_hp) == 64 (LP64) */
+#define MCDB_FILL_WC_FILE     256u
+
+/* generate hash table for slot, writing directly to mmap
+ * (p is hash table of len entries of (1 << b) bytes) */
+struct mcdb_make_fill {
+  char *p;
+  uint32_t len;
+  uint32_t b;
+  uint64_t M;                /* mcdb_make_fastmod_M(len) */
+  /* (radix partitioning) */
+  uint32_t shift;            /* partition is start position >> shift */
+  uint32_t np;               /* num partitions */
+  uint32_t wcsz;             /* write-combining buffer entries per partition */
+  int err;
+  uint32_t *off;             /* next entry offset per partition */
+  uint32_t *wcn;             /* num entries in buffer per partition */
+  struct mcdb_hp *wc;        /* write-combining buffers (np * wcsz) */
+  struct mcdb_hp *scratch;   /* partitioned entries (NULL if to spill file) */
+  int fd;                    /* spill file of slot (if scratch == NULL) */
+  off_t base;                /* offset of partitioned entries in spill file */
+};
+
+static void
+mcdb_make_slot_fill_hp(void * const arg, const struct mcdb_hp *hp, uint32_t w)
+{
+    char * const restrict p = ((struct mcdb_make_fill *)arg)->p;
+    const uint32_t len = ((struct mcdb_make_fill *)arg)->len;
+    const uint64_t M = ((struct mcdb_make_fill *)arg)->M;
+    char * restrict q;
+    uint32_t u;
+    if (((struct mcdb_make_fill *)arg)->b == 3) {
+        /* data section ends < 4 GB; use 32-bit dpos offset */
+        /* layout in memory: 4-byte khash, 4-byte dpos */
+        for (; w; --w, ++hp) {
+            if (hp->p == 0) continue;  /*(superseded; see mcdb_make_uniq())*/
+            q = p+4;  /*(4 is offset of dpos)*/
+            u = mcdb_make_fastmod(hp->h >> MCDB_SLOT_BITS, M, len);
+            /* find empty entry in open hash table (dpos == 0) */
+            while (*(uint32_t *)(q+((uintptr_t)u<<3)))
+                if (++u == len)
+                    u = 0;
+            q += (u<<3);
+            uint32_strpack_bigendian_aligned_macro(q-4,hp->h); /*khash*/
+            uint32_strpack_bigendian_aligned_macro(q,(uint32_t)hp->p);
+        }                                                      /*dpos*/
+    }
+    else {/*b==4*//* data section crosses 4 GB; need 64-bit dpos offset */
+        /* layout in memory: 4-byte khash, 4-byte klen, 8-byte dpos */
+        for (; w; --w, ++hp) {
+            if (hp->p == 0) continue;  /*(superseded; see mcdb_make_uniq())*/
+            q = p+8;  /*(8 is offset of dpos)*/
+            u = mcdb_make_fastmod(hp->h >> MCDB_SLOT_BITS, M, len);
+            /* find empty entry in open hash table (dpos == 0) */
+            while (*(uintptr_t *)(q+((uintptr_t)u<<4)))
+                if (++u == len)
+                    u = 0;
+            q += (u<<4);
+            uint32_strpack_bigendian_aligned_macro(q-8,hp->h); /*khash*/
+            uint32_strpack_bigendian_aligned_macro(q-4,hp->l); /*klen*/
+            uint64_strpack_bigendian_aligned_macro(q,(uint64_t)hp->p);
+        }                                                      /*dpos*/
+    }
+}
+
+/* count entries per partition */
+static void
+mcdb_make_slot_hist_hp(void * const arg, const struct mcdb_hp *hp, uint32_t w)
+{
+    struct mcdb_make_fill * const restrict f = (struct mcdb_make_fill *)arg;
+    for (; w; --w, ++hp) {
+        if (hp->p == 0) continue;  /*(superseded; see mcdb_make_uniq())*/
+        ++f->off[mcdb_make_fastmod(hp->h >> MCDB_SLOT_BITS, f->M, f->len)
+                 >> f->shift];
+    }
+}
+
+/* flush write-combining buffer of partition k */
+__attribute_noinline__
+static void
+mcdb_make_slot_part_flush(struct mcdb_make_fill * const restrict f,
+                          const uint32_t k)
+{
+    const struct mcdb_hp * const restrict wc = f->wc + (size_t)k * f->wcsz;
+    const size_t len = (size_t)f->wcn[k] * sizeof(struct mcdb_hp);
+    if (f->scratch != NULL)
+        memcpy(f->scratch + f->off[k], wc, len);
+    else if (f->err == 0) {
+        const off_t off = f->base + (off_t)f->off[k] * sizeof(struct mcdb_hp);
+        size_t wr = 0;
+        ssize_t r;
+        do {
+            r = pwrite(f->fd, (const char *)wc + wr, len - wr, off + (off_t)wr);
+        } while (r != -1 ? (wr += (size_t)r) < len : errno == EINTR);
+        if (r == -1)
+            f->err = errno;
+    }
+    f->off[k] += f->wcn[k];
+    f->wcn[k] = 0;
+}
+
+/* scatter entries into partitions */
+static void
+mcdb_make_slot_part_hp(void * const arg, const struct mcdb_hp *hp, uint32_t w)
+{
+    struct mcdb_make_fill * const restrict f = (struct mcdb_make_fill *)arg;
+    for (; w; --w, ++hp) {
+        uint32_t k;
+        if (hp->p == 0) continue;  /*(superseded; see mcdb_make_uniq())*/
+        k = mcdb_make_fastmod(hp->h>>MCDB_SLOT_BITS, f->M, f->len) >> f->shift;
+        f->wc[(size_t)k * f->wcsz + f->wcn[k]] = *hp;
+        if (++f->wcn[k] == f->wcsz)
+            mcdb_make_slot_part_flush(f, k);
+    }
+}
+
+/* fill slot hash table window by window (see MCDB_FILL_WINDOW_BITS)
+ * (entries are partitioned in memory, or in spill file of slot if spilled)
+ * (falls back to unpartitioned fill if memory can not be allocated) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_slot_fill_part(const struct mcdb_make * const restrict m,
+                         struct mcdb_make_fill * const restrict f,
+                         const uint32_t i);
+
+static bool
+mcdb_make_slot_fill_part(const struct mcdb_make * const restrict m,
+                         struct mcdb_make_fill * const restrict f,
+                         const uint32_t i)
+{
+    const uint32_t n = m->count[i];
+    const bool tofile = (m->spill != NULL && m->spill->nspill[i] != 0);
+    const size_t nbuf = tofile ? (size_t)MCDB_SPILL_CHUNK*MCDB_HPLIST : n;
+    struct mcdb_hp *buf;
+    bool rc;
+    uint32_t k;
+    uint32_t u;
+    f->shift = MCDB_FILL_WINDOW_BITS - f->b;
+    f->np    = ((f->len - 1) >> f->shift) + 1;
+    f->wcsz  = tofile ? MCDB_FILL_WC_FILE : MCDB_FILL_WC;
+    f->err   = 0;
+    f->wc = (struct mcdb_hp *)
+      m->fn_malloc(((size_t)f->np * f->wcsz + nbuf) * sizeof(struct mcdb_hp)
+                   + (size_t)f->np * 2 * sizeof(uint32_t));
+    if (f->wc == NULL)
+        return mcdb_make_slot_hp(m, i, mcdb_make_slot_fill_hp, f);
+    buf = f->wc + (size_t)f->np * f->wcsz;
+    f->off = (uint32_t *)(buf + nbuf);
+    f->wcn = f->off + f->np;
+    memset(f->off, 0, (size_t)f->np * 2 * sizeof(uint32_t));
+    f->scratch = tofile ? NULL : buf;
+    f->fd      = tofile ? m->spill->fd[i] : -1;
+    f->base    = tofile
+      ? (off_t)m->spill->nspill[i] * (off_t)(sizeof(struct mcdb_hp)*MCDB_HPLIST)
+      : 0;
+
+    /* partition entries by start position (stable; entries for same key keep
+     * their order, and so their order in table) */
+    rc = mcdb_make_slot_hp(m, i, mcdb_make_slot_hist_hp, f);
+    if (rc) {
+        for (k = 0, u = 0; k < f->np; ++k) {
+            const uint32_t c = f->off[k];
+            f->off[k] = u;
+            u += c;
+        }
+        rc = mcdb_make_slot_hp(m, i, mcdb_make_slot_part_hp, f);
+        for (k = 0; k < f->np; ++k) {
+            if (f->wcn[k])
+                mcdb_make_slot_part_flush(f, k);
+        }
+        if (f->err != 0) {
+            errno = f->err;
+            rc = false;
+        }
+    }
+
+    /* fill table from partitions in order */
+    if (rc && !tofile)
+        mcdb_make_slot_fill_hp(f, buf, n);
+    else if (rc) {
+        off_t off = f->base;
+        for (u = n; u; ) {
+            const uint32_t c = u < nbuf ? u : (uint32_t)nbuf;
+            const size_t len = (size_t)c * sizeof(struct mcdb_hp);
+            size_t rd = 0;
+            ssize_t r;
+            do {
+                r = pread(f->fd, (char *)buf + rd, len - rd, off + (off_t)rd);
+            } while (r > 0 ? (rd += (size_t)r) < len : r == -1 && errno==EINTR);
+            if (rd != len) {
+                if (r == 0) errno = EIO;
+                rc = false;
+                break;
+            }
+            mcdb_make_slot_fill_hp(f, buf, c);
+            off += (off_t)len;
+            u -= c;
+        }
+    }
+
+    m->fn_free(f->wc);
+    return rc;
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_slot_fill(const struct mcdb_make * const restrict m,
+                    char * const restrict p, const uint32_t len,
+                    const uint32_t b, const uint32_t i);
+
+static bool
+mcdb_make_slot_fill(const struct mcdb_make * const restrict m,
+                    char * const restrict p, const uint32_t len,
+                    const uint32_t b, const uint32_t i)
+{
+    struct mcdb_make_fill f;
+    f.p   = p;
+    f.len = len;
+    f.b   = b;
+    f.M   = mcdb_make_fastmod_M(len);
+    memset(p, 0, (size_t)len << b);
+    return ((uintptr_t)len << b) <= m->fill_part_min
+      ? mcdb_make_slot_hp(m, i, mcdb_make_slot_fill_hp, &f)
+      : mcdb_make_slot_fill_part(m, &f, i);
+}
+
+/* build-time duplicate key policy (see mcdb_make.h)
+ * Each slot's entries are inserted into a temporary open hash table (hash,
+ * then key bytes compared); for each duplicate key, the superseded record
+ * (by record position, i.e. order added) is marked in data section (high bit
+ * of klen, otherwise unused).  Data section is then compacted, skipping marked
+ * records, and hp entry positions are rebased (superseded set to 0, skipped
+ * when building hash tables and sparse index).  Result is the mcdb which would
+ * have been built from input without the superseded records. */
+
+struct mcdb_make_uniq {
+  struct mcdb_hp *t;         /* temporary hash table */
+  uint32_t len;
+  uint64_t M;                /* mcdb_make_fastmod_M(len) */
+  unsigned char *x;          /* mmap of data section */
+  uint32_t policy;
+  uint32_t ndup;             /* num superseded records in slot */
+  int err;
+};
+
+static void
+mcdb_make_uniq_hp(void * const arg, const struct mcdb_hp *hp, uint32_t w)
+{
+    struct mcdb_make_uniq * const restrict q = (struct mcdb_make_uniq *)arg;
+    struct mcdb_hp * restrict e;
+    uintptr_t sup;
+    uint32_t u;
+    for (; w && q->err == 0; --w, ++hp) {
+        u = mcdb_make_fastmod(hp->h >> MCDB_SLOT_BITS, q->M, q->len);
+        while ((e = q->t+u)->p != 0
+               && (e->h != hp->h || e->l != hp->l
+                   || memcmp(q->x+e->p+8, q->x+hp->p+8, hp->l) != 0)) {
+            if (++u == q->len)
+                u = 0;
+        }
+        if (e->p == 0) {
+            *e = *hp;
+            continue;
+        }
+        /* duplicate key; supersede later record (first) or earlier (last) */
+        if (q->policy == MCDB_MAKE_UNIQUE_REJECT) {
+            q->err = EEXIST;
+            break;
+        }
+        if ((q->policy == MCDB_MAKE_UNIQUE_FIRST) == (hp->p > e->p))
+            sup = hp->p;
+        else {
+            sup = e->p;
+            e->p = hp->p;
+        }
+        q->x[sup] |= 0x80;  /* mark superseded (klen < 2 GB) */
+        ++q->ndup;
+    }
+}
+
+struct mcdb_make_uniq_sup {
+  uintptr_t p;               /* position of superseded record */
+  uintptr_t d;               /* bytes removed up to and including record */
+};
+
+/* rebase hp entry positions after compaction (superseded: 0) */
+static void
+mcdb_make_uniq_rebase(struct mcdb_hp * restrict hp, uint32_t w,
+                      const struct mcdb_make_uniq_sup * const restrict sup,
+                      const uint32_t nsup)
+{
+    for (; w; --w, ++hp) {
+        /* binary search for last superseded record at position <= hp->p */
+        uint32_t lo = 0, hi = nsup;
+        while (lo < hi) {
+            const uint32_t mid = lo + ((hi - lo) >> 1);
+            if (sup[mid].p <= hp->p)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo != 0)
+            hp->p = (sup[lo-1].p == hp->p) ? 0 : hp->p - sup[lo-1].d;
+    }
+}
+
+__attribute_noinline__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_uniq(struct mcdb_make * const restrict m);
+
+__attribute_noinline__
+static bool
+mcdb_make_uniq(struct mcdb_make * const restrict m)
+{
+    const size_t nodesz = sizeof(struct mcdb_hp) * MCDB_HPLIST;
+    const uintptr_t dend = m->pos;
+    struct mcdb_make_uniq q = { NULL, 0, 0, NULL, m->unique, 0, 0 };
+    struct mcdb_make_uniq_sup * restrict sup = NULL;
+    struct mcdb_hp * restrict buf = NULL;
+    uint64_t ndup = 0;
+    uint32_t nmax = 0;
+    uint32_t nsup = 0;
+    uint32_t i;
+    uintptr_t r, w, run, d = 0;
+    bool rc = false;
+
+    if (m->fd == -1) { errno = EINVAL; return false; }
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        if (nmax < m->count[i])
+            nmax = m->count[i];
+    }
+    if (nmax < 2) return true;
+    q.x = (unsigned char *)mmap(0, (size_t)dend, PROT_READ|PROT_WRITE,
+                                MAP_SHARED, m->fd, 0);
+    if (q.x == MAP_FAILED) return false;
+    q.t = (struct mcdb_hp *)
+      m->fn_malloc((size_t)nmax * 2 * sizeof(struct mcdb_hp));
+    if (q.t == NULL) { errno = ENOMEM; goto done; }
+
+    /* find and mark superseded records */
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        if (m->count[i] < 2) continue;
+        q.len  = m->count[i] * 2;
+        q.M    = mcdb_make_fastmod_M(q.len);
+        q.ndup = 0;
+        memset(q.t, 0, (size_t)q.len * sizeof(struct mcdb_hp));
+        if (!mcdb_make_slot_hp(m, i, mcdb_make_uniq_hp, &q)) goto done;
+        if (q.err != 0) { errno = q.err; goto done; }
+        m->count[i] -= q.ndup;
+        ndup += q.ndup;
+    }
+    m->fn_free(q.t);
+    q.t = NULL;
+    if (ndup == 0) { rc = true; goto done; }
+    if (ndup > UINT32_MAX) { errno = ENOMEM; goto done; }
+    sup = (struct mcdb_make_uniq_sup *)
+      m->fn_malloc((size_t)ndup * sizeof(struct mcdb_make_uniq_sup));
+    if (sup == NULL) { errno = ENOMEM; goto done; }
+
+    /* compact data section (move runs of records between superseded records)*/
+    for (r = w = run = MCDB_HEADER_SZ; r < dend; ) {
+        const uint32_t klen = uint32_strunpack_bigendian_macro(q.x+r);
+        const uintptr_t rlen = 8 + (klen & 0x7FFFFFFFu)
+                             + uint32_strunpack_bigendian_macro(q.x+r+4);
+        if (klen & 0x80000000u) {
+            if (r != run && w != run)
+                memmove(q.x+w, q.x+run, r - run);
+            w += r - run;
+            d += rlen;
+            sup[nsup].p = r;
+            sup[nsup].d = d;
+            ++nsup;
+            run = r + rlen;
+        }
+        r += rlen;
+    }
+    if (r != run)
+        memmove(q.x+w, q.x+run, r - run);
+    w += r - run;
+
+    /* rebase positions in hplists (and in spill files) */
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        uint32_t n;
+        for (struct mcdb_hplist *x = m->head[i]; x; x = x->next)
+            mcdb_make_uniq_rebase(x->hp, x->num, sup, nsup);
+        if (m->spill == NULL || (n = m->spill->nspill[i]) == 0)
+            continue;
+        if (buf == NULL
+            && (buf = (struct mcdb_hp *)m->fn_malloc(nodesz)) == NULL) {
+            errno = ENOMEM;
+            goto done;
+        }
+        while (n--) {
+            const off_t off = (off_t)((uint64_t)n * nodesz);
+            size_t rd = 0;
+            ssize_t rr;
+            do {
+                rr = pread(m->spill->fd[i], (char *)buf+rd, nodesz-rd,
+                           off+(off_t)rd);
+            } while (rr > 0 ? (rd += (size_t)rr) < nodesz
+                            : (rr == -1 && errno == EINTR));
+            if (rd != nodesz) {
+                if (rr == 0) errno = EIO;
+                goto done;
+            }
+            mcdb_make_uniq_rebase(buf, MCDB_HPLIST, sup, nsup);
+            rd = 0;
+            do {
+                rr = pwrite(m->spill->fd[i], (char *)buf+rd, nodesz-rd,
+                            off+(off_t)rd);
+            } while (rr != -1 ? (rd += (size_t)rr) < nodesz : errno == EINTR);
+            if (rr == -1) goto done;
+        }
+    }
+
+    /* builder mmap window restarts at new end of data section */
+    if (m->map != MAP_FAILED && munmap(m->map, m->msz) != 0) goto done;
+    m->map = MAP_FAILED;
+    m->pos = w;
+    if (m->wbpos > sup[0].p)
+        m->wbpos = sup[0].p & m->pgalign;
+    rc = mcdb_mmap_upsize(m, m->pos, false);
+
+  done:
+    if (buf != NULL) m->fn_free(buf);
+    if (sup != NULL) m->fn_free(sup);
+    if (q.t != NULL) m->fn_free(q.t);
+    munmap(q.x, (size_t)dend);
+    return rc;
+}
+
+#ifdef _THREAD_SAFE
+
+/* parallel build of slot hash tables: slot positions are computed up front
+ * from count[], the entire hash table region is mapped, and threads take
+ * slots in turn and fill them concurrently (each slot table is independent;
+ * output is identical to serial build) */
+struct mcdb_make_slots {
+  struct mcdb_make *m;
+  pthread_mutex_t mutex;
+  uint32_t next;
+  uint32_t b;
+  int err;
+  uintptr_t hpos[MCDB_SLOTS];
+};
+
+static void *
+mcdb_make_slots_thread(void * const arg)
+{
+    struct mcdb_make_slots * const restrict st = arg;
+    const struct mcdb_make * const restrict m = st->m;
+    uint32_t i;
+    for (;;) {
+        pthread_mutex_lock(&st->mutex);
+        i = st->next++;
+        pthread_mutex_unlock(&st->mutex);
+        if (i >= MCDB_SLOTS)
+            break;
+        if (m->count[i] != 0
+            && !mcdb_make_slot_fill(m, m->map + st->hpos[i] - m->offset,
+                                    m->count[i] << 1, st->b, i)) {
+            pthread_mutex_lock(&st->mutex);
+            st->err = errno;
+            pthread_mutex_unlock(&st->mutex);
+        }
+    }
+    return NULL;
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_make_slots_parallel(struct mcdb_make * const restrict m,
+                         char * const restrict header, const uint32_t b);
+
+static bool
+mcdb_make_slots_parallel(struct mcdb_make * const restrict m,
+                         char * const restrict header, const uint32_t b)
+{
+    struct mcdb_make_slots st;
+    pthread_t tids[64];
+    uintptr_t d = m->pos;
+    uint32_t nthreads = m->nthreads < 64 ? m->nthreads : 64;
+    uint32_t n;
+    uint32_t i;
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        st.hpos[i] = d;
+        d += (uintptr_t)m->count[i] << (b+1);
+    }
+    /* mmap entire hash table region (fall back to serial build if not able) */
+    if (m->offset+m->msz < d && !mcdb_mmap_upsize(m, d, false))
+        return false;
+    if (pthread_mutex_init(&st.mutex, NULL) != 0)
+        return false;
+    st.m = m;
+    st.next = 0;
+    st.b = b;
+    st.err = 0;
+    for (n = 1; n < nthreads; ++n) {
+        if (pthread_create(tids+n, NULL, mcdb_make_slots_thread, &st) != 0)
+            break;
+    }
+    mcdb_make_slots_thread(&st);
+    while (--n)
+        pthread_join(tids[n], NULL);
+    pthread_mutex_destroy(&st.mutex);
+    if (st.err != 0) {  /*(e.g. read error from spill file; retried serially)*/
+        errno = st.err;
+        return false;
+    }
+    for (i = 0; i < MCDB_SLOTS; ++i) {
+        /* constant header (16 bytes per header slot, so multiply by 16) */
+        char * const restrict p = header + (i << 4);
+        uint64_strpack_bigendian_aligned_macro(p,(uint64_t)st.hpos[i]);
+        uint32_strpack_bigendian_aligned_macro(p+8,m->count[i] << 1);
+        *(uint32_t *)(p+12) = 0;     /*(fill hole with 0 only for consistency)*/
+    }
+    m->pos = d;
+    return true;
+}
+
+#endif /* _THREAD_SAFE */
+
 int
 mcdb_make_finish(struct mcdb_make * const restrict m)
 {
@@ -472,25 +2047,39 @@ mcdb_make_finish(struct mcdb_make * const restrict m)
      *  and in practice, size of data fitting in 4 GB will impose lower limit)
      * Use of 32-bit hash is the basis for continuing to use 32-bit structures.
      * Even a mostly uniform distribution of hash keys will likely show
-     * increasing number of collisions as number of keys approaches 2 billion.*/
+     * increasing number of collisions as number of keys approaches 2 billion.
+     * (with mcdb_make_spill(), limit is approx 2 billion entries per slot) */
     uint32_t u;
     uint32_t i;
     uintptr_t d;
     uint32_t len;
     uint32_t b;
+    uint64_t nrecs;
+    uint32_t fn = 0;
+    uintptr_t fpos = 0;
+    uint32_t sn = 0;
+    uintptr_t spos = 0;
+    uintptr_t dend;
+    struct mcdb_make_mph mph = { 0, 0, 0, 0, 0, 0 };
     char *p;
     const uint32_t * const restrict count = m->count;
     char header[MCDB_HEADER_SZ];
+    int rc;
     if (m->map == MAP_FAILED)                  return mcdb_make_err(m,EPERM);
+    if (m->unique != MCDB_MAKE_UNIQUE_NONE
+        && (m->features & MCDB_FEATURE_ALIAS)) return mcdb_make_err(m,EINVAL);
+    if (m->unique != MCDB_MAKE_UNIQUE_NONE && !mcdb_make_uniq(m))
+                                               return mcdb_make_err(m,errno);
+    mcdb_make_writeback(m, m->pos); /*(writeback records while tables built)*/
 
-    for (u = 0, i = 0; i < MCDB_SLOTS; ++i)
-        u += count[i];  /* no overflow; limited in mcdb_hplist_alloc */
+    for (nrecs = 0, i = 0; i < MCDB_SLOTS; ++i)
+        nrecs += count[i];  /* limited in mcdb_hplist_alloc (or per slot) */
 
     /* check for integer overflow and that sufficient space allocated in file */
-    if (u > INT_MAX)                           return mcdb_make_err(m,ENOMEM);
+    if (nrecs > INT_MAX && m->spill == NULL)   return mcdb_make_err(m,ENOMEM);
   #if !defined(_LP64) && !defined(__LP64__)
-    if (u > (UINT_MAX>>4))                     return mcdb_make_err(m,ENOMEM);
-    u <<= 4;  /* 8 byte hash entries in 32-bit; x 2 for space in table */
+    if (nrecs > (UINT_MAX>>4))                 return mcdb_make_err(m,ENOMEM);
+    u = (uint32_t)nrecs << 4; /* 8 byte hash entries in 32-bit; x 2 for space */
     if (m->pos > ((size_t)UINT_MAX-u))         return mcdb_make_err(m,ENOMEM);
   #endif
 
@@ -505,13 +2094,92 @@ mcdb_make_finish(struct mcdb_make * const restrict m)
     if (d) memset(m->map + m->pos - m->offset, ~0, d);
     m->pos += d; /*set all bits in hole so code can detect end of data padding*/
 
+    dend = m->pos;
+
+    /* sparse index entries = ceil(data bytes / interval) */
+    if (m->sparse_sz != 0 && dend > MCDB_HEADER_SZ) {
+        const uintptr_t sn64 =
+          (dend - MCDB_HEADER_SZ + m->sparse_sz - 1) / m->sparse_sz;
+        if (sn64 > (INT_MAX >> 3))             return mcdb_make_err(m,EINVAL);
+        sn = (uint32_t)sn64;
+    }
+
+    /* sections between data and hash tables (sparse index, filter, mph index)
+     * (at least 8 bytes ~0 after data so that mcdb_iter() stops at end of data;
+     *  sections aligned to MCDB_FILTER_BLOCK_SZ (cache line) in file, mmap)*/
+    if ((m->filter_bits != 0 && nrecs != 0) || m->index == MCDB_INDEX_MPH
+        || sn != 0) {
+        d  = ((MCDB_FILTER_BLOCK_SZ
+               - ((m->pos + 8) & (MCDB_FILTER_BLOCK_SZ-1)))
+              & (MCDB_FILTER_BLOCK_SZ-1)) + 8;
+      #if !defined(_LP64) && !defined(__LP64__)
+        if (d > (UINT_MAX-(m->pos+u)))         return mcdb_make_err(m,ENOMEM);
+      #endif
+        if (m->offset+m->msz < m->pos+d && !mcdb_mmap_upsize(m,m->pos+d,false))
+                                               return mcdb_make_err(m,errno);
+        memset(m->map + m->pos - m->offset, ~0, d);
+        m->pos += d;
+    }
+
+    /* sparse record offset index (see mcdb.h)
+     * (padded to MCDB_FILTER_BLOCK_SZ for alignment of following sections) */
+    if (sn != 0) {
+        spos = m->pos;
+        len = (uint32_t)((((uintptr_t)sn << 3) + MCDB_FILTER_BLOCK_SZ-1)
+                         & ~(uintptr_t)(MCDB_FILTER_BLOCK_SZ-1));
+      #if !defined(_LP64) && !defined(__LP64__)
+        if (len > (UINT_MAX-(m->pos+u)))       return mcdb_make_err(m,ENOMEM);
+      #endif
+        if (m->offset+m->msz < spos+len && !mcdb_mmap_upsize(m,spos+len,false))
+                                               return mcdb_make_err(m,errno);
+        p = m->map + spos - m->offset;
+        memset(p, 0, len);
+        if (!mcdb_make_sparse_fill(m, p, sn, dend))
+                                               return mcdb_make_err(m,errno);
+        m->pos = spos + len;
+    }
+
+    /* negative lookup filter (blocked Bloom filter) (see mcdb.h)
+     * (filter blocks = ceil(nrecs * filter_bits / 512 bits per block)) */
+    if (m->filter_bits != 0 && nrecs != 0) {
+        uintptr_t flen;
+        const uint64_t fn64 = (nrecs * m->filter_bits + 511u) >> 9;
+        if (fn64 > UINT_MAX)                   return mcdb_make_err(m,ENOMEM);
+        fn = (uint32_t)fn64;
+        flen = (uintptr_t)fn * MCDB_FILTER_BLOCK_SZ;
+      #if !defined(_LP64) && !defined(__LP64__)
+        if (fn > (UINT_MAX / MCDB_FILTER_BLOCK_SZ)
+            || flen > (UINT_MAX-(m->pos+u)))   return mcdb_make_err(m,ENOMEM);
+      #endif
+        fpos = m->pos;
+        if (m->offset+m->msz < fpos+flen
+            && !mcdb_mmap_upsize(m,fpos+flen,false))
+                                               return mcdb_make_err(m,errno);
+        p = m->map + fpos - m->offset;
+        memset(p, 0, flen);
+        if (!mcdb_make_filter_fill(m, (unsigned char *)p, fn))
+                                               return mcdb_make_err(m,errno);
+        m->pos = fpos + flen;
+    }
+
+    /* minimal perfect hash index (see mcdb.h) (replaces slot hash tables) */
+    if (m->index == MCDB_INDEX_MPH
+        && !mcdb_make_mph(m, (uint32_t)nrecs, dend, &mph))
+                                               return mcdb_make_err(m,errno);
+
     /* undo POSIX_MADV_SEQUENTIAL advice to avoid crash on Solaris
      * (madvise is supposed to be advice, not promise; Solaris crash is bug) */
     posix_madvise(m->map, m->msz, POSIX_MADV_NORMAL);
 
     b = (m->pos < UINT_MAX) ? 3u : 4u;
+  #ifdef _THREAD_SAFE
+    if (m->nthreads > 1 && m->index != MCDB_INDEX_MPH
+        && mcdb_make_slots_parallel(m, header, b))
+        i = MCDB_SLOTS;
+    else
+  #endif
     for (i = 0; i < MCDB_SLOTS; ++i) {
-        len = count[i] << 1;
+        len = (m->index != MCDB_INDEX_MPH) ? count[i] << 1 : 0;
         d   = m->pos;
 
         /* mmap sufficient space into which to write hash table for this slot */
@@ -524,54 +2192,69 @@ mcdb_make_finish(struct mcdb_make * const restrict m)
         uint64_strpack_bigendian_aligned_macro(p,(uint64_t)d); /* hpos */
         uint32_strpack_bigendian_aligned_macro(p+8,len);       /* hslots */
         *(uint32_t *)(p+12) = 0;     /*(fill hole with 0 only for consistency)*/
+        if (len == 0)
+            continue;
 
         /* generate hash table for slot, writing directly to mmap */
         p = m->map + m->pos - m->offset;
         m->pos += ((uintptr_t)len << b);
-        memset(p, 0, (size_t)len << b);
-        if (b == 3) { /* data section ends < 4 GB; use 32-bit dpos offset */
-            /* (could be made into a subroutine taking (len, p, m->head[i]) */
-            /* layout in memory: 4-byte khash, 4-byte dpos */
-            for (const struct mcdb_hplist *x = m->head[i]; x; x = x->next) {
-                const struct mcdb_hp * restrict hp = x->hp;
-                char * restrict q;
-                for (uint32_t w = x->num; w; --w, ++hp) {
-                    q = p+4;  /*(4 is offset of dpos)*/
-                    u = (hp->h >> MCDB_SLOT_BITS) % len;
-                    /* find empty entry in open hash table (dpos == 0) */
-                    while (*(uint32_t *)(q+((uintptr_t)u<<3)))
-                        if (++u == len)
-                            u = 0;
-                    q += (u<<3);
-                    uint32_strpack_bigendian_aligned_macro(q-4,hp->h); /*khash*/
-                    uint32_strpack_bigendian_aligned_macro(q,(uint32_t)hp->p);
-                }                                                      /*dpos*/
-            }
-        }
-        else {/*b==4*//* data section crosses 4 GB; need 64-bit dpos offset */
-            /* (could be made into a subroutine taking (len, p, m->head[i]) */
-            /* layout in memory: 4-byte khash, 4-byte klen, 8-byte dpos */
-            for (const struct mcdb_hplist *x = m->head[i]; x; x = x->next) {
-                const struct mcdb_hp * restrict hp = x->hp;
-                char * restrict q;
-                for (uint32_t w = x->num; w; --w, ++hp) {
-                    q = p+8;  /*(8 is offset of dpos)*/
-                    u = (hp->h >> MCDB_SLOT_BITS) % len;
-                    /* find empty entry in open hash table (dpos == 0) */
-                    while (*(uintptr_t *)(q+((uintptr_t)u<<4)))
-                        if (++u == len)
-                            u = 0;
-                    q += (u<<4);
-                    uint32_strpack_bigendian_aligned_macro(q-8,hp->h); /*khash*/
-                    uint32_strpack_bigendian_aligned_macro(q-4,hp->l); /*klen*/
-                    uint64_strpack_bigendian_aligned_macro(q,(uint64_t)hp->p);
-                }                                                      /*dpos*/
-            }
-        }
+        if (!mcdb_make_slot_fill(m, p, len, b, i))
+            break;
+    }
+
+    /* mcdb header extension words (see mcdb.h)
+     * (hash_fn might have been set directly by caller; record as custom) */
+    if (m->hash_fn != (m->hash_id == MCDB_HASH_XXH32    ? uint32_hash_xxh32_key
+                      :m->hash_id == MCDB_HASH_IDENTITY ? uint32_hash_identity
+                      :                                   uint32_hash_djb))
+        m->hash_id = MCDB_HASH_CUSTOM;
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_VERSION,
+                                           MCDB_VERSION);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_FEATURES,
+                                           m->features
+                                           | (m->index == MCDB_INDEX_MPH
+                                              ? MCDB_FEATURE_MPH
+                                              : 0));
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_HASH_ID,
+                                           m->hash_id);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_HASH_INIT,
+                                           m->hash_init);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_FILTER, fn != 0
+                                           ? (MCDB_FILTER_BLOCKED_BLOOM << 8)
+                                             | mcdb_make_filter_k(m)
+                                           : 0);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_FILTER_N, fn);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_FILTER_POSH,
+                                           (uint32_t)((uint64_t)fpos >> 32));
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_FILTER_POSL,
+                                           (uint32_t)fpos);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_SPARSE_N, sn);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_SPARSE_SZ,
+                                           sn != 0 ? m->sparse_sz : 0);
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_SPARSE_POSH,
+                                           (uint32_t)((uint64_t)spos >> 32));
+    uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_SPARSE_POSL,
+                                           (uint32_t)spos);
+    if (m->index == MCDB_INDEX_MPH) {
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_N, mph.n);
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_NB,mph.nb);
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_M, mph.m);
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_SEED,
+                                               mph.seed);
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_POSH,
+                                             (uint32_t)((uint64_t)mph.pos>>32));
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_POSL,
+                                               (uint32_t)mph.pos);
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_NRECS,
+                                               (uint32_t)nrecs);
+        uint32_strpack_bigendian_aligned_macro(header+MCDB_HDR_MPH_BITS,mph.b);
     }
 
     u = (uint32_t)(i == MCDB_SLOTS && mcdb_mmap_commit(m, header));
-    return (u ? 0 : -1) | mcdb_make_destroy(m);
+    rc = (u ? 0 : -1) | mcdb_make_destroy(m);
+    if (rc == 0 && m->nocache && m->fd != -1) /*(after munmap() in destroy)*/
+        mcdb_make_dropcache(m, 0, m->pos);
+    return rc;
 }
 
 /* caller should call mcdb_make_destroy() upon errors from mcdb_make_*() calls
@@ -612,6 +2295,14 @@ mcdb_make_destroy(struct mcdb_make * const restrict m)
         }
         m->head[0] = NULL;
     }
+    if (m->spill != NULL) {
+        for (uint32_t i = 0; i < MCDB_SLOTS; ++i) {
+            if (m->spill->fd[i] != -1)
+                (void)nointr_close(m->spill->fd[i]);
+        }
+        m->fn_free(m->spill);
+        m->spill = NULL;
+    }
     return rc;
 }
 
@@ -624,6 +2315,9 @@ mcdb_make_destroy(struct mcdb_make * const restrict m)
 HIDDEN extern __typeof (mcdb_make_add)
                         mcdb_make_add_h
   __attribute_alias__ ("mcdb_make_add");
+HIDDEN extern __typeof (mcdb_make_add_alias)
+                        mcdb_make_add_alias_h
+  __attribute_alias__ ("mcdb_make_add_alias");
 HIDDEN extern __typeof (mcdb_make_addbegin)
                         mcdb_make_addbegin_h
   __attribute_alias__ ("mcdb_make_addbegin");
@@ -37,18 +37,20 @@ extern "C" {
 
 struct mcdb_hp { uintptr_t p; uint32_t h; uint32_t l; }; /*(private structure)*/
 struct mcdb_hplist;                                      /*(private structure)*/
+struct mcdb_make_spill;                                  /*(private structure)*/
 
 struct mcdb_make {
   size_t pos;
   size_t offset;
   char * restrict map;
   uint32_t hash_init;         /* hash init value */
-  uint32_t hash_pad;          /* (padding)*/
+  uint32_t hash_id;           /* hash id (MCDB_HASH_*) recorded in mcdb hdr */
   uint32_t (*hash_fn)(uint32_t, const void * restrict, size_t); /* hash func */
   size_t fsz;
   size_t osz;
   size_t msz;
   size_t pgalign;
+  size_t wbpos;               /* writeback started up to offset (Linux) */
   struct mcdb_hp hp;
   void * (*fn_malloc)(size_t);         /* fn ptr to malloc() */
   void (*fn_free)(void *);             /* fn ptr to free() */
@@ -56,6 +58,20 @@ struct mcdb_make {
   char *fntmp; /*(compiler warning for const char * restrict passed to free())*/
   int fd;
   mode_t st_mode;
+  uint32_t filter_bits;       /* negative lookup filter bits/key (0 if none) */
+  uint32_t index;             /* index type (MCDB_INDEX_*) */
+  uint32_t sparse_sz;         /* sparse offset index interval (0 if none) */
+  uint32_t nthreads;          /* threads to build slot hash tables in finish */
+  size_t fill_part_min;       /* slot hash table larger than this is filled
+                                 partitioned (default MCDB_FILL_PART_MIN, or
+                                 $MCDB_FILL_PART_MIN bytes; see mcdb_make.c) */
+  bool nocache;               /* drop mcdb from page cache once written */
+  bool dedup;                 /* alias records with same data as prior rec */
+  uint32_t unique;            /* duplicate key policy (MCDB_MAKE_UNIQUE_*) */
+  uint32_t features;          /* MCDB_FEATURE_* of records added (e.g. alias)*/
+  uint32_t adlen;             /* data len of last record not alias (dedup) */
+  size_t adpos;               /* data pos of last record not alias (or 0) */
+  struct mcdb_make_spill *spill; /* hp entries spilled to files (NULL if none)*/
   uint32_t count[MCDB_SLOTS];
   struct mcdb_hplist *head[MCDB_SLOTS];
 };
@@ -64,6 +80,15 @@ struct mcdb_make {
 /*
  * Note: mcdb *_make_* routines are not thread-safe
  * (no need for thread-safety; mcdb is typically created from a single stream)
+ * Producers adding records in parallel may each use a per-thread handle:
+ *   mcdb_make_thread_start(&h, &m, fd) in thread after hash and index of m set
+ *   mcdb_make_add*(&h, ...) in thread
+ *   mcdb_make_thread_merge(&m, &h) in a single thread after producer finishes
+ * Records of each handle are appended to m in the order added to the handle,
+ * and handles are appended in the order merged; result is deterministic and
+ * is identical to a single-threaded build adding records in that order.
+ * fd of handle is a spill file (e.g. mkstemp() then unlink()) for data region
+ * of handle; caller should close fd after mcdb_make_thread_merge().
  */
 
 
@@ -73,6 +98,14 @@ EXPORT extern int
 mcdb_make_start(struct mcdb_make * restrict, int,
                 void * (*)(size_t), void (*)(void *));
 
+/* mcdb_make_start() and preallocate file of expected mcdb size (bytes) once
+ * instead of extending it as mcdb grows (0 if unknown) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_start_sized(struct mcdb_make * restrict, int, size_t,
+                      void * (*)(size_t), void (*)(void *));
+
 __attribute_nonnull__()
 __attribute_warn_unused_result__
 EXPORT extern int
@@ -80,6 +113,103 @@ mcdb_make_add(struct mcdb_make * restrict,
               const char * restrict, size_t,
               const char * restrict, size_t);
 
+/* add alias record: key maps to data of record most recently added
+ * (data stored once for many keys; see MCDB_FEATURE_ALIAS in mcdb.h for
+ *  readers which do not refuse, and so misread, mcdb with alias records)
+ * (data of 8 bytes or less is copied instead)
+ * (not with mcdb_make_unique()) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_add_alias(struct mcdb_make * restrict, const char * restrict, size_t);
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_hash(struct mcdb_make * restrict, uint32_t, uint32_t);
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_filter(struct mcdb_make * restrict, uint32_t);
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_index(struct mcdb_make * restrict, uint32_t);
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_sparse(struct mcdb_make * restrict, uint32_t);
+
+/* build slot hash tables in mcdb_make_finish() with up to n threads
+ * (_THREAD_SAFE; output is identical to single-threaded build) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_threads(struct mcdb_make * restrict, uint32_t);
+
+/* duplicate key policy applied in mcdb_make_finish()
+ * (keys are unique in mcdb; records superseded are removed from mcdb, which is
+ *  then as if built from input without them, in one pass instead of
+ *  mcdbctl uniq.  REJECT fails mcdb_make_finish() with errno EEXIST.)
+ * (not with MCDB_INDEX_MPH; temporary memory of 32 bytes per record in the
+ *  largest slot; not with fd -1) */
+#define MCDB_MAKE_UNIQUE_NONE   0  /* keep all records (default) */
+#define MCDB_MAKE_UNIQUE_FIRST  1  /* keep first record added for key */
+#define MCDB_MAKE_UNIQUE_LAST   2  /* keep last record added for key */
+#define MCDB_MAKE_UNIQUE_REJECT 3  /* fail if duplicate key */
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_unique(struct mcdb_make * restrict, uint32_t);
+
+/* add record as alias record (see mcdb_make_add_alias()) if its data is same
+ * as data of the prior record (not alias) added; e.g. input with many keys for
+ * each value, in sequence (data longer than 8 bytes is compared, if prior data
+ * is still mapped) (not with mcdb_make_unique()) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_dedup(struct mcdb_make * restrict, bool);
+
+/* drop pages of mcdb from page cache once written, so that building a large
+ * mcdb does not evict pages of other files (e.g. mcdb being served) from page
+ * cache.  mcdb is written and dropped each MCDB_MMAP_MAX bytes as mmap slides,
+ * and the rest (hash tables) at end of mcdb_make_finish(), which then waits
+ * for writeback of the mcdb.  (posix_fadvise() POSIX_FADV_DONTNEED) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_nocache(struct mcdb_make * restrict, bool);
+
+/* bound memory used for hash/position of records to approx sz bytes by
+ * spilling entries per slot to temporary files (created in dir, or in $TMPDIR
+ * or /tmp if dir is NULL, and unlinked); entries are read back per slot in
+ * mcdb_make_finish().  Output is identical to build without spill.
+ * Must be called before adding first record; sz 0 disables.
+ * (not with MCDB_INDEX_MPH, which holds all key hashes in memory in finish)
+ * (limit is then approx 2 billion records per slot instead of total) */
+__attribute_nonnull__((1))
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_spill(struct mcdb_make * restrict, size_t, const char * restrict);
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_thread_start(struct mcdb_make * restrict,
+                       const struct mcdb_make * restrict, int);
+
+/* (h is destroyed by mcdb_make_thread_merge(), whether or not successful) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_make_thread_merge(struct mcdb_make * restrict,
+                       struct mcdb_make * restrict);
+
 __attribute_nonnull__()
 __attribute_warn_unused_result__
 EXPORT extern int
@@ -127,6 +257,10 @@ HIDDEN extern __typeof (mcdb_make_add)
                         mcdb_make_add_h;
 __attribute_nonnull__()
 __attribute_warn_unused_result__
+HIDDEN extern __typeof (mcdb_make_add_alias)
+                        mcdb_make_add_alias_h;
+__attribute_nonnull__()
+__attribute_warn_unused_result__
 HIDDEN extern __typeof (mcdb_make_addbegin)
                         mcdb_make_addbegin_h;
 __attribute_nonnull__()
@@ -143,6 +277,7 @@ HIDDEN extern __typeof (mcdb_make_addend)
                         mcdb_make_addend_h;
 #else
 #define mcdb_make_add_h                  mcdb_make_add
+#define mcdb_make_add_alias_h            mcdb_make_add_alias
 #define mcdb_make_addbegin_h             mcdb_make_addbegin
 #define mcdb_make_addbuf_data_h          mcdb_make_addbuf_data
 #define mcdb_make_addbuf_key_h           mcdb_make_addbuf_key
@@ -42,10 +42,15 @@
 #include <sys/mman.h>  /* mmap(), munmap() */
 #include <sys/stat.h>  /* fstat() */
 #include <fcntl.h>     /* open() */
+#include <limits.h>    /* INT_MAX */
 #include <stdlib.h>    /* EXIT_SUCCESS */
 #include <string.h>    /* memcpy(), memmove(), memchr() */
 #include <unistd.h>    /* read() */
 
+#ifdef _THREAD_SAFE
+#include <pthread.h>   /* pthread_create(), pthread_join() */
+#endif
+
 /*(posix_madvise, defines not provided in Solaris 10, even w/ __EXTENSIONS__)*/
 #if (defined(__sun) || defined(__hpux)) && !defined(POSIX_MADV_NORMAL)
 extern int madvise(caddr_t, size_t, int);
@@ -153,6 +158,41 @@ mcdb_bufread_number (struct mcdb_input * const restrict b,
     return false; /*error: no digits or too large; not bothering to set ERANGE*/
 }
 
+/* (mcdb_bufread_preamble() fast path for frequent case: at least 32 bytes
+ *  buffered, so a preamble with up to 9 digits in each number is contained
+ *  and is parsed without checking remaining buffer size at each char.  Returns
+ *  false without consuming input for anything else (end of input "\n", longer
+ *  digit runs such as many leading zeros, less than 32 bytes buffered, and all
+ *  errors), which is then parsed by the general code path, so that same input
+ *  is accepted and MCDB_ERROR_READFORMAT is detected same as before.
+ *  (9 digits do not exceed limit checked in mcdb_bufread_number())) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static inline bool
+mcdb_bufread_preamble_fast (struct mcdb_input * const restrict b,
+                            size_t * const restrict klen,
+                            size_t * const restrict dlen)
+{
+    const char * const restrict p = b->buf + b->pos;
+    size_t k, d;
+    uint32_t c, x, e;
+    if (b->datasz - b->pos < 32 || p[0] != '+'
+        || (k = (uint32_t)(p[1]-'0')) > 9u)
+        return false;
+    for (x = 2; x < 10 && (c = (uint32_t)(p[x]-'0')) <= 9u; ++x)
+        k = k * 10 + c;
+    if (p[x] != ',' || (d = (uint32_t)(p[x+1]-'0')) > 9u)
+        return false;
+    for (e = x + 10, x += 2; x < e && (c = (uint32_t)(p[x]-'0')) <= 9u; ++x)
+        d = d * 10 + c;
+    if (p[x] != ':')
+        return false;
+    *klen = k;
+    *dlen = d;
+    b->pos += x + 1;
+    return true;
+}
+
 __attribute_nonnull__()
 __attribute_warn_unused_result__
 static int
@@ -165,6 +205,8 @@ mcdb_bufread_preamble (struct mcdb_input * const restrict b,
                        size_t * const restrict klen,
                        size_t * const restrict dlen)
 {
+    if (mcdb_bufread_preamble_fast(b, klen, dlen))
+        return true;                           /*  1  valid preamble     */
     /* mcdbmake lines begin "+nnnn,mmmm:...."; max 23 chars with 32-bit nums */
     /* mcdbmake blank line ends input, or else MCDB_ERROR_READFORMAT error */
     if (b->datasz - b->pos < 23 && mcdb_bufread_preamble_fill(b) <= 0)
@@ -241,58 +283,866 @@ mcdb_bufread_rec (struct mcdb_make * const restrict m,
                && b->buf[b->pos++] == '\n'   );
 }
 
+/* add records from b to m until blank line ends input (returns EXIT_SUCCESS),
+ * error (returns MCDB_ERROR_*), or b->pos reaches end (returns
+ * MCDB_MAKEFMT_END), or record crosses end (returns MCDB_MAKEFMT_SPLIT with
+ * b->pos at start of that record; not added).  end is ~(size_t)0 if none. */
+#define MCDB_MAKEFMT_END   1
+#define MCDB_MAKEFMT_SPLIT 2
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdb_makefmt_addrecs (struct mcdb_make * const restrict m,
+                      struct mcdb_input * const restrict b, const size_t end);
+
+static int
+mcdb_makefmt_addrecs (struct mcdb_make * const restrict m,
+                      struct mcdb_input * const restrict b, const size_t end)
+{
+    size_t klen;
+    size_t dlen;
+    size_t rec;
+    int rv;
+
+    while (b->pos != end) {
+        rec = b->pos;
+        if ((rv = mcdb_bufread_preamble(b,&klen,&dlen)) <= 0)
+            return rv;
+
+        /* (klen and dlen checked < INT_MAX-8; no integer overflow possible) */
+        if (b->pos > end || klen + dlen + 3 > end - b->pos) {
+            b->pos = rec;
+            return MCDB_MAKEFMT_SPLIT;
+        }
+
+        /* optimized frequent path: entire data line buffered and available */
+        if (klen + dlen + 3 <= b->datasz - b->pos) {
+            const char * const p = b->buf + b->pos;
+            if (p[klen] == '-' && p[klen+1] == '>' && p[klen+2+dlen] == '\n') {
+                if (mcdb_make_add_h(m, p, klen, p+klen+2, dlen) == 0)
+                    b->pos += klen + dlen + 3;
+                else return MCDB_ERROR_WRITE;
+            } else     return MCDB_ERROR_READFORMAT;
+        }
+        else { /* entire data line is not buffered; handle in parts */
+            if (mcdb_make_addbegin_h(m, klen, dlen) == 0) {
+                if (mcdb_bufread_rec(m, klen, dlen, b))
+                    mcdb_make_addend_h(m);
+                else   return MCDB_ERROR_READFORMAT;
+            } else     return MCDB_ERROR_WRITE;
+        }
+    }
+
+    return MCDB_MAKEFMT_END;
+}
+
+#ifdef _THREAD_SAFE
+
+/* parallel parse of mmap input in chunks
+ *
+ * Input (mmap) is parsed in rounds of up to nthreads chunks; each chunk is
+ * parsed in a thread into a per-thread handle (mcdb_make_thread_start()), and
+ * handles are merged into m in input order (mcdb_make_thread_merge()), so
+ * mcdb is identical to serial parse (including order of duplicate keys).
+ * Chunk boundaries are found by resync on "\n+" at approx chunk size, where
+ * the record lengths at candidate are consistent (a cheap filter only).  A
+ * boundary is verified when parse of preceding chunk, from a verified
+ * boundary, ends exactly at it (first chunk of round starts at a verified
+ * boundary).  Results are taken in order: if a record crosses the end of a
+ * chunk (boundary was false, e.g. "\n+" in data), records of later chunks of
+ * round are discarded and next round starts at that record; a blank line ends
+ * input; the first error is returned, as from a serial parse.
+ * Rounds bound temporary files of handles ($TMPDIR or /tmp; unlinked) and
+ * hp entries in handles to approx nthreads * chunk size of input. */
+
+#define MCDB_MAKEFMT_CHUNK_MIN ((size_t)1 << 20) /*  1 MB */
+#define MCDB_MAKEFMT_CHUNK_MAX ((size_t)64 << 20) /* 64 MB */
+#define MCDB_MAKEFMT_THREADS_MAX 64
+
+struct mcdb_makefmt_chunk {
+  struct mcdb_make h;
+  struct mcdb_input b;
+  size_t end;
+  int rv;
+  int fd;
+  pthread_t tid;
+};
+
+static void *
+mcdb_makefmt_chunk_thread (void * const arg)
+{
+    struct mcdb_makefmt_chunk * const restrict c = arg;
+    c->rv = mcdb_makefmt_addrecs(&c->h, &c->b, c->end);
+    return NULL;
+}
+
+/* position of candidate record boundary at or after pos ('+' after '\n'),
+ * or sz if none */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static size_t
+mcdb_makefmt_resync (char * const restrict buf, size_t pos, const size_t sz);
+
+static size_t
+mcdb_makefmt_resync (char * const restrict buf, size_t pos, const size_t sz)
+{
+    const char *nl;
+    size_t klen;
+    size_t dlen;
+    for (; pos < sz; ++pos) {
+        struct mcdb_input t = { buf, pos, sz, sz, -1 };
+        if ((nl = memchr(buf+pos-1, '\n', sz-pos+1)) == NULL)
+            break;
+        t.pos = pos = (size_t)(nl - buf) + 1;
+        if (pos < sz && buf[pos] == '+'
+            && mcdb_bufread_preamble(&t, &klen, &dlen) > 0
+            && klen + dlen + 3 <= sz - t.pos
+            && buf[t.pos+klen] == '-' && buf[t.pos+klen+1] == '>'
+            && buf[t.pos+klen+2+dlen] == '\n')
+            return pos;
+    }
+    return sz;
+}
+
+/* parse b->buf (mmap) from b->pos in parallel rounds while enough input
+ * remains; returns EXIT_SUCCESS (end of input), MCDB_ERROR_*, or
+ * MCDB_MAKEFMT_END to continue serial parse at b->pos (remaining input
+ * small, or thread or temporary file not available) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdb_makefmt_addrecs_parallel (struct mcdb_make * const restrict m,
+                               struct mcdb_input * const restrict b,
+                               uint32_t nthreads);
+
+static int
+mcdb_makefmt_addrecs_parallel (struct mcdb_make * const restrict m,
+                               struct mcdb_input * const restrict b,
+                               uint32_t nthreads)
+{
+    static const char tmpl[] = "/mcdb.chunk.XXXXXX";
+    struct mcdb_makefmt_chunk *c;
+    const char *dir;
+    char *fn;
+    size_t len;
+    size_t csz;
+    uint32_t i;
+    uint32_t n;
+    uint32_t grow = 0;
+    int rv = MCDB_MAKEFMT_END;
+
+    if (nthreads > MCDB_MAKEFMT_THREADS_MAX)
+        nthreads = MCDB_MAKEFMT_THREADS_MAX;
+    if ((dir = getenv("TMPDIR")) == NULL)
+        dir = "/tmp";
+    len = strlen(dir);
+    c = (struct mcdb_makefmt_chunk *)
+      m->fn_malloc(sizeof(struct mcdb_makefmt_chunk) * nthreads);
+    fn = (char *)m->fn_malloc(len + sizeof(tmpl));
+    if (c == NULL || fn == NULL) {
+        if (c != NULL) m->fn_free(c);
+        if (fn != NULL) m->fn_free(fn);
+        return MCDB_MAKEFMT_END;
+    }
+
+    /* temporary files for data region of handles, reused each round */
+    for (n = 0; n < nthreads; ++n) {
+        memcpy(fn, dir, len);
+        memcpy(fn+len, tmpl, sizeof(tmpl));
+        if ((c[n].fd = mkstemp(fn)) == -1)
+            break;
+        unlink(fn);
+    }
+    m->fn_free(fn);
+    nthreads = n;
+
+    while (nthreads > 1 && b->datasz - b->pos >= MCDB_MAKEFMT_CHUNK_MIN*2) {
+        const size_t start = b->pos;
+        csz = (b->datasz - start) / nthreads;
+        if (csz < MCDB_MAKEFMT_CHUNK_MIN) csz = MCDB_MAKEFMT_CHUNK_MIN;
+        if (csz > MCDB_MAKEFMT_CHUNK_MAX) csz = MCDB_MAKEFMT_CHUNK_MAX;
+        csz <<= grow; /*(first chunk must contain first record; see below)*/
+
+        /* chunk boundaries (candidates) and handles */
+        for (n = 0; n < nthreads && (n == 0 || c[n-1].end < b->datasz); ++n) {
+            c[n].b = *b;
+            c[n].b.pos = n == 0 ? start : c[n-1].end;
+            c[n].end = (csz < b->datasz - c[n].b.pos)
+              ? mcdb_makefmt_resync(b->buf, c[n].b.pos + csz, b->datasz)
+              : b->datasz;
+            if (ftruncate(c[n].fd, 0) != 0
+                || mcdb_make_thread_start(&c[n].h, m, c[n].fd) != 0)
+                break;
+        }
+        if (n != nthreads && (n == 0 || c[n-1].end < b->datasz)) {
+            while (n) mcdb_make_destroy(&c[--n].h);
+            break;  /* continue with serial parse */
+        }
+
+        /* parse chunks in threads (first chunk in this thread) */
+        for (i = 1; i < n; ++i) {
+            if (pthread_create(&c[i].tid, NULL,
+                               mcdb_makefmt_chunk_thread, c+i) != 0) {
+                c[i].rv = mcdb_makefmt_addrecs(&c[i].h, &c[i].b, c[i].end);
+                c[i].tid = pthread_self();
+            }
+        }
+        mcdb_makefmt_chunk_thread(c);
+        for (i = 1; i < n; ++i) {
+            if (!pthread_equal(c[i].tid, pthread_self()))
+                pthread_join(c[i].tid, NULL);
+        }
+
+        /* merge handles in input order; take results of chunks in order */
+        for (i = 0; i < n; ++i) {
+            rv = c[i].rv;
+            if (rv < 0) {
+                mcdb_make_destroy(&c[i].h);
+                break;
+            }
+            if (mcdb_make_thread_merge(m, &c[i].h) != 0) {
+                mcdb_make_destroy(&c[i].h); /*(no-op if merge destroyed h)*/
+                rv = MCDB_ERROR_WRITE;
+                break;
+            }
+            b->pos = c[i].b.pos;
+            if (rv != MCDB_MAKEFMT_END) /* EXIT_SUCCESS or MCDB_MAKEFMT_SPLIT */
+                break;
+        }
+        while (++i < n)
+            mcdb_make_destroy(&c[i].h);
+        if (rv == MCDB_MAKEFMT_SPLIT) { /* next round starts at record */
+            rv = MCDB_MAKEFMT_END;
+            /* (record longer than chunk at start of round; double chunk) */
+            grow = (b->pos == start) ? grow + 1 : 0;
+            if (grow == 16) break;   /* continue with serial parse */
+        }
+        else if (rv != MCDB_MAKEFMT_END)
+            break;                   /* EXIT_SUCCESS or error */
+        else
+            grow = 0;
+    }
+
+    for (n = nthreads; n; )
+        nointr_close(c[--n].fd);
+    m->fn_free(c);
+    return rv;
+}
+
+#endif /* _THREAD_SAFE */
+
+
+/* tab-separated (MCDB_MAKEFMT_TSV) and JSON-lines (MCDB_MAKEFMT_JSONL) input
+ *
+ * Each line is one record.  A line is buffered whole (input buffer is replaced
+ * by a larger one from m->fn_malloc() if a line is longer than buffer), the
+ * lengths of key and data after unescaping are counted, and then key and data
+ * are added to m from the input buffer a span at a time, unescaping as they
+ * are added (mcdb_make_addbegin(), mcdb_make_addbuf_key(),
+ * mcdb_make_addbuf_data()); no intermediate copy of record.
+ * (see mcdb_makefmt.h for formats) */
+
+/* buffer line at b->pos through '\n' (or through end of input); returns
+ * length of line (without '\n'), or -1 at end of input, or -2 on error
+ * (read error or ENOMEM) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static ssize_t
+mcdb_bufread_line (struct mcdb_input * const restrict b,
+                   char ** const restrict own,
+                   struct mcdb_make * const restrict m);
+
+static ssize_t
+mcdb_bufread_line (struct mcdb_input * const restrict b,
+                   char ** const restrict own,
+                   struct mcdb_make * const restrict m)
+{
+    const char *nl;
+    size_t n = 0;  /* length of line scanned (no '\n' found) */
+    ssize_t r;
+    for (;;) {
+        nl = memchr(b->buf + b->pos + n, '\n', b->datasz - b->pos - n);
+        if (nl != NULL)
+            return (ssize_t)(nl - (b->buf + b->pos));
+        n = b->datasz - b->pos;
+        if (b->fd == -1)  /* we use fd == -1 as flag for mmap */
+            return n != 0 ? (ssize_t)n : -1;
+        if (b->pos != 0) {
+            if (n != 0)
+                memmove(b->buf, b->buf + b->pos, n);
+            b->pos = 0;
+            b->datasz = n;
+        }
+        else if (n == b->bufsz) {  /* line longer than buffer; double buffer */
+            char * const x = (b->bufsz <= (SIZE_MAX >> 1))
+              ? (char *)m->fn_malloc(b->bufsz << 1)
+              : NULL;
+            if (x == NULL) { errno = ENOMEM; return -2; }
+            memcpy(x, b->buf, n);
+            if (*own != NULL)
+                m->fn_free(*own);
+            b->buf = *own = x;
+            b->bufsz <<= 1;
+        }
+        retry_eintr_do_while(
+          (r = read(b->fd, b->buf + b->datasz, b->bufsz - b->datasz)),
+          (r == -1));
+        if (r > 0)
+            b->datasz += (size_t)r;
+        else if (r == 0)
+            return n != 0 ? (ssize_t)n : -1;
+        else
+            return -2;
+    }
+}
+
+/* length of TSV field s after unescaping \t \n \r \\ (~0 if invalid escape)*/
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static size_t
+mcdb_tsv_len (const char * restrict s, const size_t len);
+
+static size_t
+mcdb_tsv_len (const char * restrict s, const size_t len)
+{
+    const char * const e = s + len;
+    size_t n = len;
+    while ((s = memchr(s, '\\', (size_t)(e - s))) != NULL) {
+        if (++s == e)
+            return ~(size_t)0;
+        switch (*s++) {
+          case 't': case 'n': case 'r': case '\\': --n; break;
+          default: return ~(size_t)0;
+        }
+    }
+    return n;
+}
+
+/* add TSV field s to m, unescaping (escapes validated by mcdb_tsv_len()) */
+__attribute_nonnull__()
+static void
+mcdb_tsv_addbuf (struct mcdb_make * const restrict m,
+                 const char * restrict s, const size_t len,
+                 void (* const fn_addbuf)(struct mcdb_make * restrict,
+                                          const char * restrict, size_t));
+
+static void
+mcdb_tsv_addbuf (struct mcdb_make * const restrict m,
+                 const char * restrict s, const size_t len,
+                 void (* const fn_addbuf)(struct mcdb_make * restrict,
+                                          const char * restrict, size_t))
+{
+    const char * const e = s + len;
+    const char *x;
+    while ((x = memchr(s, '\\', (size_t)(e - s))) != NULL) {
+        if (x != s)
+            fn_addbuf(m, s, (size_t)(x - s));
+        switch (x[1]) {
+          case 't': fn_addbuf(m, "\t", 1); break;
+          case 'n': fn_addbuf(m, "\n", 1); break;
+          case 'r': fn_addbuf(m, "\r", 1); break;
+          default:  fn_addbuf(m, "\\", 1); break;
+        }
+        s = x + 2;
+    }
+    if (s != e)
+        fn_addbuf(m, s, (size_t)(e - s));
+}
+
+/* add record from TSV line "key\tdata" */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdb_tsv_line (struct mcdb_make * const restrict m,
+               const char * const restrict p, const size_t len);
+
+static int
+mcdb_tsv_line (struct mcdb_make * const restrict m,
+               const char * const restrict p, const size_t len)
+{
+    const char * const t = memchr(p, '\t', len);
+    size_t klen;
+    size_t dlen;
+    if (t == NULL)
+        return MCDB_ERROR_READFORMAT;
+    klen = mcdb_tsv_len(p, (size_t)(t - p));
+    dlen = mcdb_tsv_len(t + 1, len - (size_t)(t - p) - 1);
+    if (klen == ~(size_t)0 || dlen == ~(size_t)0)
+        return MCDB_ERROR_READFORMAT;
+    if (mcdb_make_addbegin_h(m, klen, dlen) != 0)
+        return MCDB_ERROR_WRITE;
+    mcdb_tsv_addbuf(m, p, (size_t)(t - p), mcdb_make_addbuf_key_h);
+    mcdb_tsv_addbuf(m, t + 1, len - (size_t)(t - p) - 1,
+                    mcdb_make_addbuf_data_h);
+    mcdb_make_addend_h(m);
+    return EXIT_SUCCESS;
+}
+
+/* value of 4 hex digits at s (s + 4 <= e checked by caller), or -1 */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int32_t
+mcdb_json_hex4 (const char * const restrict s);
+
+static int32_t
+mcdb_json_hex4 (const char * const restrict s)
+{
+    int32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        const uint32_t c = (uint32_t)(unsigned char)s[i];
+        const uint32_t x = c | 0x20;  /*(lowercase)*/
+        if (c - '0' <= 9u)                 v = (v << 4) | (int32_t)(c - '0');
+        else if (x - 'a' <= 5u)            v = (v << 4) | (int32_t)(x - 'a'+10);
+        else                               return -1;
+    }
+    return v;
+}
+
+/* code point of \uXXXX escape at s (after "\u"), combining surrogate pair;
+ * returns ptr after escape(s), or NULL if invalid */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static const char *
+mcdb_json_u (const char * restrict s, const char * const e,
+             uint32_t * const restrict cp);
+
+static const char *
+mcdb_json_u (const char * restrict s, const char * const e,
+             uint32_t * const restrict cp)
+{
+    int32_t c;
+    int32_t d;
+    if (e - s < 4 || (c = mcdb_json_hex4(s)) < 0)
+        return NULL;
+    s += 4;
+    if (c >= 0xD800 && c <= 0xDFFF) {  /* surrogate pair */
+        if (c >= 0xDC00 || e - s < 6 || s[0] != '\\' || s[1] != 'u'
+            || (d = mcdb_json_hex4(s+2)) < 0xDC00 || d > 0xDFFF)
+            return NULL;
+        c = 0x10000 + ((c - 0xD800) << 10) + (d - 0xDC00);
+        s += 6;
+    }
+    *cp = (uint32_t)c;
+    return s;
+}
+
+/* scan JSON string at s (after opening '"'); returns ptr after closing '"'
+ * and sets *n to length after unescaping (UTF-8), or returns NULL if invalid*/
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static const char *
+mcdb_json_str (const char * restrict s, const char * const e,
+               size_t * const restrict n);
+
+static const char *
+mcdb_json_str (const char * restrict s, const char * const e,
+               size_t * const restrict n)
+{
+    size_t u = 0;
+    uint32_t c;
+    for (;;) {
+        const char * const x = s;
+        while (s != e && *s != '"' && *s != '\\')
+            ++s;
+        u += (size_t)(s - x);
+        if (s == e)
+            return NULL;
+        if (*s++ == '"') {
+            *n = u;
+            return s;
+        }
+        if (s == e)
+            return NULL;
+        switch (*s++) {
+          case '"': case '\\': case '/':
+          case 'b': case 'f': case 'n': case 'r': case 't':
+            ++u;
+            break;
+          case 'u':
+            if ((s = mcdb_json_u(s, e, &c)) == NULL)
+                return NULL;
+            u += c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+            break;
+          default:
+            return NULL;
+        }
+    }
+}
+
+/* add JSON string s (after opening '"') to m, unescaping
+ * (validated by mcdb_json_str()) */
+__attribute_nonnull__()
+static void
+mcdb_json_addbuf (struct mcdb_make * const restrict m, const char * restrict s,
+                  void (* const fn_addbuf)(struct mcdb_make * restrict,
+                                           const char * restrict, size_t));
+
+static void
+mcdb_json_addbuf (struct mcdb_make * const restrict m, const char * restrict s,
+                  void (* const fn_addbuf)(struct mcdb_make * restrict,
+                                           const char * restrict, size_t))
+{
+    char u[4];
+    uint32_t c;
+    for (;;) {
+        const char * const x = s;
+        while (*s != '"' && *s != '\\')
+            ++s;
+        if (s != x)
+            fn_addbuf(m, x, (size_t)(s - x));
+        if (*s++ == '"')
+            return;
+        switch ((c = (uint32_t)(unsigned char)*s++)) {
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'n': c = '\n'; break;
+          case 'r': c = '\r'; break;
+          case 't': c = '\t'; break;
+          case 'u': s = mcdb_json_u(s, s + 10, &c); break;
+          default:  break;  /* '"' '\\' '/' */
+        }
+        if (c < 0x80) {
+            u[0] = (char)c;
+            fn_addbuf(m, u, 1);
+        }
+        else if (c < 0x800) {
+            u[0] = (char)(0xC0 | (c >> 6));
+            u[1] = (char)(0x80 | (c & 0x3F));
+            fn_addbuf(m, u, 2);
+        }
+        else if (c < 0x10000) {
+            u[0] = (char)(0xE0 | (c >> 12));
+            u[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+            u[2] = (char)(0x80 | (c & 0x3F));
+            fn_addbuf(m, u, 3);
+        }
+        else {
+            u[0] = (char)(0xF0 | (c >> 18));
+            u[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+            u[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+            u[3] = (char)(0x80 | (c & 0x3F));
+            fn_addbuf(m, u, 4);
+        }
+    }
+}
+
+/* skip JSON whitespace (line contains no '\n') */
+static inline const char *
+mcdb_json_ws (const char * restrict s, const char * const e)
+{
+    while (s != e && (*s == ' ' || *s == '\t' || *s == '\r'))
+        ++s;
+    return s;
+}
+
+/* scan JSON value at s; returns ptr after value, or NULL if invalid
+ * (strings are validated, and nesting of objects and arrays is counted;
+ *  not a full validation of JSON) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static const char *
+mcdb_json_skip (const char * restrict s, const char * const e);
+
+static const char *
+mcdb_json_skip (const char * restrict s, const char * const e)
+{
+    const char * const x = s;
+    size_t n;
+    uint32_t depth = 0;
+    while (s != e) {
+        switch (*s) {
+          case '"':
+            if ((s = mcdb_json_str(s+1, e, &n)) == NULL)
+                return NULL;
+            break;
+          case '{': case '[':
+            ++depth;
+            ++s;
+            break;
+          case '}': case ']':
+            if (depth == 0)  /* (end of number or literal in object) */
+                return s != x ? s : NULL;
+            --depth;
+            ++s;
+            break;
+          case ',': case ' ': case '\t': case '\r':
+            if (depth == 0)  /* (end of number or literal) */
+                return s != x ? s : NULL;
+            ++s;
+            break;
+          default:
+            ++s;
+            break;
+        }
+        if (depth == 0 && (*x == '"' || *x == '{' || *x == '['))
+            return s;        /* (end of string, object or array) */
+    }
+    return (depth == 0 && s != x) ? s : NULL;
+}
+
+/* add record from JSON-lines line {"k":key,"v":data} */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdb_jsonl_line (struct mcdb_make * const restrict m,
+                 const char * restrict s, const char * const e);
+
+static int
+mcdb_jsonl_line (struct mcdb_make * const restrict m,
+                 const char * restrict s, const char * const e)
+{
+    const char *k = NULL;
+    const char *v = NULL;
+    const char *x;
+    const char *y;
+    size_t klen = 0;
+    size_t dlen = 0;
+    size_t n = 0;
+
+    s = mcdb_json_ws(s, e);
+    if (s == e || *s++ != '{')
+        return MCDB_ERROR_READFORMAT;
+    for (;;) {
+        /* member name */
+        s = mcdb_json_ws(s, e);
+        if (s == e || *s != '"' || (s = mcdb_json_str((x = s+1), e, &n))==NULL)
+            return MCDB_ERROR_READFORMAT;
+        s = mcdb_json_ws(s, e);
+        if (s == e || *s++ != ':')
+            return MCDB_ERROR_READFORMAT;
+        /* member value (string is unescaped; other value taken as JSON text)*/
+        y = s = mcdb_json_ws(s, e);
+        if (s != e && *s == '"')
+            s = mcdb_json_str(s+1, e, &n);
+        else if ((s = mcdb_json_skip(s, e)) != NULL)
+            n = (size_t)(s - y);
+        if (s == NULL)
+            return MCDB_ERROR_READFORMAT;
+        if (*x == 'k' && x[1] == '"') {
+            if (k != NULL) return MCDB_ERROR_READFORMAT;
+            k = y;
+            klen = n;
+        }
+        else if (*x == 'v' && x[1] == '"') {
+            if (v != NULL) return MCDB_ERROR_READFORMAT;
+            v = y;
+            dlen = n;
+        }
+        s = mcdb_json_ws(s, e);
+        if (s == e)
+            return MCDB_ERROR_READFORMAT;
+        if (*s == ',') {
+            ++s;
+            continue;
+        }
+        if (*s++ != '}')
+            return MCDB_ERROR_READFORMAT;
+        break;
+    }
+    if (mcdb_json_ws(s, e) != e || k == NULL || v == NULL)
+        return MCDB_ERROR_READFORMAT;
+
+    if (mcdb_make_addbegin_h(m, klen, dlen) != 0)
+        return MCDB_ERROR_WRITE;
+    if (*k == '"')
+        mcdb_json_addbuf(m, k+1, mcdb_make_addbuf_key_h);
+    else
+        mcdb_make_addbuf_key_h(m, k, klen);
+    if (*v == '"')
+        mcdb_json_addbuf(m, v+1, mcdb_make_addbuf_data_h);
+    else
+        mcdb_make_addbuf_data_h(m, v, dlen);
+    mcdb_make_addend_h(m);
+    return EXIT_SUCCESS;
+}
+
+/* add records from lines of b to m until end of input */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdb_makefmt_addlines (struct mcdb_make * const restrict m,
+                       struct mcdb_input * const restrict b,
+                       const uint32_t format);
+
+static int
+mcdb_makefmt_addlines (struct mcdb_make * const restrict m,
+                       struct mcdb_input * const restrict b,
+                       const uint32_t format)
+{
+    char *own = NULL;  /* buffer allocated if line longer than b->buf */
+    ssize_t len;
+    int rv = EXIT_SUCCESS;
+    while ((len = mcdb_bufread_line(b, &own, m)) >= 0) {
+        const char * const p = b->buf + b->pos;
+        rv = (format == MCDB_MAKEFMT_TSV)
+          ? mcdb_tsv_line(m, p, (size_t)len)
+          : mcdb_jsonl_line(m, p, p + len);
+        if (rv != EXIT_SUCCESS)
+            break;
+        b->pos += (size_t)len;
+        if (b->pos != b->datasz)
+            ++b->pos;  /* '\n' */
+    }
+    if (len == -2)
+        rv = (errno == ENOMEM) ? MCDB_ERROR_MALLOC : MCDB_ERROR_READ;
+    if (own != NULL)
+        m->fn_free(own);
+    return rv;
+}
+
+
+/* length-prefixed binary input (MCDB_MAKEFMT_BIN)
+ *
+ * Records are added from input buffer directly (mcdb_make_add()) if buffered
+ * whole, else in parts as read (mcdb_make_addbegin(), mcdb_make_addbuf_key(),
+ * mcdb_make_addbuf_data()).  Lengths are limited to INT_MAX - 8, as for
+ * cdbmake input, so klen + dlen does not overflow.  Input must end with end
+ * marker; truncated input is an error. (see mcdb_makefmt.h for format) */
+
+static inline uint32_t
+mcdb_bin_u32 (const char * const restrict s)
+{
+    const unsigned char * const restrict u = (const unsigned char *)s;
+    return (uint32_t)u[0]         | ((uint32_t)u[1] << 8)
+        | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+/* add records from b (after magic) to m until end marker */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdb_makefmt_addbin (struct mcdb_make * const restrict m,
+                     struct mcdb_input * const restrict b);
+
+static int
+mcdb_makefmt_addbin (struct mcdb_make * const restrict m,
+                     struct mcdb_input * const restrict b)
+{
+    size_t klen;
+    size_t dlen;
+    for (;;) {
+        if (b->datasz - b->pos < 8 && !mcdb_bufread_xchars(b, 8))
+            return (errno == 0 ? MCDB_ERROR_READFORMAT : MCDB_ERROR_READ);
+        klen = mcdb_bin_u32(b->buf + b->pos);
+        dlen = mcdb_bin_u32(b->buf + b->pos + 4);
+        b->pos += 8;
+        if (klen > INT_MAX - 8 || dlen > INT_MAX - 8)
+            return (klen == 0xFFFFFFFFu && dlen == 0xFFFFFFFFu)
+              ? EXIT_SUCCESS                   /* end marker */
+              : MCDB_ERROR_READFORMAT;
+
+        if (klen + dlen <= b->datasz - b->pos) {
+            const char * const p = b->buf + b->pos;
+            if (mcdb_make_add_h(m, p, klen, p+klen, dlen) != 0)
+                return MCDB_ERROR_WRITE;
+            b->pos += klen + dlen;
+        }
+        else { /* entire record is not buffered; handle in parts */
+            if (mcdb_make_addbegin_h(m, klen, dlen) != 0)
+                return MCDB_ERROR_WRITE;
+            if (!mcdb_bufread_str(b, klen, m, mcdb_make_addbuf_key_h)
+                || !mcdb_bufread_str(b, dlen, m, mcdb_make_addbuf_data_h))
+                return (errno == 0 ? MCDB_ERROR_READFORMAT : MCDB_ERROR_READ);
+            mcdb_make_addend_h(m);
+        }
+    }
+}
+
 
 /* Above are private data struct, static routines used by mcdb_makefmt_fdintofd
  *   struct mcdb_input
  *   mcdb_bufread_preamble()
  *   mcdb_bufread_rec()
+ *   mcdb_makefmt_addrecs()
+ *   mcdb_makefmt_addrecs_parallel()
+ *   mcdb_makefmt_addlines()
+ *   mcdb_makefmt_addbin()
  */ 
 
 
+/* default options (djb hash; same as mcdb created prior to mcdb hdr options)*/
+static const struct mcdb_makefmt_opts mcdb_makefmt_opts_default =
+  { MCDB_HASH_DJB, MCDB_HASH_DJB_INIT, 0, MCDB_INDEX_HASH, 0, 1, 0, 0, 0, 0,
+    MCDB_MAKEFMT_CDB, 1 };
+
 __attribute_noinline__
 int
-mcdb_makefmt_fdintofd (const int inputfd,
-                       char * const restrict buf,
-                       const size_t bufsz,
-                       const int outputfd,
-                       void * (* const fn_malloc)(size_t),
-                       void (* const fn_free)(void *))
+mcdb_makefmt_fdintofd_opts (const int inputfd,
+                            char * const restrict buf,
+                            const size_t bufsz,
+                            const int outputfd,
+                            void * (* const fn_malloc)(size_t),
+                            void (* const fn_free)(void *),
+                            const struct mcdb_makefmt_opts * const restrict o)
 {
     struct mcdb_input b = { buf, 0, 0, bufsz, inputfd };
     struct mcdb_make m;
-    size_t klen;
-    size_t dlen;
+    size_t sz = 0;
+    struct stat st;
+    off_t off;
     int rv;
 
+    if (o->format > MCDB_MAKEFMT_BIN) {
+        errno = EINVAL;
+        return MCDB_ERROR_USAGE;
+    }
+
+    /* preallocate mcdb of input size (approx size of records in mcdb) */
+    if (inputfd == -1)
+        sz = bufsz;
+    else if (fstat(inputfd, &st) == 0 && S_ISREG(st.st_mode)
+             && (off = lseek(inputfd, 0, SEEK_CUR)) != -1 && st.st_size > off){
+        sz = (size_t)(st.st_size - off);
+      #if !defined(_LP64) && !defined(__LP64__)
+        if (st.st_size - off > (off_t)SIZE_MAX) sz = SIZE_MAX;
+      #endif
+    }
+
     errno = 0;
 
-    if (mcdb_make_start(&m, outputfd, fn_malloc, fn_free) == -1)
+    if (mcdb_make_start_sized(&m, outputfd, sz, fn_malloc, fn_free) == -1)
         return MCDB_ERROR_WRITE;
 
+    if (mcdb_make_index(&m, o->index) == -1
+        || mcdb_make_hash(&m, o->hash_id, o->hash_init) == -1
+        || mcdb_make_filter(&m, o->filter_bits) == -1
+        || mcdb_make_sparse(&m, o->sparse_sz) == -1
+        || mcdb_make_threads(&m, o->nthreads) == -1
+        || mcdb_make_spill(&m, o->spill_sz, NULL) == -1
+        || mcdb_make_nocache(&m, o->nocache != 0) == -1
+        || mcdb_make_unique(&m, o->unique) == -1
+        || mcdb_make_dedup(&m, o->dedup != 0) == -1) {
+        mcdb_make_destroy(&m);
+        return MCDB_ERROR_WRITE;
+    }
+
     if (b.fd == -1)  /* we use fd == -1 as flag for mmap */
         b.datasz = b.bufsz;
 
-    while ((rv = mcdb_bufread_preamble(&b,&klen,&dlen)) > 0) {
-
-        /* optimized frequent path: entire data line buffered and available */
-        /* (klen and dlen checked < INT_MAX-8; no integer overflow possible) */
-        if (klen + dlen + 3 <= b.datasz - b.pos) {
-            const char * const p = b.buf + b.pos;
-            if (p[klen] == '-' && p[klen+1] == '>' && p[klen+2+dlen] == '\n') {
-                if (mcdb_make_add_h(&m, p, klen, p+klen+2, dlen) == 0)
-                    b.pos += klen + dlen + 3;
-                else { rv = MCDB_ERROR_WRITE;      break; }
-            } else {   rv = MCDB_ERROR_READFORMAT; break; }
-        }
-        else { /* entire data line is not buffered; handle in parts */
-            if (mcdb_make_addbegin_h(&m, klen, dlen) == 0) {
-                if (mcdb_bufread_rec(&m, klen, dlen, &b))
-                    mcdb_make_addend_h(&m);
-                else { rv = MCDB_ERROR_READFORMAT; break; }
-            } else {   rv = MCDB_ERROR_WRITE;      break; }
-        }
-
+    /* binary input is recognized by magic (if format not specified, or bin) */
+    if ((o->format == MCDB_MAKEFMT_CDB || o->format == MCDB_MAKEFMT_BIN)
+        && (b.datasz >= 8 || mcdb_bufread_xchars(&b, 8))
+        && memcmp(b.buf, MCDB_MAKEFMT_BIN_MAGIC, 8) == 0) {
+        b.pos = 8;
+        rv = mcdb_makefmt_addbin(&m, &b);
     }
+    else if (o->format == MCDB_MAKEFMT_BIN)
+        rv = (errno == 0 ? MCDB_ERROR_READFORMAT : MCDB_ERROR_READ);
+    else if (o->format != MCDB_MAKEFMT_CDB)
+        rv = mcdb_makefmt_addlines(&m, &b, o->format);
+  #ifdef _THREAD_SAFE
+    /* parallel parse of mmap input (not with dedup, which compares records
+     * across chunk boundaries) */
+    else if (b.fd == -1 && o->parse_threads > 1 && !o->dedup
+             && b.datasz >= MCDB_MAKEFMT_CHUNK_MIN*2)
+        rv = mcdb_makefmt_addrecs_parallel(&m, &b, o->parse_threads);
+  #endif
+    else
+        rv = MCDB_MAKEFMT_END;
+
+    if (rv == MCDB_MAKEFMT_END)
+        rv = mcdb_makefmt_addrecs(&m, &b, ~(size_t)0);
 
     if (rv == EXIT_SUCCESS)
         return (mcdb_make_finish(&m) == 0) ? EXIT_SUCCESS : MCDB_ERROR_WRITE;
@@ -319,15 +1169,31 @@ mcdb_makefmt_fdintofd (const int inputfd,
  */
 __attribute_noinline__
 int
-mcdb_makefmt_fdintofile (const int inputfd,
-                         char * const restrict buf, const size_t bufsz,
-                         const char * const restrict fname,
-                         void * (* const fn_malloc)(size_t),
-                         void (* const fn_free)(void *))
+mcdb_makefmt_fdintofd (const int inputfd,
+                       char * const restrict buf,
+                       const size_t bufsz,
+                       const int outputfd,
+                       void * (* const fn_malloc)(size_t),
+                       void (* const fn_free)(void *))
+{
+    return mcdb_makefmt_fdintofd_opts(inputfd, buf, bufsz, outputfd,
+                                      fn_malloc, fn_free,
+                                      &mcdb_makefmt_opts_default);
+}
+
+__attribute_noinline__
+int
+mcdb_makefmt_fdintofile_opts (const int inputfd,
+                              char * const restrict buf, const size_t bufsz,
+                              const char * const restrict fname,
+                              void * (* const fn_malloc)(size_t),
+                              void (* const fn_free)(void *),
+                              const struct mcdb_makefmt_opts * const restrict o)
 {
     struct mcdb_make m;
     int rv = mcdb_makefn_start(&m, fname, fn_malloc, fn_free) == 0
-      ? mcdb_makefmt_fdintofd(inputfd, buf, bufsz, m.fd, fn_malloc, fn_free)
+      ? mcdb_makefmt_fdintofd_opts(inputfd, buf, bufsz, m.fd,
+                                   fn_malloc, fn_free, o)
       : (errno == ENOMEM ? MCDB_ERROR_MALLOC : MCDB_ERROR_WRITE);
     if (rv == 0)
         rv = mcdb_makefn_finish(&m, true) == 0 ? 0 : MCDB_ERROR_WRITE;
@@ -337,10 +1203,25 @@ mcdb_makefmt_fdintofile (const int inputfd,
 
 __attribute_noinline__
 int
-mcdb_makefmt_fileintofile (const char * const restrict infile,
-                           const char * const restrict fname,
-                           void * (* const fn_malloc)(size_t),
-                           void (* const fn_free)(void *))
+mcdb_makefmt_fdintofile (const int inputfd,
+                         char * const restrict buf, const size_t bufsz,
+                         const char * const restrict fname,
+                         void * (* const fn_malloc)(size_t),
+                         void (* const fn_free)(void *))
+{
+    return mcdb_makefmt_fdintofile_opts(inputfd, buf, bufsz, fname,
+                                        fn_malloc, fn_free,
+                                        &mcdb_makefmt_opts_default);
+}
+
+__attribute_noinline__
+int
+mcdb_makefmt_fileintofile_opts (const char * const restrict infile,
+                                const char * const restrict fname,
+                                void * (* const fn_malloc)(size_t),
+                                void (* const fn_free)(void *),
+                                const struct mcdb_makefmt_opts * const
+                                  restrict o)
 {
     void * restrict x = MAP_FAILED;
     int rv = MCDB_ERROR_READ;
@@ -364,8 +1245,8 @@ mcdb_makefmt_fileintofile (const char * const restrict infile,
     if (nointr_close(fd) == 0 && x != MAP_FAILED) {
         posix_madvise(x, (size_t)st.st_size, POSIX_MADV_WILLNEED);
         /* pass entire map and size as params; fd -1 elides read()/remaps */
-        rv = mcdb_makefmt_fdintofile(-1, x, (size_t)st.st_size,
-                                     fname, fn_malloc, fn_free);
+        rv = mcdb_makefmt_fdintofile_opts(-1, x, (size_t)st.st_size,
+                                          fname, fn_malloc, fn_free, o);
     }
 
     if (x != MAP_FAILED)
@@ -375,3 +1256,14 @@ mcdb_makefmt_fileintofile (const char * const restrict infile,
 
     return rv;
 }
+
+__attribute_noinline__
+int
+mcdb_makefmt_fileintofile (const char * const restrict infile,
+                           const char * const restrict fname,
+                           void * (* const fn_malloc)(size_t),
+                           void (* const fn_free)(void *))
+{
+    return mcdb_makefmt_fileintofile_opts(infile, fname, fn_malloc, fn_free,
+                                          &mcdb_makefmt_opts_default);
+}
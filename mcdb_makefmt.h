@@ -30,6 +30,8 @@
 #include "plasma/plasma_stdtypes.h"  /* size_t */
 PLASMA_ATTR_Pragma_once
 
+#include "mcdb.h"  /* MCDB_HASH_* */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -58,6 +60,80 @@ EXPORT extern int
 mcdb_makefmt_fileintofile (const char * restrict, const char * restrict,
                            void * (*)(size_t), void (*)(void *));
 
+/* mcdb creation options
+ * (struct may be extended in future; initialize with mcdb_makefmt_opts_init)*/
+struct mcdb_makefmt_opts {
+  uint32_t hash_id;           /* hash function (MCDB_HASH_*) (see mcdb.h) */
+  uint32_t hash_init;         /* hash init value (seed) */
+  uint32_t filter_bits;       /* negative lookup filter bits/key (0 if none) */
+  uint32_t index;             /* index type (MCDB_INDEX_*) (see mcdb.h) */
+  uint32_t sparse_sz;         /* sparse offset index interval (0 if none) */
+  uint32_t nthreads;          /* threads to build hash tables (see mcdb_make) */
+  size_t spill_sz;            /* memory for hp entries (0: do not spill) */
+  uint32_t nocache;           /* drop mcdb from page cache once written */
+  uint32_t unique;            /* duplicate key policy (MCDB_MAKE_UNIQUE_*) */
+  uint32_t dedup;             /* alias records with same data as prior rec */
+  uint32_t format;            /* input format (MCDB_MAKEFMT_*) */
+  uint32_t parse_threads;     /* threads to parse input file in chunks
+                                 (1: serial parse) */
+};
+
+/* input formats
+ *   MCDB_MAKEFMT_CDB    "+klen,dlen:key->data\n" ... "\n" (cdbmake) (default)
+ *   MCDB_MAKEFMT_TSV    "key\tdata\n" (key ends at first tab; escapes \t \n
+ *                       \r \\ in key and data; other backslash is an error)
+ *   MCDB_MAKEFMT_JSONL  {"k":key,"v":data}\n (JSON string key or data is
+ *                       unescaped (\uXXXX to UTF-8); other JSON value, e.g.
+ *                       number or object, is taken as its JSON text; other
+ *                       members are ignored)
+ *   MCDB_MAKEFMT_BIN    MCDB_MAKEFMT_BIN_MAGIC (8 bytes), then records of
+ *                       4-byte klen, 4-byte dlen (little-endian), key, data,
+ *                       then klen and dlen 0xFFFFFFFF to end input
+ *                       (input in MCDB_MAKEFMT_CDB format which begins with
+ *                        MCDB_MAKEFMT_BIN_MAGIC is read as MCDB_MAKEFMT_BIN)
+ * TSV and JSON-lines input ends at end of input (not at blank line, which is
+ * an error); a line longer than input buffer is read into a larger buffer.
+ * Records are added from input buffer directly, unescaping as added.
+ * (parallel parse of input file in chunks is for MCDB_MAKEFMT_CDB only) */
+#define MCDB_MAKEFMT_CDB   0
+#define MCDB_MAKEFMT_TSV   1
+#define MCDB_MAKEFMT_JSONL 2
+#define MCDB_MAKEFMT_BIN   3
+#define MCDB_MAKEFMT_BIN_MAGIC "mcdbbin1"
+
+#define mcdb_makefmt_opts_init(o) \
+  ((o)->hash_id = MCDB_HASH_DJB, (o)->hash_init = MCDB_HASH_DJB_INIT, \
+   (o)->filter_bits = 0, (o)->index = MCDB_INDEX_HASH, (o)->sparse_sz = 0, \
+   (o)->nthreads = 1, (o)->spill_sz = 0, (o)->nocache = 0, (o)->unique = 0, \
+   (o)->dedup = 0, (o)->format = MCDB_MAKEFMT_CDB, (o)->parse_threads = 1)
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_makefmt_fdintofd_opts (int, char * restrict, size_t,
+                            int, void * (*)(size_t), void (*)(void *),
+                            const struct mcdb_makefmt_opts * restrict);
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_makefmt_fdintofile_opts (const int, char * restrict, size_t,
+                              const char * restrict,
+                              void * (*)(size_t), void (*)(void *),
+                              const struct mcdb_makefmt_opts * restrict);
+
+/* (input file (mmap) of 2 MB or more is parsed in chunks by o->parse_threads
+ *  threads (_THREAD_SAFE; not with o->dedup); records are added in input
+ *  order, so mcdb is identical to mcdb from serial parse.  Temporary files of
+ *  up to approx o->parse_threads * 64 MB are created in $TMPDIR or /tmp.
+ *  Off by default (parse_threads = 1); no speedup has been measured) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_makefmt_fileintofile_opts (const char * restrict, const char * restrict,
+                                void * (*)(size_t), void (*)(void *),
+                                const struct mcdb_makefmt_opts * restrict);
+
 #ifdef __cplusplus
 }
 #endif
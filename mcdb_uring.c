@@ -0,0 +1,747 @@
+/*
+ * mcdb_uring - asynchronous mcdb lookups with io_uring (Linux)
+ *
+ * Copyright (c) 2026, Glue Logic LLC. All rights reserved. code()gluelogic.com
+ *
+ *  This file is part of mcdb.
+ *
+ *  mcdb is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mcdb is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with mcdb.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * mcdb is originally based upon the Public Domain cdb-0.75 by Dan Bernstein
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+#ifndef _XOPEN_SOURCE /* pread() */
+#define _XOPEN_SOURCE 700
+#endif
+#ifndef _GNU_SOURCE /* syscall(); enable O_CLOEXEC on GNU systems */
+#define _GNU_SOURCE 1
+#endif
+/* large file support needed for stat(),fstat(),pread() input file > 2 GB */
+#define PLASMA_FEATURE_ENABLE_LARGEFILE
+
+#include "mcdb_uring.h"
+#include "mcdb.h"
+#include "nointr.h"
+#include "uint32.h"
+#include "plasma/plasma_membar.h"
+#include "plasma/plasma_stdtypes.h"  /* SIZE_MAX */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+/* (IORING_OP_READ requires Linux 5.6 headers; kernel is checked at runtime) */
+#if defined(__linux__) && !defined(MCDB_NO_URING)
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
+#define MCDB_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#ifndef O_CLOEXEC /* O_CLOEXEC available since Linux 2.6.23 */
+#define O_CLOEXEC 0
+#endif
+
+#ifdef MCDB_URING
+
+/* Lookup is the same sequence of accesses as mcdb_findtagstart() and
+ * mcdb_findtagnext(), with each access past the in-memory index being a read
+ * completed through the ring:
+ *   mcdb_findtagstart() on map with header, filter and mph pilots in memory
+ *     (computes khash, slot hash table position, and first entry to probe)
+ *   MCDB_URING_ENT: read entries from kpos (up to MCDB_URING_ENTSZ bytes, not
+ *     past end of slot hash table or page)
+ *   MCDB_URING_REC: read record header, key, and MCDB_URING_DATASZ bytes
+ *     of data for entry with matching khash (resume with next entry if key
+ *     does not match)
+ *   MCDB_URING_DATA: read remainder of data if not already read
+ *     (or data aliased, if record is an alias record)
+ * map->ptr is the header copy and map->hptr == map->ptr, so that kpos and
+ * hpos computed by mcdb_findtagstart() are offsets in mcdb file. */
+enum {
+  MCDB_URING_ENT  = 1,
+  MCDB_URING_REC  = 2,
+  MCDB_URING_DATA = 3
+};
+
+struct mcdb_uring {
+  struct mcdb_mmap map;       /* header, filter, mph pilots (not mmap) */
+  unsigned char *filter;      /* copy of filter (or NULL) */
+  unsigned char *mph;         /* copy of mph pilots and remap (or NULL) */
+  int fd;                     /* mcdb file */
+  int ffd;                    /* fd for sqe: 0 if registered (fixed) else fd */
+  int ring;                   /* io_uring fd */
+  uint32_t sqe_flags;         /* IOSQE_FIXED_FILE if fd registered */
+  uint32_t depth;             /* max requests in flight */
+  uint32_t inflight;          /* requests submitted and not completed */
+  uint32_t sq_pending;        /* sqes queued and not yet submitted */
+  uint32_t sq_tail;           /* local sq tail */
+  uint32_t sq_mask;
+  uint32_t cq_mask;
+  unsigned *sq_ktail;
+  unsigned *sq_array;
+  unsigned *cq_khead;
+  unsigned *cq_ktail;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring;
+  void *cq_ring;
+  size_t sq_ring_sz;
+  size_t cq_ring_sz;
+  size_t sqes_sz;
+  struct mcdb_uring_req *done;      /* completed requests (head) */
+  struct mcdb_uring_req **done_tail;/* completed requests (tail) */
+  void * (*fn_malloc)(size_t);/* fn ptr to malloc() */
+  void (*fn_free)(void *);    /* fn ptr to free() */
+};
+
+__attribute_nonnull__()
+static bool
+mcdb_uring_pread(const int fd, void * const restrict buf, const size_t sz,
+                 const uint64_t off);
+
+static bool
+mcdb_uring_pread(const int fd, void * const restrict buf, const size_t sz,
+                 const uint64_t off)
+{
+    size_t n = 0;
+    ssize_t r;
+    while (n < sz) {
+        r = pread(fd, (char *)buf + n, sz - n, (off_t)(off + n));
+        if (r > 0)
+            n += (size_t)r;
+        else if (r == 0)
+            return (errno = EINVAL, false); /*(truncated mcdb)*/
+        else if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+
+/* read mcdb header, and filter and mph pilots if present, into memory
+ * (parsed by mcdb_mmap_hdr(), as for mmap) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_uring_hdr(struct mcdb_uring * const restrict u);
+
+static bool
+mcdb_uring_hdr(struct mcdb_uring * const restrict u)
+{
+    struct mcdb_mmap * const restrict map = &u->map;
+    struct stat st;
+    uintptr_t fpos;
+    uintptr_t sz;
+    if (fstat(u->fd, &st) != 0)
+        return false;
+  #if !defined(_LP64) && !defined(__LP64__)
+    if (st.st_size > (off_t)SIZE_MAX) return (errno = EFBIG, false);
+  #endif
+    if ((uint64_t)st.st_size < MCDB_HEADER_SZ)
+        return (errno = EINVAL, false);
+    map->ptr = u->fn_malloc(MCDB_HEADER_SZ);
+    if (map->ptr == NULL)
+        return (errno = ENOMEM, false);
+    if (!mcdb_uring_pread(u->fd, map->ptr, MCDB_HEADER_SZ, 0))
+        return false;
+    map->size  = (uintptr_t)st.st_size;
+    map->b     = st.st_size < UINT_MAX || *(uint32_t *)map->ptr == 0 ? 3u : 4u;
+    map->n     = ~0;
+    map->hptr  = map->ptr;
+    map->mtime = st.st_mtime;
+    map->next  = NULL;
+    if (!mcdb_mmap_hdr(map))
+        return false;
+    map->sparse   = NULL; /*(not used)*/
+    map->sparse_n = 0;
+
+    /* (map->filter and map->mph* are map->ptr + offset in file; copy) */
+    if (map->filter != NULL) {
+        fpos = (uintptr_t)(map->filter - map->ptr);
+        sz = (uintptr_t)map->filter_n * MCDB_FILTER_BLOCK_SZ;
+        if ((u->filter = u->fn_malloc(sz)) == NULL)
+            return (errno = ENOMEM, false);
+        if (!mcdb_uring_pread(u->fd, u->filter, sz, fpos))
+            return false;
+        map->filter = u->filter;
+    }
+    if (map->mph != NULL) {
+        fpos = (uintptr_t)(map->mph - map->ptr);
+        sz = (uintptr_t)(map->mph_ent - map->mph);
+        if ((u->mph = u->fn_malloc(sz ? sz : 1)) == NULL)
+            return (errno = ENOMEM, false);
+        if (!mcdb_uring_pread(u->fd, u->mph, sz, fpos))
+            return false;
+        map->mph_remap = u->mph + (map->mph_remap - map->mph);
+        map->mph       = u->mph;
+        /* (map->mph_ent remains map->ptr + offset; entries read with ring) */
+    }
+    return true;
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static bool
+mcdb_uring_ring(struct mcdb_uring * const restrict u);
+
+static bool
+mcdb_uring_ring(struct mcdb_uring * const restrict u)
+{
+    struct io_uring_params p;
+    void *x;
+    memset(&p, '\0', sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = u->depth << 1;
+    u->ring = (int)syscall(__NR_io_uring_setup, u->depth, &p);
+    if (u->ring == -1)
+        return false;
+    /* (probe IORING_OP_READ (Linux 5.6) would need io_uring_register();
+     *  IORING_FEAT_RW_CUR_POS was added in same release) */
+    if (!(p.features & IORING_FEAT_RW_CUR_POS))
+        return (errno = ENOSYS, false);
+
+    u->sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->sq_ring_sz < u->cq_ring_sz)
+            u->sq_ring_sz = u->cq_ring_sz;
+        u->cq_ring_sz = u->sq_ring_sz;
+    }
+    x = mmap(0, u->sq_ring_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+             u->ring, IORING_OFF_SQ_RING);
+    if (x == MAP_FAILED)
+        return false;
+    u->sq_ring = x;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        u->cq_ring = u->sq_ring;
+    else {
+        x = mmap(0, u->cq_ring_sz, PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,
+                 u->ring, IORING_OFF_CQ_RING);
+        if (x == MAP_FAILED)
+            return false;
+        u->cq_ring = x;
+    }
+    u->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    x = mmap(0, u->sqes_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+             u->ring, IORING_OFF_SQES);
+    if (x == MAP_FAILED)
+        return false;
+    u->sqes = x;
+
+    u->sq_ktail = (unsigned *)((char *)u->sq_ring + p.sq_off.tail);
+    u->sq_array = (unsigned *)((char *)u->sq_ring + p.sq_off.array);
+    u->sq_mask  = *(unsigned *)((char *)u->sq_ring + p.sq_off.ring_mask);
+    u->sq_tail  = *u->sq_ktail;
+    u->cq_khead = (unsigned *)((char *)u->cq_ring + p.cq_off.head);
+    u->cq_ktail = (unsigned *)((char *)u->cq_ring + p.cq_off.tail);
+    u->cq_mask  = *(unsigned *)((char *)u->cq_ring + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)((char *)u->cq_ring + p.cq_off.cqes);
+
+    /* register mcdb fd (optional; avoids fd lookup per read) */
+    if (syscall(__NR_io_uring_register, u->ring,
+                IORING_REGISTER_FILES, &u->fd, 1) == 0) {
+        u->ffd = 0;
+        u->sqe_flags = IOSQE_FIXED_FILE;
+    }
+    else {
+        u->ffd = u->fd;
+        u->sqe_flags = 0;
+    }
+    return true;
+}
+
+/* queue read into req buffer (submitted by mcdb_uring_complete())
+ * (sq has room: sqes queued <= requests in flight <= depth <= sq_entries) */
+__attribute_nonnull__()
+static void
+mcdb_uring_read(struct mcdb_uring * const restrict u,
+                struct mcdb_uring_req * const restrict req,
+                void * const restrict buf, const uint32_t len,
+                const uint64_t off, const uint32_t state);
+
+static void
+mcdb_uring_read(struct mcdb_uring * const restrict u,
+                struct mcdb_uring_req * const restrict req,
+                void * const restrict buf, const uint32_t len,
+                const uint64_t off, const uint32_t state)
+{
+    const uint32_t idx = u->sq_tail & u->sq_mask;
+    struct io_uring_sqe * const restrict sqe = u->sqes + idx;
+    memset(sqe, '\0', sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READ;
+    sqe->flags     = (uint8_t)u->sqe_flags;
+    sqe->fd        = u->ffd;
+    sqe->off       = off;
+    sqe->addr      = (uint64_t)(uintptr_t)buf;
+    sqe->len       = len;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+    u->sq_array[idx] = idx;
+    ++u->sq_tail;
+    ++u->sq_pending;
+    req->state = state;
+}
+
+__attribute_nonnull__()
+static void
+mcdb_uring_done(struct mcdb_uring * const restrict u,
+                struct mcdb_uring_req * const restrict req, const int status);
+
+static void
+mcdb_uring_done(struct mcdb_uring * const restrict u,
+                struct mcdb_uring_req * const restrict req, const int status)
+{
+    if (req->state != 0) /*(not counted if completed in mcdb_uring_submit())*/
+        --u->inflight;
+    req->status = status;
+    req->state  = 0;
+    req->next   = NULL;
+    *u->done_tail = req;
+    u->done_tail = &req->next;
+}
+
+/* read next run of hash table entries for req
+ * (entries are contiguous from kpos to end of slot hash table, then wrap) */
+__attribute_nonnull__()
+static void
+mcdb_uring_read_ent(struct mcdb_uring * const restrict u,
+                    struct mcdb_uring_req * const restrict req);
+
+static void
+mcdb_uring_read_ent(struct mcdb_uring * const restrict u,
+                    struct mcdb_uring_req * const restrict req)
+{
+    const uint32_t b = u->map.b;
+    const uintptr_t hslots_end = req->hpos + ((uintptr_t)req->hslots << b);
+    uintptr_t n = (hslots_end - req->kpos) >> b;
+    uintptr_t pg = (4096u - (req->kpos & 4095u)) >> b; /*(not past page end)*/
+    if (n > req->hslots - req->loop)
+        n = req->hslots - req->loop;
+    if (n > ((uintptr_t)MCDB_URING_ENTSZ >> b))
+        n = ((uintptr_t)MCDB_URING_ENTSZ >> b);
+    if (n > pg)
+        n = pg;
+    req->nent = (uint32_t)n;
+    req->ient = 0;
+    mcdb_uring_read(u, req, req->ent, (uint32_t)(n << b), req->kpos,
+                    MCDB_URING_ENT);
+}
+
+/* examine entries read (as in mcdb_findtagnext()) and queue read of record
+ * for entry with matching khash, or read of more entries */
+__attribute_nonnull__()
+static void
+mcdb_uring_probe(struct mcdb_uring * const restrict u,
+                 struct mcdb_uring_req * const restrict req);
+
+static void
+mcdb_uring_probe(struct mcdb_uring * const restrict u,
+                 struct mcdb_uring_req * const restrict req)
+{
+    const uint32_t b = u->map.b;
+    const uint32_t klen = (uint32_t)req->klen + (req->tagc != 0);
+    const unsigned char * restrict ptr;
+    uint64_t vpos;
+    size_t sz;
+    bool end = false; /* empty slot ends probe chain */
+    while (req->ient < req->nent) {
+        ptr = (const unsigned char *)req->ent + ((uintptr_t)req->ient << b);
+        ++req->ient;
+        if (b == 3) {
+            vpos = uint32_strunpack_bigendian_aligned_macro(ptr+4);
+            if (!vpos) {
+                end = true;
+                break;
+            }
+            ++req->loop;
+            if (*(uint32_t *)ptr != req->khash)
+                continue;
+        }
+        else {
+            vpos = uint64_strunpack_bigendian_aligned_macro(ptr+8);
+            if (!vpos) {
+                end = true;
+                break;
+            }
+            ++req->loop;
+            if (*(uint32_t *)ptr != req->khash
+                || uint32_strunpack_bigendian_aligned_macro(ptr+4) != klen)
+                continue;
+        }
+        /* read record header, key, and (guess) start of data */
+        sz = 8 + (size_t)klen + MCDB_URING_DATASZ;
+        if (req->bufsz < sz) {
+            u->fn_free(req->buf);
+            req->bufsz = 0;
+            if ((req->buf = u->fn_malloc(sz)) == NULL) {
+                mcdb_uring_done(u, req, -ENOMEM);
+                return;
+            }
+            req->bufsz = sz;
+        }
+        req->vpos = vpos;
+        req->rlen = 0;
+        mcdb_uring_read(u, req, req->buf, (uint32_t)sz, vpos, MCDB_URING_REC);
+        return;
+    }
+    if (!end && req->ient == req->nent && req->loop < req->hslots) {
+        req->kpos += (uintptr_t)req->nent << b;
+        if (req->kpos == req->hpos + ((uintptr_t)req->hslots << b))
+            req->kpos = req->hpos;
+        mcdb_uring_read_ent(u, req);
+        return;
+    }
+    mcdb_uring_done(u, req, MCDB_URING_NOTFOUND);
+}
+
+/* check record read; queue read of remainder of data if needed */
+__attribute_nonnull__()
+static void
+mcdb_uring_rec(struct mcdb_uring * const restrict u,
+               struct mcdb_uring_req * const restrict req);
+
+static void
+mcdb_uring_rec(struct mcdb_uring * const restrict u,
+               struct mcdb_uring_req * const restrict req)
+{
+    const uint32_t klen = (uint32_t)req->klen + (req->tagc != 0);
+    const unsigned char * restrict ptr = req->buf;
+    uint32_t dlen;
+    size_t sz;
+    if (req->rlen < 8 + (size_t)klen
+        || uint32_strunpack_bigendian_macro(ptr) != klen
+        || (req->tagc != 0 && req->tagc != ptr[8])
+        || memcmp(req->key, ptr+8+(req->tagc != 0), req->klen) != 0) {
+        mcdb_uring_probe(u, req);  /*(khash collision; continue probe)*/
+        return;
+    }
+    dlen = uint32_strunpack_bigendian_macro(ptr+4);
+    if (__builtin_expect((dlen & MCDB_DLEN_ALIAS), 0)) {
+        /* alias record (see mcdb.h); read data aliased */
+        if (req->rlen < 8 + (size_t)klen + 8) {
+            mcdb_uring_done(u, req, -EINVAL); /*(truncated mcdb)*/
+            return;
+        }
+        dlen &= ~MCDB_DLEN_ALIAS;
+        req->dlen = dlen;
+        req->vpos += 8 + (uint64_t)klen - mcdb_alias_dist(ptr+8+klen);
+        req->rlen = 0;
+        req->rneed = dlen;
+        if (dlen == 0) {
+            req->data = (char *)req->buf;
+            mcdb_uring_done(u, req, MCDB_URING_FOUND);
+            return;
+        }
+        if (req->bufsz < dlen) {
+            u->fn_free(req->buf);
+            req->bufsz = 0;
+            if ((req->buf = u->fn_malloc(dlen)) == NULL) {
+                mcdb_uring_done(u, req, -ENOMEM);
+                return;
+            }
+            req->bufsz = dlen;
+        }
+        mcdb_uring_read(u, req, req->buf,
+                        dlen < 0x40000000u ? dlen : 0x40000000u,
+                        req->vpos, MCDB_URING_DATA);
+        return;
+    }
+    req->dlen = dlen;
+    sz = 8 + (size_t)klen + dlen;
+    if (sz < dlen) { /*(overflow (32-bit))*/
+        mcdb_uring_done(u, req, -EFBIG);
+        return;
+    }
+    if (req->rlen < sz) {
+        if (req->bufsz < sz) {
+            unsigned char * const buf = u->fn_malloc(sz);
+            if (buf == NULL) {
+                mcdb_uring_done(u, req, -ENOMEM);
+                return;
+            }
+            memcpy(buf, req->buf, req->rlen);
+            u->fn_free(req->buf);
+            req->buf = buf;
+            req->bufsz = sz;
+        }
+        req->rneed = sz;
+        sz -= req->rlen;
+        mcdb_uring_read(u, req, req->buf + req->rlen,
+                        sz < 0x40000000u ? (uint32_t)sz : 0x40000000u,
+                        req->vpos + req->rlen, MCDB_URING_DATA);
+        return;
+    }
+    req->data = (char *)req->buf + 8 + klen;
+    mcdb_uring_done(u, req, MCDB_URING_FOUND);
+}
+
+/* advance request for completed read */
+__attribute_nonnull__()
+static void
+mcdb_uring_cqe(struct mcdb_uring * const restrict u,
+               struct mcdb_uring_req * const restrict req, const int res);
+
+static void
+mcdb_uring_cqe(struct mcdb_uring * const restrict u,
+               struct mcdb_uring_req * const restrict req, const int res)
+{
+    if (res < 0) {
+        mcdb_uring_done(u, req, res);
+        return;
+    }
+    switch (req->state) {
+      case MCDB_URING_ENT:
+        if ((uint32_t)res != (req->nent << u->map.b)) {
+            mcdb_uring_done(u, req, -EINVAL); /*(truncated mcdb)*/
+            return;
+        }
+        mcdb_uring_probe(u, req);
+        break;
+      case MCDB_URING_REC:
+        req->rlen = (size_t)res;
+        mcdb_uring_rec(u, req);
+        break;
+      case MCDB_URING_DATA:
+        if (res == 0) {
+            mcdb_uring_done(u, req, -EINVAL); /*(truncated mcdb)*/
+            return;
+        }
+        req->rlen += (size_t)res;
+        if (req->rlen < req->rneed) {
+            const size_t sz = req->rneed - req->rlen;
+            mcdb_uring_read(u, req, req->buf + req->rlen,
+                            sz < 0x40000000u ? (uint32_t)sz : 0x40000000u,
+                            req->vpos + req->rlen, MCDB_URING_DATA);
+            return;
+        }
+        req->data = (char *)req->buf + (req->rneed - req->dlen);
+        mcdb_uring_done(u, req, MCDB_URING_FOUND);
+        break;
+      default:
+        break;
+    }
+}
+
+/* process available completions; returns num of cqes processed */
+__attribute_nonnull__()
+static uint32_t
+mcdb_uring_reap(struct mcdb_uring * const restrict u);
+
+static uint32_t
+mcdb_uring_reap(struct mcdb_uring * const restrict u)
+{
+    unsigned head = *u->cq_khead;
+    const unsigned tail = *(volatile unsigned *)u->cq_ktail;
+    uint32_t n = 0;
+    plasma_membar_LoadLoad(); /*(cq tail loaded before cqes)*/
+    for (; head != tail; ++head, ++n) {
+        const struct io_uring_cqe * const cqe = u->cqes + (head & u->cq_mask);
+        mcdb_uring_cqe(u, (struct mcdb_uring_req *)(uintptr_t)cqe->user_data,
+                       cqe->res);
+    }
+    if (n) {
+        plasma_membar_LoadStore(); /*(cqes loaded before cq head released)*/
+        *(volatile unsigned *)u->cq_khead = head;
+    }
+    return n;
+}
+
+struct mcdb_uring *
+mcdb_uring_create(const char * const restrict fname, uint32_t depth,
+                  void * (* const fn_malloc)(size_t),
+                  void (* const fn_free)(void *))
+{
+    struct mcdb_uring * const restrict u = fn_malloc(sizeof(struct mcdb_uring));
+    if (u == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(u, '\0', sizeof(struct mcdb_uring));
+    u->fn_malloc = fn_malloc;
+    u->fn_free   = fn_free;
+    u->map.fn_malloc = fn_malloc;
+    u->map.fn_free   = fn_free;
+    u->ring      = -1;
+    u->done_tail = &u->done;
+    if (depth == 0)
+        depth = 1;
+    if (depth > 32768)  /*(IORING_MAX_ENTRIES)*/
+        depth = 32768;
+    u->depth = depth;
+    if ((u->fd = nointr_open(fname, O_RDONLY|O_CLOEXEC, 0)) != -1
+        && mcdb_uring_hdr(u)
+        && mcdb_uring_ring(u))
+        return u;
+    else {
+        const int errnum = errno;
+        mcdb_uring_destroy(u);
+        errno = errnum;
+        return NULL;
+    }
+}
+
+void
+mcdb_uring_destroy(struct mcdb_uring * const restrict u)
+{
+    if (u == NULL)
+        return;
+    /* (closing ring waits for reads in flight to complete or be cancelled) */
+    if (u->sqes != NULL)
+        munmap(u->sqes, u->sqes_sz);
+    if (u->cq_ring != NULL && u->cq_ring != u->sq_ring)
+        munmap(u->cq_ring, u->cq_ring_sz);
+    if (u->sq_ring != NULL)
+        munmap(u->sq_ring, u->sq_ring_sz);
+    if (u->ring != -1)
+        (void) nointr_close(u->ring);
+    if (u->fd != -1)
+        (void) nointr_close(u->fd);
+    u->fn_free(u->mph);
+    u->fn_free(u->filter);
+    u->fn_free(u->map.ptr);
+    u->fn_free(u);
+}
+
+int
+mcdb_uring_submit(struct mcdb_uring * const restrict u,
+                  struct mcdb_uring_req * const restrict req)
+{
+    struct mcdb m;
+    if (u->inflight == u->depth)
+        return (errno = EAGAIN, -1);
+    req->data = NULL;
+    req->dlen = 0;
+    memset(&m, '\0', sizeof(struct mcdb));
+    m.map = &u->map;
+    if (!mcdb_findtagstart(&m, req->key, req->klen, req->tagc)) {
+        mcdb_uring_done(u, req, MCDB_URING_NOTFOUND); /*(empty slot or filter)*/
+        return 0;
+    }
+    req->khash  = m.khash;
+    req->hslots = m.hslots;
+    req->hpos   = m.hpos;
+    req->kpos   = m.kpos;
+    req->loop   = 0;
+    ++u->inflight;
+    mcdb_uring_read_ent(u, req);
+    return 0;
+}
+
+uint32_t
+mcdb_uring_complete(struct mcdb_uring * const restrict u,
+                    struct mcdb_uring_req ** const restrict reqs,
+                    const uint32_t max, const bool wait)
+{
+    uint32_t n = 0;
+    uint32_t min_complete;
+    long rc;
+    for (;;) {
+        while (n < max && u->done != NULL) {
+            struct mcdb_uring_req * const req = u->done;
+            if ((u->done = req->next) == NULL)
+                u->done_tail = &u->done;
+            reqs[n++] = req;
+        }
+        if (n == max)
+            break;
+        if (mcdb_uring_reap(u))
+            continue;
+        min_complete = (n == 0 && wait && u->inflight != 0);
+        if (u->sq_pending == 0 && !min_complete)
+            break;
+        plasma_membar_StoreStore(); /*(sqes stored before sq tail released)*/
+        *(volatile unsigned *)u->sq_ktail = u->sq_tail;
+        rc = syscall(__NR_io_uring_enter, u->ring, u->sq_pending, min_complete,
+                     min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (rc >= 0)
+            u->sq_pending -= (uint32_t)rc;
+        else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            break;
+    }
+    return n;
+}
+
+uint32_t
+mcdb_uring_inflight(const struct mcdb_uring * const restrict u)
+{
+    return u->inflight;
+}
+
+#else  /* !MCDB_URING */
+
+struct mcdb_uring *
+mcdb_uring_create(const char * const restrict fname, uint32_t depth,
+                  void * (* const fn_malloc)(size_t),
+                  void (* const fn_free)(void *))
+{
+    (void)fname; (void)depth; (void)fn_malloc; (void)fn_free;
+    errno = ENOSYS;
+    return NULL;
+}
+
+void
+mcdb_uring_destroy(struct mcdb_uring * const restrict u)
+{
+    (void)u;
+}
+
+int
+mcdb_uring_submit(struct mcdb_uring * const restrict u,
+                  struct mcdb_uring_req * const restrict req)
+{
+    (void)u; (void)req;
+    return (errno = ENOSYS, -1);
+}
+
+uint32_t
+mcdb_uring_complete(struct mcdb_uring * const restrict u,
+                    struct mcdb_uring_req ** const restrict reqs,
+                    const uint32_t max, const bool wait)
+{
+    (void)u; (void)reqs; (void)max; (void)wait;
+    errno = ENOSYS;
+    return 0;
+}
+
+uint32_t
+mcdb_uring_inflight(const struct mcdb_uring * const restrict u)
+{
+    (void)u;
+    return 0;
+}
+
+#endif /* !MCDB_URING */
+
+void
+mcdb_uring_req_free(struct mcdb_uring * const restrict u,
+                    struct mcdb_uring_req * const restrict req)
+{
+  #ifdef MCDB_URING
+    u->fn_free(req->buf);
+  #else
+    (void)u;
+  #endif
+    req->buf   = NULL;
+    req->bufsz = 0;
+    req->data  = NULL;
+}
@@ -0,0 +1,137 @@
+/*
+ * mcdb_uring - asynchronous mcdb lookups with io_uring (Linux)
+ *
+ * Copyright (c) 2026, Glue Logic LLC. All rights reserved. code()gluelogic.com
+ *
+ *  This file is part of mcdb.
+ *
+ *  mcdb is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mcdb is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with mcdb.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * mcdb is originally based upon the Public Domain cdb-0.75 by Dan Bernstein
+ */
+
+/* mcdb_uring is an opt-in lookup backend which does not mmap() the mcdb.
+ * The mcdb header, negative lookup filter and mph index pilots are read into
+ * memory when opened; hash table entries and records are read with io_uring
+ * so that a single thread can keep many lookups in flight against storage,
+ * instead of each lookup blocking its thread on a major page fault when the
+ * mcdb is larger than memory.  On-disk format is unchanged.
+ *
+ * Usage: fill in key, klen, tagc of struct mcdb_uring_req (zero-initialized
+ * before first use), mcdb_uring_submit() up to depth requests, and call
+ * mcdb_uring_complete() to collect finished requests.  A request may be
+ * resubmitted once completed; mcdb_uring_req_free() releases its buffer.
+ * Key must remain valid until the request completes.  Data of record found
+ * is valid until request is resubmitted or freed.  Only the first record for
+ * a key is returned (as mcdb_find()).  mcdb file is not refreshed.
+ * A struct mcdb_uring must not be used concurrently by multiple threads.
+ *
+ * Not available (ENOSYS) on platforms other than Linux, or if compiled with
+ * -DMCDB_NO_URING */
+
+#ifndef INCLUDED_MCDB_URING_H
+#define INCLUDED_MCDB_URING_H
+
+#include "plasma/plasma_feature.h"
+#include "plasma/plasma_attr.h"
+#include "plasma/plasma_stdtypes.h" /* size_t, uint32_t, uintptr_t */
+PLASMA_ATTR_Pragma_once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mcdb_uring;           /* ring and mcdb index (see mcdb_uring.c) */
+
+/* status of completed request */
+#define MCDB_URING_NOTFOUND 0
+#define MCDB_URING_FOUND    1
+/* (negative status is -errno) */
+
+/* (entries read per hash table read (bytes); also limited to slot and page) */
+#define MCDB_URING_ENTSZ    256
+/* (data bytes read along with key in first record read (guess)) */
+#define MCDB_URING_DATASZ   256
+
+struct mcdb_uring_req {
+  const char *key;            /* key (set by caller) */
+  size_t klen;                /* key length (set by caller) */
+  void *vp;                   /* user-provided extension data */
+  unsigned char tagc;         /* tag char (set by caller; 0 if none) */
+  int status;                 /* MCDB_URING_FOUND, MCDB_URING_NOTFOUND, -errno*/
+  char *data;                 /* data of record found */
+  uint32_t dlen;              /* data length of record found */
+  /* (fields below are managed by mcdb_uring) */
+  uint32_t khash;             /* khash (stored bigendian) */
+  uint32_t hslots;            /* num of hash slots for khash */
+  uint32_t loop;              /* num of hash slots searched */
+  uint32_t nent;              /* num entries in ent[] */
+  uint32_t ient;              /* next entry to examine in ent[] */
+  uint32_t state;             /* read in flight (see mcdb_uring.c) */
+  uintptr_t hpos;             /* offset of slot hash table */
+  uintptr_t kpos;             /* offset of ent[0] */
+  uint64_t vpos;              /* offset of record (or of data aliased) */
+  size_t rlen;                /* bytes read into buf */
+  size_t rneed;               /* bytes of record needed in buf */
+  unsigned char *buf;         /* record buffer */
+  size_t bufsz;               /* record buffer size */
+  struct mcdb_uring_req *next;/* next on list of completed requests */
+  uint64_t ent[MCDB_URING_ENTSZ/8]; /* hash table entries */
+};
+
+__attribute_malloc__
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern struct mcdb_uring *
+mcdb_uring_create(const char * restrict, uint32_t,
+                  void * (*)(size_t), void (*)(void *));
+
+EXPORT extern void
+mcdb_uring_destroy(struct mcdb_uring * restrict);
+
+/* begin lookup of req->key (returns 0, or -1 and errno EAGAIN if depth
+ * requests already in flight; request which needs no read (e.g. filter miss)
+ * is completed immediately and returned by next mcdb_uring_complete()) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+EXPORT extern int
+mcdb_uring_submit(struct mcdb_uring * restrict,
+                  struct mcdb_uring_req * restrict);
+
+/* submit queued reads, process completed reads, and store up to max completed
+ * requests in array; waits for at least one completed request if wait is true
+ * and requests are in flight.  Returns num of completed requests stored.
+ * (returns 0 with errno set if io_uring_enter() fails) */
+__attribute_nonnull__()
+EXPORT extern uint32_t
+mcdb_uring_complete(struct mcdb_uring * restrict,
+                    struct mcdb_uring_req ** restrict, uint32_t, bool);
+
+/* num of requests submitted and not yet completed */
+__attribute_nonnull__()
+__attribute_pure__
+EXPORT extern uint32_t
+mcdb_uring_inflight(const struct mcdb_uring * restrict);
+
+__attribute_nonnull__()
+EXPORT extern void
+mcdb_uring_req_free(struct mcdb_uring * restrict,
+                    struct mcdb_uring_req * restrict);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,6 +28,9 @@
 #ifndef _XOPEN_SOURCE /* IOV_MAX */
 #define _XOPEN_SOURCE 600
 #endif
+#ifndef _GNU_SOURCE /* F_SETPIPE_SZ on Linux */
+#define _GNU_SOURCE 1
+#endif
 /* large file support needed for open() input file > 2 GB */
 #define PLASMA_FEATURE_ENABLE_LARGEFILE
 
@@ -42,6 +45,9 @@
 
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/wait.h>/* waitpid() */
+#include <errno.h>   /* errno, EIO */
+#include <signal.h>  /* SIGPIPE */
 #include <fcntl.h>   /* open(), O_RDONLY */
 #include <stdio.h>   /* printf() */
 #include <stdlib.h>  /* malloc(), free(), EXIT_SUCCESS */
@@ -49,6 +55,9 @@
 #include <unistd.h>  /* STDIN_FILENO, STDOUT_FILENO */
 #include <sys/uio.h> /* writev() */
 #include <limits.h>  /* IOV_MAX, SSIZE_MAX */
+#ifdef _THREAD_SAFE
+#include <pthread.h> /* pthread_create(), pthread_join() */
+#endif
 
 /*(posix_madvise, defines not provided in Solaris 10, even w/ __EXTENSIONS__)*/
 #if (defined(__sun) || defined(__hpux)) && !defined(POSIX_MADV_NORMAL)
@@ -120,14 +129,201 @@ writev_loop(const int fd, struct iovec * restrict iov, int iovcnt, ssize_t sz)
     return (iovcnt == 0);
 }
 
-/* read and dump data section of mcdb */
+/* num threads to iterate mcdb data section in parallel
+ * (requires sparse record offset index; one thread per online CPU) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static uint32_t
+mcdbctl_nthreads(const struct mcdb_mmap * const restrict map);
+
+static uint32_t
+mcdbctl_nthreads(const struct mcdb_mmap * const restrict map)
+{
+  #ifdef _THREAD_SAFE
+    long n = plasma_sysconf_nprocessors_onln();
+    if (n > 256)
+        n = 256;
+    return (map->sparse_n == 0 || n <= 1)
+      ? 1
+      : (uint32_t)n < map->sparse_n ? (uint32_t)n : map->sparse_n;
+  #else
+    return 1;
+  #endif
+}
+
+/* binary dump (mcdbctl dump <mcdb> bin): MCDB_MAKEFMT_BIN format
+ * (see mcdb_makefmt.h); record header is klen, dlen little-endian */
+static const char mcdbctl_bin_end[8] =
+  { '\xff','\xff','\xff','\xff','\xff','\xff','\xff','\xff' };
+
+static inline void
+mcdbctl_bin_hdr(char * const restrict s, const uint32_t klen,
+                const uint32_t dlen)
+{
+    s[0] = (char)(klen);       s[4] = (char)(dlen);
+    s[1] = (char)(klen >> 8);  s[5] = (char)(dlen >> 8);
+    s[2] = (char)(klen >> 16); s[6] = (char)(dlen >> 16);
+    s[3] = (char)(klen >> 24); s[7] = (char)(dlen >> 24);
+}
+
+#ifdef _THREAD_SAFE
+
+/* parallel dump: each sparse index interval is a chunk; threads take chunks
+ * in order, format chunk into thread buffer, and write buffers in chunk order*/
+struct mcdbctl_dump_ctx {
+  struct mcdb *m;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  uint32_t nchunks;
+  uint32_t next_chunk;        /* next chunk to format */
+  uint32_t next_write;        /* next chunk to write */
+  int rv;
+  bool bin;                   /* MCDB_MAKEFMT_BIN format */
+};
+
+static void *
+mcdbctl_dump_thread(void * const arg)
+{
+    struct mcdbctl_dump_ctx * const restrict ctx = arg;
+    struct mcdb_iter iter;
+    struct iovec iov;
+    char *buf = NULL;
+    char *nbuf;
+    size_t bufsz = 0;
+    size_t len;
+    size_t need;
+    uint32_t klen;
+    uint32_t dlen;
+    uint32_t c;
+    int rv = EXIT_SUCCESS;
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->mutex);
+        c = ctx->next_chunk++;
+        pthread_mutex_unlock(&ctx->mutex);
+        if (c >= ctx->nchunks)
+            break;
+
+        /* format chunk (same output as serial mcdbctl_dump()) */
+        len = 0;
+        if (!mcdb_iter_init_range(&iter, ctx->m, c, ctx->nchunks))
+            rv = MCDB_ERROR_READFORMAT;
+        else while (mcdb_iter(&iter)) {
+            klen = mcdb_iter_keylen(&iter);
+            dlen = mcdb_iter_datalen(&iter);
+            need = len + (size_t)klen + (size_t)dlen + 26; /*(2*10 + 6)*/
+            if (need > bufsz) {
+                bufsz = (need > (bufsz << 1)) ? need : (bufsz << 1);
+                if ((nbuf = realloc(buf, bufsz)) == NULL) {
+                    rv = MCDB_ERROR_MALLOC;
+                    break;
+                }
+                buf = nbuf;
+            }
+            if (ctx->bin) {
+                mcdbctl_bin_hdr(buf+len, klen, dlen);
+                len += 8;
+                memcpy(buf+len, mcdb_iter_keyptr(&iter), klen);
+                len += klen;
+                memcpy(buf+len, mcdb_iter_dataptr(&iter), dlen);
+                len += dlen;
+                continue;
+            }
+            buf[len++] = '+';
+            len += uint32_to_ascii_base10(klen, buf+len);
+            buf[len++] = ',';
+            len += uint32_to_ascii_base10(dlen, buf+len);
+            buf[len++] = ':';
+            memcpy(buf+len, mcdb_iter_keyptr(&iter), klen);
+            len += klen;
+            buf[len++] = '-';
+            buf[len++] = '>';
+            memcpy(buf+len, mcdb_iter_dataptr(&iter), dlen);
+            len += dlen;
+            buf[len++] = '\n';
+        }
+
+        /* wait for turn; write chunk */
+        pthread_mutex_lock(&ctx->mutex);
+        while (ctx->next_write != c && ctx->rv == EXIT_SUCCESS)
+            pthread_cond_wait(&ctx->cond, &ctx->mutex);
+        if (ctx->rv != EXIT_SUCCESS)
+            rv = ctx->rv;
+        pthread_mutex_unlock(&ctx->mutex);
+        if (rv == EXIT_SUCCESS && len != 0) {
+            iov.iov_base = buf;
+            iov.iov_len  = len;
+            if (!writev_loop(STDOUT_FILENO, &iov, 1, (ssize_t)len))
+                rv = MCDB_ERROR_WRITE;
+        }
+        pthread_mutex_lock(&ctx->mutex);
+        if (rv != EXIT_SUCCESS && ctx->rv == EXIT_SUCCESS)
+            ctx->rv = rv;
+        ++ctx->next_write;
+        pthread_cond_broadcast(&ctx->cond);
+        pthread_mutex_unlock(&ctx->mutex);
+        if (rv != EXIT_SUCCESS)
+            break;
+    }
+
+    free(buf);
+    return NULL;
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdbctl_dump_parallel(struct mcdb * const restrict m, const uint32_t nthreads,
+                      const bool bin);
+
+static int
+mcdbctl_dump_parallel(struct mcdb * const restrict m, const uint32_t nthreads,
+                      const bool bin)
+{
+    struct mcdbctl_dump_ctx ctx;
+    pthread_t tids[256];
+    uint32_t i;
+    ctx.m          = m;
+    ctx.nchunks    = m->map->sparse_n;
+    ctx.next_chunk = 0;
+    ctx.next_write = 0;
+    ctx.rv         = EXIT_SUCCESS;
+    ctx.bin        = bin;
+    if (pthread_mutex_init(&ctx.mutex, NULL) != 0)
+        return MCDB_ERROR_MALLOC;
+    if (pthread_cond_init(&ctx.cond, NULL) != 0) {
+        pthread_mutex_destroy(&ctx.mutex);
+        return MCDB_ERROR_MALLOC;
+    }
+    posix_madvise(m->map->ptr, m->map->size, POSIX_MADV_WILLNEED);
+    for (i = 0; i < nthreads; ++i) {
+        if (pthread_create(tids+i, NULL, mcdbctl_dump_thread, &ctx) != 0)
+            break;
+    }
+    if (i == 0)  /*(run in current thread if no thread could be created)*/
+        mcdbctl_dump_thread(&ctx);
+    while (i)
+        pthread_join(tids[--i], NULL);
+    pthread_cond_destroy(&ctx.cond);
+    pthread_mutex_destroy(&ctx.mutex);
+    if (ctx.rv == EXIT_SUCCESS
+        && (bin
+            ? write(STDOUT_FILENO, mcdbctl_bin_end, 8) != 8
+            : write(STDOUT_FILENO, "\n", 1) != 1))
+        ctx.rv = MCDB_ERROR_WRITE;
+    return ctx.rv;
+}
+
+#endif /* _THREAD_SAFE */
+
+/* read and dump data section of mcdb (cdbmake format, or binary if bin) */
 __attribute_nonnull__()
 __attribute_warn_unused_result__
 static int
-mcdbctl_dump(struct mcdb * const restrict m);
+mcdbctl_dump(struct mcdb * const restrict m, const bool bin);
 
 static int
-mcdbctl_dump(struct mcdb * const restrict m)
+mcdbctl_dump(struct mcdb * const restrict m, const bool bin)
 {
     struct mcdb_iter iter;
     uint32_t klen;
@@ -141,6 +337,18 @@ mcdbctl_dump(struct mcdb * const restrict m)
     char buf[(MCDB_IOVNUM * 3)];   /* each db entry might use (2) * 10 chars */
       /* oversized buffer since all num strings must add up to less than max */
 
+  #ifdef _THREAD_SAFE
+    const uint32_t nthreads = mcdbctl_nthreads(m->map);
+  #endif
+
+    if (bin && write(STDOUT_FILENO, MCDB_MAKEFMT_BIN_MAGIC, 8) != 8)
+        return MCDB_ERROR_WRITE;
+
+  #ifdef _THREAD_SAFE
+    if (nthreads > 1)
+        return mcdbctl_dump_parallel(m, nthreads, bin);
+  #endif
+
     mcdb_iter_init(&iter, m);
     posix_madvise(iter.map, (size_t)(iter.eod - (unsigned char *)iter.map),
                   POSIX_MADV_WILLNEED);
@@ -149,6 +357,46 @@ mcdbctl_dump(struct mcdb * const restrict m)
         klen = mcdb_iter_keylen(&iter);
         dlen = mcdb_iter_datalen(&iter);
 
+        if (bin) {
+            /* klen, dlen each limited to (2GB - 8) */
+            if (iovlen + klen + 8 > SSIZE_MAX || iovcnt + 3 >= MCDB_IOVNUM) {
+                if (!writev_loop(STDOUT_FILENO, iov, iovcnt, (ssize_t)iovlen))
+                    return MCDB_ERROR_WRITE;
+                iovcnt = 0;
+                iovlen = 0;
+                buflen = 0;
+                mcdb_madv_dontneed(iter.ptr, mark);
+            }
+
+            mcdbctl_bin_hdr(buf+buflen, klen, dlen);
+            iov[iovcnt].iov_base = buf+buflen;
+            iov[iovcnt].iov_len  = 8;
+            buflen += 8;
+            ++iovcnt;
+
+            iov[iovcnt].iov_base = mcdb_iter_keyptr(&iter);
+            iov[iovcnt].iov_len  = klen;
+            ++iovcnt;
+
+            iovlen += (size_t)klen + 8;
+
+            if (iovlen + dlen > SSIZE_MAX) {
+                if (!writev_loop(STDOUT_FILENO, iov, iovcnt, (ssize_t)iovlen))
+                    return MCDB_ERROR_WRITE;
+                iovcnt = 0;
+                iovlen = 0;
+                buflen = 0;
+                mcdb_madv_dontneed(iter.ptr, mark);
+            }
+
+            iov[iovcnt].iov_base = mcdb_iter_dataptr(&iter);
+            iov[iovcnt].iov_len  = dlen;
+            ++iovcnt;
+
+            iovlen += (size_t)dlen;
+            continue;
+        }
+
         /* avoid printf("%.*s\n",...) due to mcdb arbitrary binary data */
         /* klen, dlen each limited to (2GB - 8); space for extra tokens exists*/
         if (iovlen + klen + 5 > SSIZE_MAX || iovcnt + 8 >= MCDB_IOVNUM) {
@@ -211,35 +459,44 @@ mcdbctl_dump(struct mcdb * const restrict m)
 
     }
 
-    /* write out iovecs and append blank line ("\n") to indicate end of data */
+    /* write out iovecs and append blank line ("\n") to indicate end of data
+     * (or end marker if bin) */
     return (writev_loop(STDOUT_FILENO, iov, iovcnt, (ssize_t)iovlen)
-            && write(STDOUT_FILENO, "\n", 1) == 1)
+            && (bin
+                ? write(STDOUT_FILENO, mcdbctl_bin_end, 8) == 8
+                : write(STDOUT_FILENO, "\n", 1) == 1))
       ? EXIT_SUCCESS
       : MCDB_ERROR_WRITE;
 }
 
 /* Note: mcdbctl_stats() is equivalent test to pass/fail of djb cdbtest */
-__attribute_nonnull__()
-__attribute_warn_unused_result__
-static int
-mcdbctl_stats(struct mcdb * const restrict m);
+struct mcdbctl_stats_part {
+  struct mcdb m;              /* (per thread struct mcdb for queries) */
+  uint32_t part;
+  uint32_t nparts;
+  int rv;
+  unsigned long nrec;
+  unsigned long nunindexed;
+  unsigned long numd[11];
+};
 
-static int
-mcdbctl_stats(struct mcdb * const restrict m)
+/* track number of tries before found for each record in part of data */
+static void *
+mcdbctl_stats_range(void * const arg)
 {
+    struct mcdbctl_stats_part * const restrict st = arg;
+    struct mcdb * const restrict m = &st->m;
     struct mcdb_iter iter;
     uintptr_t iter_dpos;
     char *k;
-    unsigned char *mark = mcdb_madv_initmark(m->map->ptr, m->map->size,
-                                             MCDB_HEADER_SZ);
-    unsigned long nrec = 0;
-    unsigned long numd[11] = { 0,0,0,0,0,0,0,0,0,0,0 };
-    int rv;
+    unsigned char *mark;
     bool rc;
-    posix_madvise(m->map->ptr, m->map->size, POSIX_MADV_WILLNEED);
-    if (!mcdb_validate_slots(m))
-        return MCDB_ERROR_READFORMAT;
-    mcdb_iter_init(&iter, m);
+    if (!mcdb_iter_init_range(&iter, m, st->part, st->nparts)) {
+        st->rv = MCDB_ERROR_READFORMAT;
+        return NULL;
+    }
+    mark = mcdb_madv_initmark(m->map->ptr, m->map->size,
+                              (size_t)(iter.ptr - m->map->ptr));
     while (mcdb_iter(&iter)) {
         /* Search for key,data and track number of tries before found.
          * Technically, passing m (which contains m->map->ptr) and an
@@ -250,16 +507,81 @@ mcdbctl_stats(struct mcdb * const restrict m)
         if ((rc = mcdb_findstart(m, k, mcdb_iter_keylen(&iter)))) {
             do { rc = mcdb_findnext(m, k, mcdb_iter_keylen(&iter));
             } while (rc && mcdb_datapos(m) != iter_dpos);
+            /* (mph index contains only first record for each key) */
+            if (!rc && m->map->mph != NULL
+                && mcdb_find(m, k, mcdb_iter_keylen(&iter))) {
+                ++st->nunindexed;
+                ++st->nrec;
+                mcdb_madv_dontneed(iter.ptr, mark);
+                continue;
+            }
+        }
+        if (!rc) {
+            st->rv = MCDB_ERROR_READFORMAT;
+            return NULL;
         }
-        if (!rc) return MCDB_ERROR_READFORMAT;
-        ++numd[ ((m->loop < 11) ? m->loop - 1 : 10) ];
-        ++nrec;
+        ++st->numd[ ((m->loop < 11) ? m->loop - 1 : 10) ];
+        ++st->nrec;
         mcdb_madv_dontneed(iter.ptr, mark);  /* hint to release memory pages */
     }
-    printf("records %lu\n", nrec);
+    return NULL;
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdbctl_stats(struct mcdb * const restrict m);
+
+static int
+mcdbctl_stats(struct mcdb * const restrict m)
+{
+    struct mcdbctl_stats_part st[256];
+    const uint32_t nthreads = mcdbctl_nthreads(m->map);
+    uint32_t i;
+    uint32_t j;
+    int rv;
+  #ifdef _THREAD_SAFE
+    pthread_t tids[256];
+  #endif
+    posix_madvise(m->map->ptr, m->map->size, POSIX_MADV_WILLNEED);
+    if (!mcdb_validate_slots(m))
+        return MCDB_ERROR_READFORMAT;
+    memset(st, '\0', nthreads * sizeof(struct mcdbctl_stats_part));
+    for (i = 0; i < nthreads; ++i) {
+        st[i].m.map  = m->map;
+        st[i].part   = i;
+        st[i].nparts = nthreads;
+        st[i].rv     = EXIT_SUCCESS;
+    }
+  #ifdef _THREAD_SAFE
+    for (i = 1; i < nthreads; ++i) {
+        if (pthread_create(tids+i, NULL, mcdbctl_stats_range, st+i) != 0)
+            break;
+    }
+    for (j = i; j < nthreads; ++j)  /*(run in current thread if create fails)*/
+        mcdbctl_stats_range(st+j);
+    mcdbctl_stats_range(st);
+    while (--i)
+        pthread_join(tids[i], NULL);
+  #else
+    mcdbctl_stats_range(st);
+  #endif
+    for (i = 1; i < nthreads; ++i) {
+        if (st[i].rv != EXIT_SUCCESS)
+            st[0].rv = st[i].rv;
+        st[0].nrec += st[i].nrec;
+        st[0].nunindexed += st[i].nunindexed;
+        for (j = 0; j < 11; ++j)
+            st[0].numd[j] += st[i].numd[j];
+    }
+    if (st[0].rv != EXIT_SUCCESS)
+        return st[0].rv;
+    printf("records %lu\n", st[0].nrec);
     for (rv = 0; rv < 10; ++rv)
-        printf("d%d      %lu\n", rv, numd[rv]);
-    printf(">9      %lu\n", numd[10]);
+        printf("d%d      %lu\n", rv, st[0].numd[rv]);
+    printf(">9      %lu\n", st[0].numd[10]);
+    if (m->map->mph != NULL)
+        printf("unindexed %lu\n", st[0].nunindexed);
     return EXIT_SUCCESS;
 }
 
@@ -334,7 +656,7 @@ mcdbctl_query(const int argc, char ** restrict argv)
     int fd;
     unsigned long seq = 0;
     enum { MCDBCTL_BAD_QUERY_TYPE, MCDBCTL_GET, MCDBCTL_GETALL,
-           MCDBCTL_DUMP, MCDBCTL_STATS }
+           MCDBCTL_DUMP, MCDBCTL_DUMPBIN, MCDBCTL_STATS }
       query_type = MCDBCTL_BAD_QUERY_TYPE;
 
     /* validate args  (query type string == argv[1]) */
@@ -356,6 +678,10 @@ mcdbctl_query(const int argc, char ** restrict argv)
         else if (0 == strcmp(argv[1], "stats"))
             query_type = MCDBCTL_STATS;
     }
+    else if (argc == 4 && 0 == strcmp(argv[1], "dump")) {
+        if (0 == strcmp(argv[3], "bin"))
+            query_type = MCDBCTL_DUMPBIN;
+    }
 
     if (query_type == MCDBCTL_BAD_QUERY_TYPE)
         return MCDB_ERROR_USAGE;
@@ -367,7 +693,7 @@ mcdbctl_query(const int argc, char ** restrict argv)
     rv = mcdb_mmap_init(&map, fd);
     (void) nointr_close(fd);
     if (!rv) return MCDB_ERROR_READ;
-    memset(&m, '\0', sizeof(m));      /*(not strictly necessary)*/
+    memset(&m, '\0', sizeof(m));      /*(init m.rd = NULL; see struct mcdb)*/
     m.map = &map;
 
     /* run query */
@@ -383,7 +709,10 @@ mcdbctl_query(const int argc, char ** restrict argv)
             exit(100); /* not found: exit nonzero without errmsg */
         break;
       case MCDBCTL_DUMP:
-        rv = mcdbctl_dump(&m);
+        rv = mcdbctl_dump(&m, false);
+        break;
+      case MCDBCTL_DUMPBIN:
+        rv = mcdbctl_dump(&m, true);
         break;
       case MCDBCTL_STATS:
         rv = mcdbctl_stats(&m);
@@ -398,26 +727,278 @@ mcdbctl_query(const int argc, char ** restrict argv)
     return rv;
 }
 
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static pid_t
+mcdbctl_make_decompress(int * const restrict fd, const size_t bufsz);
+
+/* compressed input (gzip or zstd magic at current offset of *fd) is
+ * decompressed by gzip -dc or zstd -dc in a child process writing to a pipe
+ * read by mcdb_makefmt, so that read and decompress of input run alongside
+ * parse.  Input that is not seekable (e.g. a pipe) is read as-is.
+ * Returns pid of child (and *fd is replaced by read end of pipe),
+ * 0 if input is not compressed, or -1 on error */
+static pid_t
+mcdbctl_make_decompress(int * const restrict fd, const size_t bufsz)
+{
+    static const char * const gz[]  = { "gzip", "-dc", NULL };
+    static const char * const zst[] = { "zstd", "-dcq", NULL };
+    const char * const *args;
+    unsigned char magic[4];
+    int pfd[2];
+    pid_t pid;
+    const off_t off = lseek(*fd, 0, SEEK_CUR);
+    if (off == -1 || pread(*fd, magic, sizeof(magic), off) != sizeof(magic))
+        return 0;
+    if (magic[0] == 0x1f && magic[1] == 0x8b)
+        args = gz;
+    else if (magic[0] == 0x28 && magic[1] == 0xb5
+             && magic[2] == 0x2f && magic[3] == 0xfd)
+        args = zst;
+    else
+        return 0;
+
+    if (pipe(pfd) != 0)
+        return -1;
+  #ifdef F_SETPIPE_SZ
+    /* enlarge pipe (up to bufsz, limited by fs.pipe-max-size) so that
+     * decompressor runs ahead of parse (not an error if not enlarged) */
+    for (size_t sz = bufsz < (1u << 30) ? bufsz : (1u << 30);
+         sz > 65536 && fcntl(pfd[1], F_SETPIPE_SZ, (int)sz) == -1; sz >>= 1)
+        ;
+  #else
+    (void)bufsz;
+  #endif
+
+    pid = fork();
+    if (pid == 0) {
+        if (dup2(*fd, STDIN_FILENO) != -1 && dup2(pfd[1], STDOUT_FILENO) != -1){
+            /*(input offset is shared with dup2() of *fd)*/
+            (void) close(pfd[0]);
+            (void) close(pfd[1]);
+            if (*fd != STDIN_FILENO)
+                (void) close(*fd);
+            execvp(args[0], (char * const *)args);
+        }
+        perror(args[0]);
+        _exit(127);
+    }
+    (void) nointr_close(pfd[1]);
+    if (pid == -1) {
+        (void) nointr_close(pfd[0]);
+        return -1;
+    }
+    if (*fd != STDIN_FILENO)
+        (void) nointr_close(*fd);
+    *fd = pfd[0];
+    return pid;
+}
+
+/* (decompressor killed by SIGPIPE when parse stops early is not a failure;
+ *  parse error is reported instead) */
+__attribute_warn_unused_result__
+static bool
+mcdbctl_make_reap(const pid_t pid);
+
+static bool
+mcdbctl_make_reap(const pid_t pid)
+{
+    int status;
+    pid_t r;
+    retry_eintr_do_while((r = waitpid(pid, &status, 0)), (r == -1));
+    return r == pid
+        && (WIFEXITED(status)
+            ? WEXITSTATUS(status) == 0
+            : WIFSIGNALED(status) && WTERMSIG(status) == SIGPIPE);
+}
+
 __attribute_nonnull__()
 __attribute_warn_unused_result__
 static int
-mcdbctl_make(const int argc __attribute_unused__, char ** const restrict argv);
+mcdbctl_make(const int argc, char ** const restrict argv);
 
 static int
-mcdbctl_make(const int argc __attribute_unused__, char ** const restrict argv)
+mcdbctl_make(const int argc, char ** const restrict argv)
 {
-    /* assert(argc == 4); */                   /* must be checked by caller */
+    /* assert(argc >= 4); */                   /* must be checked by caller */
     /* assert(0 == strcmp(argv[1], "make")); *//* must be checked by caller */
-    enum { BUFSZ = 65536 }; /* 64 KB buffer size */
-    char * restrict buf = NULL;
-    char * const fname = argv[2];
-    char * const input = argv[3];
-    const int rv = (input[0] == '-' && input[1] == '\0')
-      ? ((buf = malloc(BUFSZ)) != NULL)
-        ? mcdb_makefmt_fdintofile(STDIN_FILENO, buf, BUFSZ, fname, malloc, free)
-        : MCDB_ERROR_MALLOC
-      : mcdb_makefmt_fileintofile(input, fname, malloc, free);
-    free(buf);
+    struct mcdb_make m;
+    char * restrict buf;
+    size_t bufsz = 1u << 22; /* 4 MB read buffer size */
+    char *fname;
+    char *input;
+    char *endptr;
+    unsigned long seed;
+    struct mcdb_makefmt_opts opts;
+    int rv;
+    int fd;
+    pid_t pid;
+    bool seeded = false;
+    bool hashed = false;
+
+    /* options: -h <hash> (djb|xxh32) -s <hash seed> -b <filter bits per key>
+     *          -i <index> (hash|mph) -o <sparse offset index interval bytes>
+     *          -j <threads to parse input file and build hash tables>
+     *             (default: num online CPUs to build hash tables; input
+     *              file is parsed in chunks only if -j is given)
+     *          -m <memory for hash/position entries; spill to $TMPDIR>
+     *          -c (drop mcdb from page cache once written)
+     *          -u <duplicate keys> (first|last|reject) (default: keep all)
+     *          -a (alias records with same data as prior record)
+     *          -f <input format> (cdb|tsv|jsonl|bin) (default: cdb)
+     *             (binary input is recognized by magic if cdb)
+     *          -r <read buffer bytes> (stdin or compressed input)
+     *             (default: 4 MB) */
+    mcdb_makefmt_opts_init(&opts);
+    opts.nthreads = 0;
+    while ((rv = getopt(argc-1, argv+1, "ab:cf:h:i:j:m:o:r:s:u:")) != -1) {
+        switch (rv) {
+          case 'a':
+            opts.dedup = 1;
+            break;
+          case 'b':
+            seed = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || seed > 64)
+                return MCDB_ERROR_USAGE;
+            opts.filter_bits = (uint32_t)seed;
+            break;
+          case 'c':
+            opts.nocache = 1;
+            break;
+          case 'f':
+            if (0 == strcmp(optarg, "cdb"))
+                opts.format = MCDB_MAKEFMT_CDB;
+            else if (0 == strcmp(optarg, "tsv"))
+                opts.format = MCDB_MAKEFMT_TSV;
+            else if (0 == strcmp(optarg, "jsonl"))
+                opts.format = MCDB_MAKEFMT_JSONL;
+            else if (0 == strcmp(optarg, "bin"))
+                opts.format = MCDB_MAKEFMT_BIN;
+            else
+                return MCDB_ERROR_USAGE;
+            break;
+          case 'h':
+            if (0 == strcmp(optarg, "djb"))
+                opts.hash_id = MCDB_HASH_DJB;
+            else if (0 == strcmp(optarg, "xxh32"))
+                opts.hash_id = MCDB_HASH_XXH32;
+            else
+                return MCDB_ERROR_USAGE;
+            hashed = true;
+            break;
+          case 'i':
+            if (0 == strcmp(optarg, "hash"))
+                opts.index = MCDB_INDEX_HASH;
+            else if (0 == strcmp(optarg, "mph"))
+                opts.index = MCDB_INDEX_MPH;
+            else
+                return MCDB_ERROR_USAGE;
+            break;
+          case 'j':
+            seed = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || seed == 0 || seed > 256)
+                return MCDB_ERROR_USAGE;
+            opts.nthreads = (uint32_t)seed;
+            opts.parse_threads = (uint32_t)seed;
+            break;
+          case 'm':
+            seed = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || seed > SIZE_MAX)
+                return MCDB_ERROR_USAGE;
+            opts.spill_sz = (size_t)seed;
+            break;
+          case 'o':
+            seed = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || seed > UINT32_MAX)
+                return MCDB_ERROR_USAGE;
+            opts.sparse_sz = (uint32_t)seed;
+            break;
+          case 'r':
+            seed = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0'
+                || seed < 4096 || seed > (1u << 30))
+                return MCDB_ERROR_USAGE;
+            bufsz = (size_t)seed;
+            break;
+          case 's':
+            seed = strtoul(optarg, &endptr, 0);
+            if (optarg == endptr || *endptr != '\0' || seed > UINT32_MAX)
+                return MCDB_ERROR_USAGE;
+            opts.hash_init = (uint32_t)seed;
+            seeded = true;
+            break;
+          case 'u':
+            if (0 == strcmp(optarg, "first"))
+                opts.unique = MCDB_MAKE_UNIQUE_FIRST;
+            else if (0 == strcmp(optarg, "last"))
+                opts.unique = MCDB_MAKE_UNIQUE_LAST;
+            else if (0 == strcmp(optarg, "reject"))
+                opts.unique = MCDB_MAKE_UNIQUE_REJECT;
+            else
+                return MCDB_ERROR_USAGE;
+            break;
+          default:
+            return MCDB_ERROR_USAGE;
+        }
+    }
+    if (argc-1 - optind != 2)
+        return MCDB_ERROR_USAGE;
+    fname = argv[1+optind];
+    input = argv[2+optind];
+    if (opts.dedup && opts.unique != MCDB_MAKE_UNIQUE_NONE)
+        return MCDB_ERROR_USAGE;
+    if (opts.index == MCDB_INDEX_MPH) { /*(mph index requires xxh32 hash)*/
+        if ((hashed && opts.hash_id != MCDB_HASH_XXH32) || opts.spill_sz != 0
+            || opts.unique != MCDB_MAKE_UNIQUE_NONE)
+            return MCDB_ERROR_USAGE;
+        opts.hash_id = MCDB_HASH_XXH32;
+    }
+    if (!seeded && opts.hash_id != MCDB_HASH_DJB)
+        opts.hash_init = 0;
+    if (opts.nthreads == 0) {
+        const long n = plasma_sysconf_nprocessors_onln();
+        opts.nthreads = n > 1 ? (n < 256 ? (uint32_t)n : 256) : 1;
+    }
+
+    /* input file not compressed is mmap'd; others are read into buf */
+    fd = (input[0] == '-' && input[1] == '\0')
+      ? STDIN_FILENO
+      : nointr_open(input, O_RDONLY, 0);
+    if (fd == -1)
+        return MCDB_ERROR_READ;
+    pid = mcdbctl_make_decompress(&fd, bufsz);
+    if (pid == 0 && fd != STDIN_FILENO) {
+        (void) nointr_close(fd);
+        return mcdb_makefmt_fileintofile_opts(input,fname,malloc,free,&opts);
+    }
+    if (pid == -1) {
+        if (fd != STDIN_FILENO)
+            (void) nointr_close(fd);
+        return MCDB_ERROR_READ;
+    }
+
+    /* (mcdb is not committed until decompressor exits successfully) */
+    rv = (buf = malloc(bufsz)) == NULL
+      ? MCDB_ERROR_MALLOC
+      : mcdb_makefn_start(&m, fname, malloc, free) == 0
+        ? mcdb_makefmt_fdintofd_opts(fd, buf, bufsz, m.fd,
+                                     malloc, free, &opts)
+        : (errno == ENOMEM ? MCDB_ERROR_MALLOC : MCDB_ERROR_WRITE);
+    if (pid > 0) {
+        (void) nointr_close(fd); /*(decompressor exits if input not consumed)*/
+        if (!mcdbctl_make_reap(pid)) {
+            errno = EIO;
+            rv = MCDB_ERROR_READ;
+        }
+    }
+    if (buf != NULL) {
+        if (rv == EXIT_SUCCESS)
+            rv = mcdb_makefn_finish(&m, true) == 0
+              ? EXIT_SUCCESS
+              : MCDB_ERROR_WRITE;
+        mcdb_makefn_cleanup(&m);
+        free(buf);
+    }
     return rv;
 }
 
@@ -443,7 +1024,8 @@ mcdbctl_has_unique_keys(struct mcdb * const restrict m)
          * pointers, but is inconsequential since it is all read-only */
         k = (char *)mcdb_iter_keyptr(&iter);
         if (mcdb_find(m, k, mcdb_iter_keylen(&iter))) {
-            if (mcdb_findnext(m, k, mcdb_iter_keylen(&iter)))
+            if (mcdb_dataptr(m) != mcdb_iter_dataptr(&iter)  /*(mph index)*/
+                || mcdb_findnext(m, k, mcdb_iter_keylen(&iter)))
                 return false; /*keys not unique; bail on first dup encountered*/
         }
         else
@@ -467,12 +1049,25 @@ mcdbctl_make_unique_keys(struct mcdb * const restrict m, const bool first)
     unsigned char *mark = mcdb_madv_initmark(m->map->ptr, m->map->size,
                                              MCDB_HEADER_SZ);
     uint32_t dlen;
+    uint64_t fbits;
     int rv = EXIT_SUCCESS;
     posix_madvise(m->map->ptr, m->map->size, POSIX_MADV_WILLNEED);
     if (!mcdb_validate_slots(m))
         return MCDB_ERROR_READFORMAT;
+    /* preserve filter (approx same filter bits per key) if filter in input */
+    fbits = m->map->filter_n != 0 && mcdb_numrecs(m) != 0
+      ? ((uint64_t)m->map->filter_n << 9) / mcdb_numrecs(m)
+      : 0;
+    if (fbits > 64)
+        fbits = 64;
     if (mcdb_makefn_start(&mk, m->map->fname, malloc, free) == 0
-        && mcdb_make_start(&mk, mk.fd, malloc, free) == 0) {
+        && mcdb_make_start(&mk, mk.fd, malloc, free) == 0
+        && (m->map->mph == NULL
+            || mcdb_make_index(&mk, MCDB_INDEX_MPH) == 0)
+        && (m->map->hash_id == MCDB_HASH_CUSTOM /*(else same hash as input)*/
+            || mcdb_make_hash(&mk, m->map->hash_id, m->map->hash_init) == 0)
+        && mcdb_make_filter(&mk, (uint32_t)fbits) == 0
+        && mcdb_make_sparse(&mk, m->map->sparse_sz) == 0) {
         mcdb_iter_init(&iter, m);
         while (mcdb_iter(&iter) && rv == EXIT_SUCCESS) {
             /* Technically, passing m (which contains m->map->ptr) and an
@@ -542,7 +1137,10 @@ mcdbctl_uniq(const int argc, char ** const restrict argv)
     if (m.map == NULL)
         return MCDB_ERROR_READ;
 
-    rv = mcdbctl_has_unique_keys(&m);
+    /* mph index contains only first record for each key; "last" unavailable */
+    rv = (m.map->mph == NULL || first)
+      ? mcdbctl_has_unique_keys(&m)
+      : MCDB_ERROR_USAGE;
     if (rv == true)
         rv = EXIT_SUCCESS;
     else if (rv == false)
@@ -552,19 +1150,533 @@ mcdbctl_uniq(const int argc, char ** const restrict argv)
     return rv;
 }
 
+/* mcdbctl bench: lookup throughput and latency
+ *
+ * Keys are sampled from mcdb (-k <keys>, default 100000; all keys if fewer)
+ * by selection sampling and copied, each followed by mcdbctl_bench_miss[], so
+ * that a miss is synthesized by lookup of sampled key with suffix (a
+ * synthesized key which is in mcdb counts as a hit).  Each of -j <threads>
+ * threads (default 1) looks up -n <lookups> (default 1000000) keys chosen at
+ * random (-s <seed>), fraction -m <ratio> (0.0 to 1.0, default 0) of which
+ * are misses, using its own struct mcdb on the shared map.  Each lookup is
+ * timed from end of previous (clock_gettime(CLOCK_MONOTONIC)), so latency
+ * includes key selection and timer overhead (timer overhead is reported).
+ * Latencies are counted in a log-linear histogram (64 sub-buckets for each
+ * power of 2 nsec; values within 1/64) and reported as a percentile
+ * distribution in the format of HdrHistogram outputPercentileDistribution().
+ * -a <advice> is applied to mcdb map before run (mcdb_mmap_madvise()):
+ *   normal, random, sequential, willneed (default), dontneed, or
+ *   cold (mcdb is dropped from page cache (POSIX_FADV_DONTNEED) after keys are
+ *         sampled, so pages are read from disk during run) */
+
+#define MCDBCTL_HIST_SUB 64                       /* sub-buckets per 2^n */
+#define MCDBCTL_HIST_SZ  (MCDBCTL_HIST_SUB * 35)  /* up to 2^40 nsec */
+#define MCDBCTL_BENCH_COLD (-1)
+
+static const char mcdbctl_bench_miss[4] = { '\xff', 'm', 'i', 's' };
+
+struct mcdbctl_bench_keys {
+  char *buf;                  /* key, suffix, key, suffix, ... */
+  size_t *off;                /* offset of each key in buf; off[n] is end */
+  size_t n;
+};
+
+#ifdef _THREAD_SAFE
+struct mcdbctl_bench_gate {   /* threads start together */
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int go;
+};
+#endif
+
+struct mcdbctl_bench_part {
+  struct mcdb m;              /* (per thread struct mcdb for queries) */
+  const struct mcdbctl_bench_keys *keys;
+ #ifdef _THREAD_SAFE
+  struct mcdbctl_bench_gate *gate;
+ #endif
+  uint64_t rand;              /* xorshift64* state */
+  uint64_t miss;              /* miss if low 32 bits of rand below this */
+  unsigned long n;
+  unsigned long nhit;
+  unsigned long nmiss;
+  uint64_t nsec;
+  uint64_t hist[MCDBCTL_HIST_SZ];
+};
+
+static inline uint64_t
+mcdbctl_bench_rand(uint64_t * const restrict x)
+{
+    *x ^= *x >> 12;
+    *x ^= *x << 25;
+    *x ^= *x >> 27;
+    return *x * UINT64_C(2685821657736338717);
+}
+
+static inline uint64_t
+mcdbctl_bench_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t
+mcdbctl_hist_idx(uint64_t v)
+{
+    uint32_t e = 6;
+    if (v < MCDBCTL_HIST_SUB)
+        return (uint32_t)v;
+    if (v >= ((uint64_t)1 << 40))
+        v = ((uint64_t)1 << 40) - 1;
+  #ifdef __GNUC__
+    e = 63 - (uint32_t)__builtin_clzll((unsigned long long)v);
+  #else
+    while ((v >> e) > 1) ++e;
+  #endif
+    return MCDBCTL_HIST_SUB * (e - 5) + (uint32_t)(v >> (e - 6))
+         - MCDBCTL_HIST_SUB;
+}
+
+/* highest value counted in histogram bucket */
+static uint64_t
+mcdbctl_hist_val(const uint32_t i)
+{
+    const uint32_t e = i / MCDBCTL_HIST_SUB + 5;
+    return (i < MCDBCTL_HIST_SUB)
+      ? i
+      : ((uint64_t)(MCDBCTL_HIST_SUB + i % MCDBCTL_HIST_SUB + 1) << (e - 6))-1;
+}
+
+/* value at percentile (0.0 to 100.0) */
+__attribute_nonnull__()
+static uint64_t
+mcdbctl_hist_pct(const uint64_t * const restrict hist, const uint64_t total,
+                 const double pct);
+
+static uint64_t
+mcdbctl_hist_pct(const uint64_t * const restrict hist, const uint64_t total,
+                 const double pct)
+{
+    uint64_t cum = 0;
+    uint32_t i;
+    for (i = 0; i < MCDBCTL_HIST_SZ; ++i) {
+        if ((cum += hist[i]) != 0 && (double)cum * 100.0 >= pct*(double)total)
+            return mcdbctl_hist_val(i);
+    }
+    return 0;
+}
+
+/* (avoid libm for one sqrt(); x > 0) */
+static double
+mcdbctl_sqrt(const double x)
+{
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 64; ++i)
+        r = (r + x / r) * 0.5;
+    return r;
+}
+
+/* percentile distribution (HdrHistogram outputPercentileDistribution() format
+ * with 5 percentile reporting ticks per half distance; values in usec) */
+__attribute_nonnull__()
+static void
+mcdbctl_hist_print(const uint64_t * const restrict hist, const uint64_t total);
+
+static void
+mcdbctl_hist_print(const uint64_t * const restrict hist, const uint64_t total)
+{
+    double level = 0.0;  /* percentile (0.0 to 100.0) to report next */
+    double sum = 0.0;
+    double sumsq = 0.0;
+    double mean;
+    double v;
+    uint64_t cum = 0;
+    uint64_t max = 0;
+    uint32_t i;
+    uint32_t h;
+    printf("%12s %14s %10s %14s\n\n",
+           "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    for (i = 0; i < MCDBCTL_HIST_SZ; ++i) {
+        if (hist[i] == 0)
+            continue;
+        cum += hist[i];
+        max = mcdbctl_hist_val(i);
+        v = (double)max / 1000.0;
+        sum += v * (double)hist[i];
+        sumsq += v * v * (double)hist[i];
+        while ((double)cum * 100.0 >= level * (double)total
+               && (cum != total || 100.0 / (100.0 - level) < (double)total)) {
+            printf("%12.3f %2.12f %10llu %14.2f\n", v, level / 100.0,
+                   (unsigned long long)cum, 100.0 / (100.0 - level));
+            for (h = 0; (double)(2u << h) <= 100.0 / (100.0 - level); ++h)
+                ;  /* h = floor(log2(1/(1-percentile))) */
+            level += 100.0 / (5.0 * (double)(2u << h));
+        }
+    }
+    mean = total != 0 ? sum / (double)total : 0.0;
+    printf("%12.3f %2.12f %10llu\n", (double)max / 1000.0, 1.0,
+           (unsigned long long)cum);
+    printf("#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean,
+           total != 0 && sumsq / (double)total > mean * mean
+             ? mcdbctl_sqrt(sumsq / (double)total - mean * mean)
+             : 0.0);
+    printf("#[Max     = %12.3f, Total count    = %12llu]\n",
+           (double)max / 1000.0, (unsigned long long)total);
+    printf("#[Buckets = %12u, SubBuckets     = %12u]\n",
+           (unsigned int)(MCDBCTL_HIST_SZ / MCDBCTL_HIST_SUB),
+           (unsigned int)MCDBCTL_HIST_SUB);
+}
+
+static void *
+mcdbctl_bench_thread(void * const arg)
+{
+    struct mcdbctl_bench_part * const restrict p = arg;
+    const struct mcdbctl_bench_keys * const restrict keys = p->keys;
+    const uint64_t miss = p->miss;
+    uint64_t r;
+    uint64_t t;
+    uint64_t t0;
+    uint64_t t1;
+    unsigned long i;
+    size_t k;
+    size_t klen;
+
+  #ifdef _THREAD_SAFE
+    if (p->gate != NULL) {
+        pthread_mutex_lock(&p->gate->mutex);
+        while (!p->gate->go)
+            pthread_cond_wait(&p->gate->cond, &p->gate->mutex);
+        pthread_mutex_unlock(&p->gate->mutex);
+    }
+  #endif
+
+    t0 = t = mcdbctl_bench_nsec();
+    for (i = 0; i < p->n; ++i) {
+        r = mcdbctl_bench_rand(&p->rand);
+        k = (size_t)(((r >> 32) * (uint64_t)keys->n) >> 32);
+        klen = keys->off[k+1] - keys->off[k];
+        if ((r & 0xFFFFFFFFu) >= miss)
+            klen -= sizeof(mcdbctl_bench_miss);
+        if (mcdb_find(&p->m, keys->buf + keys->off[k], klen))
+            ++p->nhit;
+        else
+            ++p->nmiss;
+        t1 = mcdbctl_bench_nsec();
+        ++p->hist[mcdbctl_hist_idx(t1 - t)];
+        t = t1;
+    }
+    p->nsec = t - t0;
+    return NULL;
+}
+
+/* sample up to k keys of mcdb into keys (selection sampling: Knuth, TAOCP
+ * Vol 2, Algorithm S); returns number of records in mcdb.
+ * (mcdb without records: one empty key, so that all lookups are misses) */
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdbctl_bench_sample(struct mcdb * const restrict m,
+                     struct mcdbctl_bench_keys * const restrict keys,
+                     size_t k, uint64_t r, size_t * const restrict nrec);
+
+static int
+mcdbctl_bench_sample(struct mcdb * const restrict m,
+                     struct mcdbctl_bench_keys * const restrict keys,
+                     size_t k, uint64_t r, size_t * const restrict nrec)
+{
+    struct mcdb_iter iter;
+    char *buf;
+    size_t n = 0;
+    size_t seen = 0;
+    size_t len = 0;
+    size_t sz = 65536;
+    size_t klen;
+
+    mcdb_iter_init(&iter, m);
+    while (mcdb_iter(&iter))
+        ++n;
+    *nrec = n;
+    if (k > n)
+        k = n;
+    keys->n = 0;
+    keys->off = malloc(((k != 0 ? k : 1) + 1) * sizeof(size_t));
+    keys->buf = malloc(sz);
+    if (keys->off == NULL || keys->buf == NULL)
+        return MCDB_ERROR_MALLOC;
+
+    mcdb_iter_init(&iter, m);
+    while (keys->n < k && mcdb_iter(&iter)) {
+        if ((((mcdbctl_bench_rand(&r) >> 32) * (uint64_t)(n - seen++)) >> 32)
+            >= k - keys->n)
+            continue;
+        klen = mcdb_iter_keylen(&iter);
+        if (len + klen + sizeof(mcdbctl_bench_miss) > sz) {
+            do { sz <<= 1; } while (len+klen+sizeof(mcdbctl_bench_miss) > sz);
+            if ((buf = realloc(keys->buf, sz)) == NULL)
+                return MCDB_ERROR_MALLOC;
+            keys->buf = buf;
+        }
+        keys->off[keys->n++] = len;
+        memcpy(keys->buf + len, mcdb_iter_keyptr(&iter), klen);
+        len += klen;
+        memcpy(keys->buf + len, mcdbctl_bench_miss, sizeof(mcdbctl_bench_miss));
+        len += sizeof(mcdbctl_bench_miss);
+    }
+    if (keys->n == 0) {
+        memcpy(keys->buf, mcdbctl_bench_miss, sizeof(mcdbctl_bench_miss));
+        keys->off[keys->n++] = 0;
+        len = sizeof(mcdbctl_bench_miss);
+    }
+    keys->off[keys->n] = len;
+    return EXIT_SUCCESS;
+}
+
+__attribute_nonnull__()
+__attribute_warn_unused_result__
+static int
+mcdbctl_bench(const int argc, char ** const restrict argv);
+
+static int
+mcdbctl_bench(const int argc, char ** const restrict argv)
+{
+    /* assert(argc >= 3); */                   /* must be checked by caller */
+    /* assert(0 == strcmp(argv[1], "bench")); *//*must be checked by caller */
+    struct mcdb m;
+    struct mcdb_mmap map;
+    struct mcdbctl_bench_keys keys = { NULL, NULL, 0 };
+    struct mcdbctl_bench_part * restrict st;
+    char *endptr;
+    unsigned long u;
+    uint64_t seed = 1;
+    uint64_t total;
+    uint64_t nsec = 0;
+    uint64_t tovh = ~(uint64_t)0;
+    uint64_t t;
+    size_t nkeys = 100000;
+    size_t nrec;
+    double miss = 0.0;
+    unsigned long n = 1000000;
+    uint32_t nthreads = 1;
+    uint32_t i;
+    uint32_t j;
+    int advice = MCDB_MADV_WILLNEED;
+    int fd;
+    int rv;
+  #ifdef _THREAD_SAFE
+    pthread_t tids[256];
+    struct mcdbctl_bench_gate gate;
+  #endif
+
+    /* options: -j <threads> -n <lookups per thread> -k <keys to sample>
+     *          -m <miss ratio> (0.0 to 1.0) -s <seed>
+     *          -a <advice> (normal|random|sequential|willneed|dontneed|cold)*/
+    while ((rv = getopt(argc-1, argv+1, "a:j:k:m:n:s:")) != -1) {
+        switch (rv) {
+          case 'a':
+            if (0 == strcmp(optarg, "normal"))
+                advice = MCDB_MADV_NORMAL;
+            else if (0 == strcmp(optarg, "random"))
+                advice = MCDB_MADV_RANDOM;
+            else if (0 == strcmp(optarg, "sequential"))
+                advice = MCDB_MADV_SEQUENTIAL;
+            else if (0 == strcmp(optarg, "willneed"))
+                advice = MCDB_MADV_WILLNEED;
+            else if (0 == strcmp(optarg, "dontneed"))
+                advice = MCDB_MADV_DONTNEED;
+            else if (0 == strcmp(optarg, "cold"))
+                advice = MCDBCTL_BENCH_COLD;
+            else
+                return MCDB_ERROR_USAGE;
+            break;
+          case 'j':
+            u = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || u == 0 || u > 256)
+                return MCDB_ERROR_USAGE;
+            nthreads = (uint32_t)u;
+            break;
+          case 'k':
+            u = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || u == 0
+                || u > (SIZE_MAX / sizeof(size_t)) - 1)
+                return MCDB_ERROR_USAGE;
+            nkeys = (size_t)u;
+            break;
+          case 'm':
+            miss = strtod(optarg, &endptr);
+            if (optarg == endptr || *endptr != '\0'
+                || !(miss >= 0.0 && miss <= 1.0))
+                return MCDB_ERROR_USAGE;
+            break;
+          case 'n':
+            u = strtoul(optarg, &endptr, 10);
+            if (optarg == endptr || *endptr != '\0' || u == ULONG_MAX)
+                return MCDB_ERROR_USAGE;
+            n = u;
+            break;
+          case 's':
+            u = strtoul(optarg, &endptr, 0);
+            if (optarg == endptr || *endptr != '\0')
+                return MCDB_ERROR_USAGE;
+            seed = (uint64_t)u;
+            break;
+          default:
+            return MCDB_ERROR_USAGE;
+        }
+    }
+    if (argc-1 - optind != 1)
+        return MCDB_ERROR_USAGE;
+  #ifndef _THREAD_SAFE
+    nthreads = 1;
+  #endif
+    seed = (seed + 1) * UINT64_C(0x9E3779B97F4A7C15); /*(xorshift state != 0)*/
+
+    /* open mcdb; sample keys */
+    fd = nointr_open(argv[1+optind], O_RDONLY, 0);
+    if (fd == -1) return MCDB_ERROR_READ;
+    memset(&map, '\0', sizeof(map));  /*(init fn_free, fname)*/
+    if (!mcdb_mmap_init(&map, fd)) {
+        (void) nointr_close(fd);
+        return MCDB_ERROR_READ;
+    }
+    memset(&m, '\0', sizeof(m));
+    m.map = &map;
+    rv = mcdbctl_bench_sample(&m, &keys, nkeys, seed, &nrec);
+    if (rv == EXIT_SUCCESS && advice == MCDBCTL_BENCH_COLD) {
+        /* remap after drop from page cache (mapped pages are not dropped) */
+        mcdb_mmap_free(&map);
+      #ifdef POSIX_FADV_DONTNEED
+        (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      #endif
+        memset(&map, '\0', sizeof(map));
+        if (!mcdb_mmap_init(&map, fd))
+            rv = MCDB_ERROR_READ;
+    }
+    else if (rv == EXIT_SUCCESS)
+        mcdb_mmap_madvise(&map, advice);
+    (void) nointr_close(fd);
+    st = (rv == EXIT_SUCCESS)
+      ? calloc(nthreads, sizeof(struct mcdbctl_bench_part))
+      : NULL;
+    if (st == NULL) {
+        mcdb_mmap_free(&map);
+        free(keys.off);
+        free(keys.buf);
+        return rv == EXIT_SUCCESS ? MCDB_ERROR_MALLOC : rv;
+    }
+    if (nrec == 0)
+        miss = 1.0;
+
+    for (i = 0; i < nthreads; ++i) {
+        st[i].m.map = &map;
+        st[i].keys  = &keys;
+        st[i].rand  = seed ^ ((uint64_t)(i + 1) * UINT64_C(0xD1B54A32D192ED03));
+        st[i].miss  = (uint64_t)(miss * 4294967296.0);
+        st[i].n     = n;
+      #ifdef _THREAD_SAFE
+        st[i].gate  = &gate;
+      #endif
+    }
+
+    /* timer overhead (min of consecutive reads) */
+    for (i = 0; i < 1000; ++i) {
+        t = mcdbctl_bench_nsec();
+        t = mcdbctl_bench_nsec() - t;
+        if (tovh > t)
+            tovh = t;
+    }
+
+  #ifdef _THREAD_SAFE
+    gate.go = 0;
+    if (pthread_mutex_init(&gate.mutex, NULL) != 0
+        || pthread_cond_init(&gate.cond, NULL) != 0) {
+        for (i = 0; i < nthreads; ++i)
+            st[i].gate = NULL;
+    }
+    for (i = 1; i < nthreads; ++i) {
+        if (pthread_create(tids+i, NULL, mcdbctl_bench_thread, st+i) != 0)
+            break;
+    }
+    if (st[0].gate != NULL) {
+        pthread_mutex_lock(&gate.mutex);
+        gate.go = 1;
+        pthread_cond_broadcast(&gate.cond);
+        pthread_mutex_unlock(&gate.mutex);
+    }
+    for (j = i; j < nthreads; ++j)  /*(run in current thread if create fails)*/
+        mcdbctl_bench_thread(st+j);
+    mcdbctl_bench_thread(st);
+    while (--i)
+        pthread_join(tids[i], NULL);
+    if (st[0].gate != NULL) {
+        pthread_cond_destroy(&gate.cond);
+        pthread_mutex_destroy(&gate.mutex);
+    }
+  #else
+    mcdbctl_bench_thread(st);
+  #endif
+
+    for (i = 0; i < nthreads; ++i) {
+        if (nsec < st[i].nsec)
+            nsec = st[i].nsec;
+        if (i == 0)
+            continue;
+        st[0].nhit  += st[i].nhit;
+        st[0].nmiss += st[i].nmiss;
+        for (j = 0; j < MCDBCTL_HIST_SZ; ++j)
+            st[0].hist[j] += st[i].hist[j];
+    }
+    total = (uint64_t)st[0].nhit + st[0].nmiss;
+
+    printf("records %lu\n", (unsigned long)nrec);
+    printf("keys    %lu\n", (unsigned long)(nrec != 0 ? keys.n : 0));
+    printf("threads %u\n", nthreads);
+    printf("lookups %llu\n", (unsigned long long)total);
+    printf("hits    %lu\n", st[0].nhit);
+    printf("misses  %lu\n", st[0].nmiss);
+    printf("seconds %.3f\n", (double)nsec / 1e9);
+    printf("lookups/sec %.0f\n",
+           nsec != 0 ? (double)total * 1e9 / (double)nsec : 0.0);
+    printf("timer overhead usec %.3f\n", (double)tovh / 1000.0);
+    printf("latency usec p50 %.3f p99 %.3f p999 %.3f\n\n",
+           (double)mcdbctl_hist_pct(st[0].hist, total, 50.0) / 1000.0,
+           (double)mcdbctl_hist_pct(st[0].hist, total, 99.0) / 1000.0,
+           (double)mcdbctl_hist_pct(st[0].hist, total, 99.9) / 1000.0);
+    mcdbctl_hist_print(st[0].hist, total);
+
+    free(st);
+    mcdb_mmap_free(&map);
+    free(keys.off);
+    free(keys.buf);
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : MCDB_ERROR_WRITE;
+}
+
 static const char * const restrict mcdb_usage =
-   "mcdbctl make  <fname.mcdb> <datafile|->\n"
+   "mcdbctl make  [-h djb|xxh32] [-s seed] [-b bits] [-i hash|mph]\n"
+   "                       [-o bytes] [-j threads] [-m bytes] [-c]\n"
+   "                       [-u first|last|reject] [-a]\n"
+   "                       [-f cdb|tsv|jsonl|bin] [-r bytes]\n"
+   "                       <fname.mcdb> <datafile|->\n"
    "         mcdbctl uniq  <fname.mcdb> [\"first\"|\"last\"]\n"
-   "         mcdbctl dump  <fname.mcdb>\n"
+   "         mcdbctl dump  <fname.mcdb> [\"bin\"]\n"
    "         mcdbctl stats <fname.mcdb>\n"
-   "         mcdbctl get   <fname.mcdb> <key> [seq|\"all\"]\n";
+   "         mcdbctl get   <fname.mcdb> <key> [seq|\"all\"]\n"
+   "         mcdbctl bench [-j threads] [-n lookups] [-k keys] [-m ratio]\n"
+   "                       [-s seed] [-a normal|random|sequential|willneed|\n"
+   "                                     dontneed|cold] <fname.mcdb>\n";
 
 /*
  * mcdbctl get   <mcdb> <key> [seq|"all"]
- * mcdbctl dump  <mcdb>
+ * mcdbctl dump  <mcdb> ["bin"]
  * mcdbctl stats <mcdb>
- * mcdbctl make  <mcdb> <input-file>
+ * mcdbctl make  [-h djb|xxh32] [-s seed] [-b bits] [-i hash|mph]
+ *               [-o bytes] [-j threads] [-m bytes] [-c]
+ *               [-u first|last|reject] [-a] [-f cdb|tsv|jsonl|bin]
+ *               [-r bytes] <mcdb> <input-file>
+ *   (input-file or stdin compressed with gzip or zstd is decompressed)
  * mcdbctl uniq  <mcdb> ["first"|"last"]
+ * mcdbctl bench [-j threads] [-n lookups] [-k keys] [-m ratio] [-s seed]
+ *               [-a normal|random|sequential|willneed|dontneed|cold] <mcdb>
  *
  * mcdbctl tools require mcdb filename be specified on the command line.
  * djb cdb tools take cdb on stdin, since able to mmap stdin backed by file.
@@ -573,10 +1685,12 @@ int
 main(int argc, char ** const restrict argv)
 {
     int rv;
-    if (argc == 4 && 0 == strcmp(argv[1], "make"))
+    if (argc >= 4 && 0 == strcmp(argv[1], "make"))
         rv = mcdbctl_make(argc, argv);
     else if ((argc == 3 || argc == 4) && 0 == strcmp(argv[1], "uniq"))
         rv = mcdbctl_uniq(argc, argv);
+    else if (argc >= 3 && 0 == strcmp(argv[1], "bench"))
+        rv = mcdbctl_bench(argc, argv);
     else
         rv = mcdbctl_query(argc, argv);
 
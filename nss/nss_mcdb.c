@@ -92,6 +92,15 @@ static const char
 
 #define _nss_num_dbs NSS_DBTYPE_SENTINEL
 
+/* (optional) build with -DNSS_MCDB_INOTIFY to watch databases with inotify
+ * (helper thread per database opened) instead of stat() per lookup
+ * (see MCDB_MMAP_INOTIFY in mcdb.h; falls back to stat() if unavailable) */
+#ifdef NSS_MCDB_INOTIFY
+#define NSS_MCDB_MMAP_FLAGS MCDB_MMAP_INOTIFY
+#else
+#define NSS_MCDB_MMAP_FLAGS 0
+#endif
+
 static struct mcdb_mmap _nss_mcdb_mmap_st[_nss_num_dbs];
 static struct mcdb_mmap *_nss_mcdb_mmap[_nss_num_dbs];
 
@@ -154,8 +163,10 @@ _nss_mcdb_db_openshared(const enum nss_dbtype dbtype)
      * use static storage for initial struct mcdb_mmap for each dbtype
      * to avoid malloc allocation in short-lived programs, and to maintain
      * a reference to maps to keep them available. */
-    if ((rc = (NULL != mcdb_mmap_create_h(map, NULL, _nss_dbnames[dbtype],
-                                          malloc, free)))) {
+    if ((rc = (NULL != mcdb_mmap_create_flags_h(map, NULL,
+                                                _nss_dbnames[dbtype],
+                                                malloc, free,
+                                                NSS_MCDB_MMAP_FLAGS)))) {
         plasma_membar_StoreStore();
         _nss_mcdb_mmap[dbtype] = map;
     }
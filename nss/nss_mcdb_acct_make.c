@@ -465,7 +465,7 @@ nss_mcdb_acct_make_passwd_encode(
     w->tagc = 'x';
     w->klen = sizeof(uint32_t);
     w->key  = (const char *)&n;
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -499,7 +499,7 @@ nss_mcdb_acct_make_group_encode(
     w->tagc = 'x';
     w->klen = sizeof(uint32_t);
     w->key  = (const char *)&n;
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
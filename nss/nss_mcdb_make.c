@@ -144,6 +144,23 @@ nss_mcdb_make_mcdbctl_write(struct nss_mcdb_make_winfo * const restrict w)
     return false;
 }
 
+/* write alias record into mcdb to data of record most recently written
+ * (data of entry is stored once for all keys of entry; see mcdb_make.h)
+ * (only if w->alias; else, and if key longer than buffer, record is written
+ *  with copy of data, so that mcdb is readable by readers without alias
+ *  record support) */
+bool
+nss_mcdb_make_mcdbctl_write_alias(struct nss_mcdb_make_winfo * const restrict w)
+{
+    char key[256];
+    if (w->alias && w->klen < sizeof(key)) {
+        key[0] = w->tagc;
+        memcpy(key+1, w->key, w->klen);
+        return (mcdb_make_add_alias_h(w->wbuf.m, key, w->klen+1) == 0);
+    }
+    return nss_mcdb_make_mcdbctl_write(w);
+}
+
 
 bool
 nss_mcdb_make_dbfile( struct nss_mcdb_make_winfo * const restrict w,
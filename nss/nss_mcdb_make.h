@@ -46,6 +46,7 @@ struct nss_mcdb_make_winfo {
   const char * restrict key;
   size_t klen;
   char tagc;
+  bool alias;  /* write alias records (MCDB_FEATURE_ALIAS); see mcdb.h */
 };
 
 
@@ -59,6 +60,10 @@ __attribute_nonnull__()
 bool
 nss_mcdb_make_mcdbctl_write(struct nss_mcdb_make_winfo * restrict);
 
+__attribute_nonnull__()
+bool
+nss_mcdb_make_mcdbctl_write_alias(struct nss_mcdb_make_winfo * restrict);
+
 __attribute_nonnull__()
 bool
 nss_mcdb_make_dbfile( struct nss_mcdb_make_winfo * restrict,
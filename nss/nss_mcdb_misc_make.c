@@ -150,7 +150,7 @@ nss_mcdb_misc_make_ether_addr_encode(
     w->tagc = 'b';  /* binary */
     w->klen = sizeof(struct ether_addr);
     w->key  = (char *)ea;
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -330,14 +330,14 @@ nss_mcdb_netdb_make_hostent_encode(
         return false;
 
     w->tagc = '~';
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     for (i = 0; he->h_aliases[i] != NULL; ++i) {
         w->tagc = '~';
         w->klen = strlen(he->h_aliases[i]);
         w->key  = he->h_aliases[i];
-        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
             return false;
     }
 
@@ -345,7 +345,7 @@ nss_mcdb_netdb_make_hostent_encode(
     w->tagc = 'b';  /* binary */
     w->klen = (uint32_t)he->h_length;
     w->key  = he->h_addr_list[0];
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -376,14 +376,14 @@ nss_mcdb_netdb_make_netent_encode(
         return false;
 
     w->tagc = '~';
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     for (i = 0; ne->n_aliases[i] != NULL; ++i) {
         w->tagc = '~';
         w->klen = strlen(ne->n_aliases[i]);
         w->key  = ne->n_aliases[i];
-        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
             return false;
     }
 
@@ -396,7 +396,7 @@ nss_mcdb_netdb_make_netent_encode(
     n[0] = *(uint32_t *)ne->n_addr;
   #endif
     n[1] = htonl((uint32_t) ne->n_addrtype);
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -423,21 +423,21 @@ nss_mcdb_netdb_make_protoent_encode(
         return false;
 
     w->tagc = '~';
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     for (i = 0; pe->p_aliases[i] != NULL; ++i) {
         w->tagc = '~';
         w->klen = strlen(pe->p_aliases[i]);
         w->key  = pe->p_aliases[i];
-        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
             return false;
     }
 
     w->tagc = 'x';
     w->klen = sizeof(uint32_t);
     w->key  = (const char *)&n;
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -464,21 +464,21 @@ nss_mcdb_netdb_make_rpcent_encode(
         return false;
 
     w->tagc = '~';
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     for (i = 0; re->r_aliases[i] != NULL; ++i) {
         w->tagc = '~';
         w->klen = strlen(re->r_aliases[i]);
         w->key  = re->r_aliases[i];
-        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
             return false;
     }
 
     w->tagc = 'x';
     w->klen = sizeof(uint32_t);
     w->key  = (const char *)&n;
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -505,21 +505,21 @@ nss_mcdb_netdb_make_servent_encode(
         return false;
 
     w->tagc = '~';
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     for (i = 0; se->s_aliases[i] != NULL; ++i) {
         w->tagc = '~';
         w->klen = strlen(se->s_aliases[i]);
         w->key  = se->s_aliases[i];
-        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+        if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
             return false;
     }
 
     w->tagc = 'x';
     w->klen = sizeof(uint32_t);
     w->key  = (const char *)&n;
-    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write(w), 0))
+    if (__builtin_expect( !nss_mcdb_make_mcdbctl_write_alias(w), 0))
         return false;
 
     return true;
@@ -68,7 +68,15 @@
 /* Note: blank line is required to denote end of mcdb input 
  * Ensure blank line is written after w.wbuf is flushed. */
 
-int main(void)
+/* nss_mcdbctl [-a]
+ *   -a  write alias records: data of entry is stored once for all keys of
+ *       entry (e.g. hosts by name, aliases and address).  mcdb is then
+ *       flagged MCDB_FEATURE_ALIAS; libnss_mcdb (and other mcdb readers)
+ *       resolve alias records on lookup only if built with alias record
+ *       support, so use -a only once every process which may load mcdb
+ *       (e.g. nscd, sshd) has a reader with alias record support.
+ *       (default: each key is written with copy of data) */
+int main(int argc, char *argv[])
 {
     enum { DBUFSZ =   4096  /*   4 KB */ };
 
@@ -172,6 +180,14 @@ int main(void)
       (stat("/etc/nsswitch.conf", &st) == 0) ? st.st_mtime : 0;
     bool rc = false;
 
+    if (argc == 2 && 0 == strcmp(argv[1], "-a"))
+        w.alias = true;
+    else if (argc != 1) {
+        fprintf(stderr, "usage: nss_mcdbctl [-a]\n");
+        free(w.data);
+        return -1;
+    }
+
     if (w.data == NULL) {
         free(w.data);
         return -1;
@@ -208,6 +208,21 @@ echo '--- mcdbmake handles absurd klen'
 echo '+4294967210' | mcdbmake test.mcdb - 2>/dev/null
 rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
 
+echo '--- mcdbmake handles leading zeros and bad separators'
+printf '+000000003,000000000005:one->Hello\n+3,5:two->world\n\n' \
+| mcdbmake test.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one`" = "Hello" ] || echo 1>&2 "FAIL one"
+for p in '+3;5:' '+3,5;' '+,5:' '+3,:' '+3,5' '3,5:' '+0000000003,5:'; do
+  printf '%sone->Hello\n+3,5:two->world\n+3,5:six->seven\n\n' "$p" \
+  | mcdbmake test.mcdb - 2>/dev/null
+  rc=$?
+  case "$p" in
+    +0000000003,5:) [ $rc -eq 0 ]   || echo 1>&2 "FAIL $p $rc" ;;
+    *)              [ $rc -eq 111 ] || echo 1>&2 "FAIL $p $rc" ;;
+  esac
+done
+
 echo '--- mcdbget handles empty file'
 touch empty.mcdb
 mcdbget empty.mcdb foo 2>/dev/null
@@ -230,6 +245,386 @@ echo '--- mcdbstats handles random.mcdb'
 mcdbstats random.mcdb >/dev/null
 rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
 
+echo '--- mcdbmake -h xxh32 and mcdbdump handle random.mcdb'
+mcdbctl make -h xxh32 -s 12345 random.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbdump random.mcdb > random.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp ../random.in random.dump >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbtest random.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbmake -h xxh32 and mcdbget handle repeated keys'
+echo '+3,5:one->Hello
++3,7:one->Goodbye
++3,5:two->Hello
+' | mcdbctl make -h xxh32 test.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one 1`" = "Goodbye" ] || echo 1>&2 "FAIL"
+mcdbctl uniq test.mcdb last
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one`" = "Goodbye" ] || echo 1>&2 "FAIL"
+[ "`mcdbget test.mcdb two`" = "Hello" ] || echo 1>&2 "FAIL"
+
+echo '--- mcdbmake -b 10 and mcdbdump handle random.mcdb with filter'
+mcdbctl make -b 10 random.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbdump random.mcdb > random.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp ../random.in random.dump >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbtest random.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbget handles filter'
+echo '+3,5:one->Hello
++3,7:one->Goodbye
++3,5:two->Hello
+' | mcdbctl make -b 10 test.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one 1`" = "Goodbye" ] || echo 1>&2 "FAIL"
+mcdbget test.mcdb three
+rc=$?; [ $rc -eq 100 ] || echo 1>&2 "FAIL $rc"
+mcdbctl uniq test.mcdb first
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one`" = "Hello" ] || echo 1>&2 "FAIL"
+[ "`mcdbget test.mcdb two`" = "Hello" ] || echo 1>&2 "FAIL"
+
+echo '--- mcdbmake rejects unknown hash'
+echo '' | mcdbctl make -h nohash test.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbmake -i mph and mcdbdump handle random.mcdb with mph index'
+mcdbctl make -i mph -b 10 random.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbdump random.mcdb > random.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp ../random.in random.dump >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbtest random.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbmake -o and mcdbdump handle random.mcdb with sparse index'
+mcdbctl make -o 64 -b 10 random.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbdump random.mcdb > random.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp ../random.in random.dump >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbtest random.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbstats random.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbmake -j builds same mcdb as single-threaded build'
+mcdbctl make -j 1 -b 10 random.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -j 4 -b 10 random4.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp random.mcdb random4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbmake -j parses large input file in chunks in order'
+# (records in data of every other record are false chunk boundaries)
+perl -e 'for (0..39999) { my $d = $_ & 1 ? "v" x ($_ % 200)
+                            : "+3,5:abc->hello\n" x ($_ % 9);
+                          printf "+%d,%d:k%d->%s\n", 1+length($_ % 9000),
+                                 length($d), $_ % 9000, $d; }
+         print "\n+3,5:abc->ended\n"' > chunks.in
+mcdbctl make -j 1 chunks1.mcdb chunks.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -j 4 chunks4.mcdb chunks.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp chunks1.mcdb chunks4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -j 1 -u last chunks1.mcdb chunks.in
+mcdbctl make -j 3 -u last chunks4.mcdb chunks.in
+cmp chunks1.mcdb chunks4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+sed '30000s/^+/#/' chunks.in > chunks.bad
+mcdbctl make -j 4 chunks4.mcdb chunks.bad 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+rm -f chunks.in chunks.bad chunks1.mcdb chunks4.mcdb
+
+echo '--- mcdbmake -m spill builds same mcdb as in-memory build'
+mcdbctl make -m 1 -b 10 random4.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp random.mcdb random4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+echo '' | mcdbctl make -m 1 -i mph test.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbmake partitioned hash table fill matches direct fill'
+# (MCDB_FILL_PART_MIN=0 partitions every slot table; with -m 1, slots with
+#  entries in spill file (more than one hplist) are partitioned through file)
+# (order within overflow run crossing window might differ; compare records)
+perl -e 'printf "+6,6:%06d->%06d\n", $_, $_ for 0..99999; print "\n"' > fill.in
+mcdbctl make -j 1 fill.mcdb fill.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbdump fill.mcdb > fill1.dump
+for opts in '-j 1' '-j 1 -m 1' '-j 4 -m 1'; do
+  MCDB_FILL_PART_MIN=0 mcdbctl make $opts fill.mcdb fill.in
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+  mcdbtest fill.mcdb
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+  mcdbdump fill.mcdb > fill2.dump
+  cmp fill1.dump fill2.dump >/dev/null
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+done
+MCDB_FILL_PART_MIN=0 mcdbctl make -m 1 -b 10 random4.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbtest random4.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbdump random4.mcdb`" = "`mcdbdump random.mcdb`" ] || echo 1>&2 "FAIL"
+rm -f fill.in fill.mcdb fill1.dump fill2.dump
+
+echo '--- mcdbmake -u first|last|reject applies duplicate key policy'
+printf '+3,5:one->Hello\n+3,7:one->Goodbye\n+3,5:two->Hello\n+3,3:one->Bye\n\n' \
+  > dup.in
+mcdbctl make -u first test.mcdb dup.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one`" = "Hello" ] || echo 1>&2 "FAIL"
+mcdbget test.mcdb one 1 >/dev/null
+rc=$?; [ $rc -eq 100 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbdump test.mcdb`" = "`printf '+3,5:one->Hello\n+3,5:two->Hello\n'`" ] \
+  || echo 1>&2 "FAIL"
+mcdbctl make -u last test.mcdb dup.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbdump test.mcdb`" = "`printf '+3,5:two->Hello\n+3,3:one->Bye\n'`" ] \
+  || echo 1>&2 "FAIL"
+mcdbctl make -u reject test.mcdb dup.in 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -u reject -m 1 -b 10 random4.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp random.mcdb random4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -u first -i mph test.mcdb dup.in 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+# (-m 1: hp entries of 100000 records spilled; superseded records compacted
+#  and spilled entries rebased in spill file)
+perl -e 'printf "+6,%d:%06d->%s\n", length($_), $_ % 70000, $_ for 0..99999;
+         print "\n"' > dup.in
+for u in first last; do
+  mcdbctl make -u $u test.mcdb dup.in
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+  mcdbdump test.mcdb > dup1.dump
+  mcdbctl make -u $u -m 1 test.mcdb dup.in
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+  mcdbtest test.mcdb
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+  mcdbdump test.mcdb > dup2.dump
+  cmp dup1.dump dup2.dump >/dev/null
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+done
+[ "`mcdbget test.mcdb 000001`" = "70001" ] || echo 1>&2 "FAIL"
+mcdbctl make -u reject -m 1 test.mcdb dup.in 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+rm -f dup.in dup1.dump dup2.dump
+
+echo '--- mcdbmake -a aliases records with same data as prior record'
+d='forty bytes of data; forty bytes of data'
+printf "+3,40:one->$d\n+3,40:two->$d\n+5,40:three->$d\n+4,4:four->tiny\n+4,4:five->tiny\n+3,40:six->$d\n\n" \
+  > alias.in
+mcdbctl make -a test.mcdb alias.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make test4.mcdb alias.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ `wc -c < test.mcdb` -lt `wc -c < test4.mcdb` ] || echo 1>&2 "FAIL"
+[ "`mcdbdump test.mcdb`" = "`mcdbdump test4.mcdb`" ] || echo 1>&2 "FAIL"
+[ "`mcdbget test.mcdb three`" = "$d" ] || echo 1>&2 "FAIL"
+[ "`mcdbget test.mcdb five`" = "tiny" ] || echo 1>&2 "FAIL"
+mcdbtest test.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -a -u first test.mcdb alias.in 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -a -b 10 random4.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp random.mcdb random4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+rm -f alias.in
+
+echo '--- mcdbmake -f tsv|jsonl reads tab-separated and JSON-lines input'
+printf '+3,5:one->Hello\n+6,8:t\tab\\x->line\none\n+5,0:empty->\n+3,7:123->{"a":1}\n+2,6:u8->\303\251\360\237\230\200\n\n' \
+  > fmt.in
+printf 'one\tHello\nt\\tab\\\\x\tline\\none\nempty\t\n123\t{"a":1}\nu8\t\303\251\360\237\230\200\n' \
+  > fmt.tsv
+printf '{"k":"one","v":"Hello"}\n{ "v":"line\\none", "k":"t\\tab\\\\x" }\n{"k":"empty","x":[1,"}"],"v":""}\n{"k":123,"v":{"a":1}}\n{"k":"u8","v":"\\u00e9\\ud83d\\ude00"}\n' \
+  > fmt.jsonl
+mcdbctl make fmt.mcdb fmt.in
+mcdbctl dump fmt.mcdb > fmt.dump
+mcdbctl make -f tsv fmt.mcdb fmt.tsv
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl dump fmt.mcdb | cmp - fmt.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -f tsv fmt.mcdb - < fmt.tsv
+mcdbctl dump fmt.mcdb | cmp - fmt.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -f jsonl fmt.mcdb fmt.jsonl
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl dump fmt.mcdb | cmp - fmt.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+printf 'no tab\n' | mcdbctl make -f tsv fmt.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+printf 'a\\q\tb\n' | mcdbctl make -f tsv fmt.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+printf '{"k":"a"}\n' | mcdbctl make -f jsonl fmt.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+printf '{"k":"a","v":"\\ud800"}\n' \
+  | mcdbctl make -f jsonl fmt.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -f xml fmt.mcdb fmt.in 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+rm -f fmt.in fmt.tsv fmt.jsonl fmt.dump fmt.mcdb
+
+echo '--- mcdbmake -f bin and mcdbctl dump bin (length-prefixed binary)'
+printf '+3,5:one->Hello\n+3,3:two->Bye\n+1,0:x->\n+0,2:->\000\n\n\n' > b.in
+mcdbctl make b.mcdb b.in
+mcdbctl dump b.mcdb > b.dump
+mcdbctl dump b.mcdb bin > b.bin
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+printf 'mcdbbin1\003\000\000\000\005\000\000\000oneHello' > b.cmp
+printf '\003\000\000\000\003\000\000\000twoBye' >> b.cmp
+printf '\001\000\000\000\000\000\000\000x' >> b.cmp
+printf '\000\000\000\000\002\000\000\000\000\n' >> b.cmp
+printf '\377\377\377\377\377\377\377\377' >> b.cmp
+cmp b.bin b.cmp
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make b.mcdb b.bin
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl dump b.mcdb | cmp - b.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cat b.bin | mcdbctl make -f bin -r 4096 b.mcdb -
+mcdbctl dump b.mcdb | cmp - b.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+head -c 30 b.bin | mcdbctl make b.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -f bin b.mcdb b.in 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+mcdbctl dump b.mcdb txt >/dev/null 2>&1
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+rm -f b.in b.dump b.bin b.cmp b.mcdb
+
+echo '--- mcdbmake decompresses gzip or zstd input (file or stdin)'
+printf '+3,5:one->Hello\n+3,3:two->Bye\n+1,0:x->\n\n' > z.in
+mcdbctl make z.mcdb z.in
+mcdbctl dump z.mcdb > z.dump
+gzip -c z.in > z.in.gz
+mcdbctl make z.mcdb z.in.gz
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl dump z.mcdb | cmp - z.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl make -r 4096 z.mcdb - < z.in.gz
+mcdbctl dump z.mcdb | cmp - z.dump
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+if command -v zstd >/dev/null 2>&1; then
+  zstd -qc z.in > z.in.zst
+  mcdbctl make z.mcdb z.in.zst
+  mcdbctl dump z.mcdb | cmp - z.dump
+  rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+fi
+rm -f z.mcdb
+head -c 20 z.in.gz > z.in.gz.trunc
+mcdbctl make z.mcdb z.in.gz.trunc 2>/dev/null
+rc=$?; [ $rc -eq 111 ] || echo 1>&2 "FAIL $rc"
+[ ! -f z.mcdb ] || echo 1>&2 "FAIL mcdb created from truncated input"
+mcdbctl make -r 100 z.mcdb z.in 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+rm -f z.in z.in.gz z.in.zst z.in.gz.trunc z.dump z.mcdb
+
+echo '--- mcdbctl bench reports lookups, hits, misses and latency percentiles'
+printf '+3,5:one->Hello\n+3,3:two->Bye\n+1,0:x->\n\n' > bench.in
+mcdbctl make bench.mcdb bench.in
+mcdbctl bench -n 1000 -j 2 -m 0.5 -a cold bench.mcdb > bench.out
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+grep -q '^lookups 2000$' bench.out
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+grep -q '^latency usec p50 .* p99 .* p999 ' bench.out
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+grep -q '^#\[Max     = .*, Total count    = *2000\]$' bench.out
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl bench -n 1000 -m 0 bench.mcdb | grep -q '^hits    1000$'
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl bench -n 1000 -m 1 bench.mcdb | grep -q '^misses  1000$'
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl bench -m 1.5 bench.mcdb 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+rm -f bench.in bench.mcdb bench.out
+
+echo '--- mcdbmake -c (drop from page cache) builds same mcdb'
+mcdbctl make -c -b 10 random4.mcdb - < ../random.in
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp random.mcdb random4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+
+echo '--- mcdbget handles mph index (first record for key)'
+echo '+3,5:one->Hello
++3,7:one->Goodbye
++3,5:two->Hello
+' | mcdbctl make -i mph test.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test.mcdb one`" = "Hello" ] || echo 1>&2 "FAIL"
+mcdbget test.mcdb one 1
+rc=$?; [ $rc -eq 100 ] || echo 1>&2 "FAIL $rc"
+mcdbget test.mcdb three
+rc=$?; [ $rc -eq 100 ] || echo 1>&2 "FAIL $rc"
+mcdbtest test.mcdb
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+mcdbctl uniq test.mcdb last 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+mcdbctl uniq test.mcdb first
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbctl stats test.mcdb | tail -1`" = "unindexed 0" ] || echo 1>&2 "FAIL"
+[ "`mcdbget test.mcdb two`" = "Hello" ] || echo 1>&2 "FAIL"
+
+echo '--- mcdbmake rejects mph index with djb hash'
+echo '' | mcdbctl make -i mph -h djb test.mcdb - 2>/dev/null
+rc=$?; [ $rc -eq 101 ] || echo 1>&2 "FAIL $rc"
+
+
+echo '--- testmcdbmake per-thread handles build same mcdb as single handle'
+testmcdbmake test.mcdb 10000
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+testmcdbmake test4.mcdb 10000 4
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+cmp test.mcdb test4.mcdb >/dev/null
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+[ "`mcdbget test4.mcdb 00009999`" = "00009999" ] || echo 1>&2 "FAIL"
+
+echo '--- testmcdburing finds same records as mcdb_find()'
+echo '+8,3:00000001->one
++8,300:00000002->'"`printf '%300s' x`"'
++8,0:00000003->
+' | mcdbctl make -b 10 test.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+printf '0000000100000002000000030000000400000002' > test.keys
+r0="`testmcdburing test.mcdb test.keys 0 | cut -d' ' -f3-8`"
+r4="`testmcdburing test.mcdb test.keys 4 2>/dev/null | cut -d' ' -f3-8`"
+[ "$r0" = "lookups 5 found 4 dsum 603" ] || echo 1>&2 "FAIL"
+# (io_uring might be unavailable, e.g. in container or on other platforms)
+[ -z "$r4" ] || [ "$r4" = "$r0" ] || echo 1>&2 "FAIL"
+echo '+8,300:00000001->'"`printf '%300s' x`"'
++8,300:00000002->'"`printf '%300s' x`"'
+' | mcdbctl make -a test.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+r0="`testmcdburing test.mcdb test.keys 0 | cut -d' ' -f3-8`"
+r4="`testmcdburing test.mcdb test.keys 4 2>/dev/null | cut -d' ' -f3-8`"
+[ "$r0" = "lookups 5 found 3 dsum 900" ] || echo 1>&2 "FAIL"
+[ -z "$r4" ] || [ "$r4" = "$r0" ] || echo 1>&2 "FAIL"
+
+
+echo '--- testmcdbfork child of fork() sees mcdb replaced after fork'
+echo '+3,3:one->old
+' | mcdbctl make fork.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+echo '+3,3:one->new
+' | mcdbctl make forknew.mcdb -
+rc=$?; [ $rc -eq 0 ] || echo 1>&2 "FAIL $rc"
+# (mtime differs; inotify helper thread of parent is not present in child)
+touch -t 200001010000 forknew.mcdb
+[ "`testmcdbfork fork.mcdb forknew.mcdb one | tr '\n' ' '`" \
+  = "parent old child new " ] || echo 1>&2 "FAIL"
+
 
 echo '--- testzero works'
 testzero 5 test.mcdb
@@ -0,0 +1,170 @@
+/*
+ * testmcdbcache - page cache residency of a served mcdb during concurrent build
+ *
+ * Copyright (c) 2026, Glue Logic LLC. All rights reserved. code()gluelogic.com
+ *
+ *  This file is part of mcdb.
+ *
+ *  mcdb is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mcdb is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with mcdb.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: testmcdbcache <mcdb> <keys> <seconds>
+ *   keys     input file of keys of constant len 8 (as for testmcdbrand)
+ *   seconds  query keys (repeatedly, in order) for seconds
+ * mcdb is read into page cache (prefault) before test.  Run alongside a build
+ * of another mcdb (e.g. mcdbctl make [-c]) to observe eviction of mcdb being
+ * served.  Prints each second: lookups/sec, major page faults/sec (page cache
+ * misses of mcdb) and percentage of mcdb pages resident (mincore()) */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+/* _BSD_SOURCE or _DEFAULT_SOURCE needed for mincore() on Linux */
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+/* large file support needed for open() input file > 2 GB */
+#define PLASMA_FEATURE_ENABLE_LARGEFILE
+#include "plasma/plasma_feature.h"
+
+#include "mcdb.h"
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double
+testmcdbcache_now (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long
+testmcdbcache_majflt (void)
+{
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_majflt : 0;
+}
+
+/* percentage of pages of map resident in page cache */
+static double
+testmcdbcache_resident (void * const ptr, const size_t sz,
+                        unsigned char * const vec)
+{
+    const size_t pgsz = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t n = (sz + pgsz - 1) / pgsz;
+    size_t i;
+    size_t r = 0;
+    if (mincore(ptr, sz, (void *)vec) != 0) return -1.0;
+    for (i = 0; i < n; ++i)
+        r += vec[i] & 1;
+    return n != 0 ? 100.0 * (double)r / (double)n : 100.0;
+}
+
+int main (int argc, char *argv[])
+{
+    struct mcdb m;
+    const char *keys;
+    const char *p;
+    const char *end;
+    unsigned char *vec;
+    struct stat st;
+    double t, tnext, tend;
+    size_t nkeys;
+    size_t found = 0;
+    unsigned long long n = 0, nprev = 0;
+    unsigned long long ntotal = 0;
+    long majflt, majprev;
+    long majtotal = 0;
+    unsigned int sec = 0;
+    int fd;
+    const unsigned int klen = 8;
+
+    if (argc < 4) return -1;
+    tend = (double)strtoul(argv[3], NULL, 10);
+
+    /* open mcdb and read into page cache */
+    memset(&m, '\0', sizeof(m));
+    m.map = mcdb_mmap_create(NULL, NULL, argv[1], malloc, free);
+    if (m.map == NULL)                              {perror("mcdb"); return -1;}
+    mcdb_mmap_prefault(m.map);
+    vec = malloc(m.map->size / (size_t)sysconf(_SC_PAGESIZE) + 1);
+    if (vec == NULL)                               {perror("malloc");return -1;}
+
+    /* open input file */
+    if ((fd = open(argv[2], O_RDONLY, 0777)) == -1) {perror("open"); return -1;}
+    if (fstat(fd, &st) != 0)                        {perror("fstat");return -1;}
+  #if !defined(_LP64) && !defined(__LP64__)
+    if (st.st_size > (off_t)SIZE_MAX)  {errno=EFBIG; perror("input");return -1;}
+  #endif
+    keys = (const char *)mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+                              fd, 0);
+    if (keys == MAP_FAILED)                         {perror("mmap"); return -1;}
+    close(fd);
+    nkeys = (size_t)st.st_size / klen;
+    if (nkeys == 0)                                 return -1;
+    end = keys + nkeys * klen;
+    p = keys;
+
+    printf("sec lookups/sec majflt/sec resident%%\n");
+    printf("%3u %11s %10s %8.1f\n", sec, "-", "-",
+           testmcdbcache_resident(m.map->ptr, (size_t)m.map->size, vec));
+    fflush(stdout);
+    majprev = testmcdbcache_majflt();
+    t = testmcdbcache_now();
+    tend += t;
+    tnext = t + 1.0;
+    for (;;) {
+        /* (check time every 1024 lookups) */
+        for (unsigned int i = 0; i < 1024; ++i, ++n) {
+            found += mcdb_find(&m, p, klen);
+            if ((p += klen) == end) p = keys;
+        }
+        if ((t = testmcdbcache_now()) < tnext) continue;
+        majflt = testmcdbcache_majflt();
+        printf("%3u %11.0f %10ld %8.1f\n", ++sec, (double)(n - nprev),
+               majflt - majprev,
+               testmcdbcache_resident(m.map->ptr, (size_t)m.map->size, vec));
+        fflush(stdout);
+        ntotal += n - nprev;
+        majtotal += majflt - majprev;
+        nprev = n;
+        majprev = majflt;
+        tnext += 1.0;
+        if (t >= tend) break;
+    }
+    printf("total lookups %llu found %zu majflt %ld "
+           "(lookups without major fault approx %.2f%%)\n",
+           ntotal, found, majtotal,
+           ntotal != 0 ? 100.0 - 100.0 * (double)majtotal / (double)ntotal
+                       : 100.0);
+
+    mcdb_mmap_destroy(m.map);
+    free(vec);
+    return 0;
+}
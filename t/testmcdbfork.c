@@ -0,0 +1,88 @@
+/*
+ * testmcdbfork - refresh check in child of fork() of map watched by inotify
+ *
+ * Copyright (c) 2026, Glue Logic LLC. All rights reserved. code()gluelogic.com
+ *
+ *  This file is part of mcdb.
+ *
+ *  mcdb is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mcdb is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with mcdb.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: testmcdbfork <mcdb> <new mcdb> <key>
+ *   opens mcdb with MCDB_MMAP_INOTIFY and prints data of key, then forks;
+ *   child renames new mcdb into place, refreshes map and prints data of key.
+ *   (new mcdb should have mtime which differs from that of mcdb, since child
+ *    checks with stat(); helper thread of parent is not present in child)
+ * prints "parent <data>" and "child <data>"; exit status is that of child */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "mcdb.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int
+testmcdbfork_get (struct mcdb_mmap ** const mapptr, const char * const key,
+                  const char * const who)
+{
+    struct mcdb m;
+    memset(&m, '\0', sizeof(m));
+    if (!mcdb_mmap_refresh_threadsafe(mapptr))      {perror("mcdb"); return 1;}
+    m.map = mcdb_mmap_thread_registration(mapptr, MCDB_REGISTER_USE_INCR);
+    if (m.map == NULL)                              {perror("mcdb"); return 1;}
+    if (mcdb_find(&m, key, strlen(key)))
+        printf("%s %.*s\n", who, (int)mcdb_datalen(&m),
+               (char *)mcdb_dataptr(&m));
+    else
+        printf("%s (not found)\n", who);
+    fflush(stdout);
+    (void)mcdb_mmap_thread_registration(&m.map, MCDB_REGISTER_USE_DECR);
+    return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+    struct mcdb_mmap *map;
+    pid_t pid;
+    int status;
+
+    if (argc != 4) {
+        fprintf(stderr, "usage: testmcdbfork <mcdb> <new mcdb> <key>\n");
+        return 1;
+    }
+    map = mcdb_mmap_create_flags(NULL, NULL, argv[1], malloc, free,
+                                 MCDB_MMAP_INOTIFY);
+    if (map == NULL)                                {perror("mcdb"); return 1;}
+    if (testmcdbfork_get(&map, argv[3], "parent") != 0)
+        return 1;
+
+    pid = fork();
+    if (pid == -1)                                  {perror("fork"); return 1;}
+    if (pid == 0) {
+        if (rename(argv[2], argv[1]) != 0)          {perror("rename");_exit(1);}
+        _exit(testmcdbfork_get(&map, argv[3], "child"));
+    }
+    if (waitpid(pid, &status, 0) != pid)           {perror("waitpid");return 1;}
+
+    mcdb_mmap_destroy(map);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
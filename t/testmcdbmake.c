@@ -30,10 +30,37 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>     /* open() */
+#include <pthread.h>   /* pthread_create(), pthread_join() */
 #include <stdio.h>     /* snprintf() */
-#include <stdlib.h>    /* malloc(), free(), strtoul() */
-#include <string.h>    /* memset() */
-#include <unistd.h>    /* close() */
+#include <stdlib.h>    /* malloc(), free(), strtoul(), mkstemp() */
+#include <string.h>    /* memset(), strlen(), memcpy() */
+#include <unistd.h>    /* close(), unlink() */
+
+/* usage: testmcdbmake <mcdb> <nrecs> [nthreads]
+ *   nthreads  generate records in threads, each adding to a per-thread handle
+ *             (mcdb_make_thread_start()), merged in order; mcdb is identical */
+
+struct testmcdbmake_part {
+    struct mcdb_make h;
+    unsigned long b;
+    unsigned long e;
+    int rc;
+};
+
+static void *
+testmcdbmake_thread (void *arg)
+{
+    struct testmcdbmake_part * const part = (struct testmcdbmake_part *)arg;
+    char buf[24];
+    unsigned long u = part->b;
+    while (u < part->e) {
+        snprintf(buf, sizeof(buf), "%08lu", u);              /*generate record*/
+        if (0 != mcdb_make_add(&part->h,buf,8,buf,8)) break;   /*store record*/
+        ++u;
+    }
+    part->rc = (u == part->e) ? 0 : -1;
+    return NULL;
+}
 
 int
 main (int argc, char **argv)
@@ -41,17 +68,70 @@ main (int argc, char **argv)
     char buf[16];
     unsigned long u = 0;
     unsigned long e;
+    unsigned long n = 0;
+    unsigned long i;
     struct mcdb_make m;
     int fd;
     if (argc < 3) return -1;
     e = strtoul(argv[2], NULL, 10);
     if (e > 100000000u) return -1;  /*(only 8 decimal chars below; can change)*/
+    if (argc > 3 && ((n = strtoul(argv[3], NULL, 10)) == 0 || n > 256))
+        return -1;
     unlink(argv[1]);   /* unlink for repeatable test; ignore error if missing */
     if ((fd = open(argv[1],O_RDWR|O_CREAT,0666)) != -1
         && mcdb_make_start(&m,fd,malloc,free) == 0) {
-        /* generate and store records (generate 8-byte key and use as value)  */
-        do { snprintf(buf, sizeof(buf), "%08lu", u);         /*generate record*/
-        } while (0 == mcdb_make_add(&m,buf,8,buf,8) && ++u < e);/*store record*/
+        if (n == 0) {
+            /* generate and store records (generate 8-byte key, use as value)*/
+            do { snprintf(buf, sizeof(buf), "%08lu", u);     /*generate record*/
+            } while (0 == mcdb_make_add(&m,buf,8,buf,8) && ++u < e);
+        }                                                      /*store record*/
+        else {
+            /* each thread generates a contiguous range of records */
+            struct testmcdbmake_part *parts = malloc(n * sizeof(*parts));
+            pthread_t *tids = malloc(n * sizeof(pthread_t));
+            size_t len = strlen(argv[1]);
+            char *tmp = malloc(len + sizeof(".XXXXXX"));
+            unsigned long t = 0;  /* num threads started */
+            if (parts != NULL && tids != NULL && tmp != NULL) {
+                memcpy(tmp, argv[1], len);
+                for (; t < n; ++t) {
+                    int tfd;
+                    memcpy(tmp+len, ".XXXXXX", sizeof(".XXXXXX"));
+                    if ((tfd = mkstemp(tmp)) == -1) break;
+                    unlink(tmp);
+                    parts[t].b = e * t / n;
+                    parts[t].e = e * (t+1) / n;
+                    if (mcdb_make_thread_start(&parts[t].h, &m, tfd) != 0) {
+                        close(tfd);
+                        break;
+                    }
+                    if (pthread_create(tids+t, NULL,
+                                       testmcdbmake_thread, parts+t) != 0) {
+                        mcdb_make_destroy(&parts[t].h);
+                        close(tfd);
+                        break;
+                    }
+                }
+            }
+            if (t != n) u = ~0UL; /* !e */
+            /* join all started threads; merge in order until a failure,
+             * then destroy remaining handles (no-op if merge destroyed h) */
+            for (i = 0; i < t; ++i) {
+                const int tfd = parts[i].h.fd;
+                pthread_join(tids[i], NULL);
+                if (u != ~0UL && parts[i].rc == 0
+                    && mcdb_make_thread_merge(&m, &parts[i].h) == 0)
+                    u = parts[i].e;
+                else {
+                    mcdb_make_destroy(&parts[i].h);
+                    u = ~0UL; /* !e */
+                }
+                close(tfd);
+            }
+            free(tmp);
+            free(tids);
+            free(parts);
+        }
     } else e = 1; /* !u */
     return (u == e && mcdb_make_finish(&m) == 0 && close(fd) == 0)
       ? 0
@@ -39,6 +39,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -52,12 +53,19 @@ int main (int argc, char *argv[])
     int fd;
     const unsigned int klen = 8;
     /* input stream must have keys of constant len 8 */
+    /* optional 3rd arg: num keys per mcdb_findbatch() (0 for mcdb_find()) */
+    /* optional 4th arg: mcdb_mmap load flags (1: MCDB_MMAP_HUGEPAGE_INDEX) */
+    struct mcdb_batch q[256];
+    size_t nq = 0;
+    size_t i;
 
     if (argc < 3) return -1;
+    if (argc > 3 && (nq = strtoul(argv[3], NULL, 10)) > 256) return -1;
 
     /* open mcdb */
     if ((fd = open(argv[1], O_RDONLY, 0777)) == -1) {perror("open"); return -1;}
     memset(&map, '\0', sizeof(map));
+    if (argc > 4) map.flags = (uint32_t)strtoul(argv[4], NULL, 0);
     if (!mcdb_mmap_init(&map, fd))                  {perror("mcdb"); return -1;}
     close(fd);
     memset(&m, '\0', sizeof(m));
@@ -76,7 +84,20 @@ int main (int argc, char *argv[])
 
     /* read each key from input mmap and query mcdb
      * (no error checking since key might not exist) */
-    for (end = p+st.st_size; p < end; p += klen)
-        fd = mcdb_find(&m, p, klen); /*(reuse fd; avoid unused result warning)*/
+    end = p+st.st_size;
+    if (nq == 0) {
+        for (; p < end; p += klen)
+            fd = mcdb_find(&m, p, klen); /*(reuse fd; avoid unused result)*/
+    }
+    else {
+        while (p < end) {
+            for (i = 0; i < nq && p + klen <= end; ++i, p += klen) {
+                q[i].key  = p;
+                q[i].klen = klen;
+            }
+            if (i == 0) break;
+            (void)mcdb_findbatch(&m, q, i);
+        }
+    }
     return 0;
 }
@@ -0,0 +1,225 @@
+/*
+ * testmcdbthreads - multi-threaded test of mcdb reader registration overhead
+ *
+ * Copyright (c) 2026, Glue Logic LLC. All rights reserved. code()gluelogic.com
+ *
+ *  This file is part of mcdb.
+ *
+ *  mcdb is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mcdb is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with mcdb.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: testmcdbthreads <mcdb> <keys> <nthreads> [mode [reopen_ms]]
+ *   keys     input file of keys of constant len 8 (as for testmcdbrand)
+ *   nthreads each thread queries every key in keys file
+ *   mode     epoch:  mcdb_thread_epoch_register() once per thread, then
+ *                    mcdb_thread_refresh_self() before each query (default)
+ *            refcnt: mcdb_mmap_thread_registration() incr/decr shared map
+ *                    around each query
+ *            check:  refcnt, plus mcdb_mmap_refresh_threadsafe() before each
+ *                    query (stat() per query, as in nss_mcdb.c)
+ *            inotify: check, with map created with MCDB_MMAP_INOTIFY
+ *   reopen_ms main thread replaces map (mcdb_mmap_reopen_threadsafe())
+ *             every reopen_ms milliseconds while readers run (default 0: off)
+ * prints lookups/sec summed over all threads */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+#ifndef _XOPEN_SOURCE /* IOV_MAX */
+#define _XOPEN_SOURCE 600
+#endif
+
+/* large file support needed for open() input file > 2 GB */
+#define PLASMA_FEATURE_ENABLE_LARGEFILE
+#include "plasma/plasma_feature.h"
+
+#include "mcdb.h"
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static struct mcdb_mmap *map;
+static const char *keys;
+static size_t keys_sz;
+static int mode_refcnt;
+static int mode_check;
+static pthread_mutex_t nfinished_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int nfinished;
+static const unsigned int klen = 8;
+
+static void
+testmcdbthreads_finished (void)
+{
+    pthread_mutex_lock(&nfinished_mutex);
+    ++nfinished;
+    pthread_mutex_unlock(&nfinished_mutex);
+}
+
+static void *
+testmcdbthreads_epoch (void *arg)
+{
+    struct mcdb m;
+    const char *p = keys;
+    const char * const end = keys + keys_sz;
+    size_t found = 0;
+    memset(&m, '\0', sizeof(m));
+    m.map = map;
+    if (mcdb_thread_epoch_register(&m) == NULL)     {perror("mcdb"); exit(1);}
+    for (; p < end; p += klen) {
+        if (!mcdb_thread_refresh_self(&m))          {perror("mcdb"); exit(1);}
+        found += mcdb_find(&m, p, klen);
+    }
+    (void)mcdb_thread_epoch_unregister(&m);
+    *(size_t *)arg = found;
+    testmcdbthreads_finished();
+    return NULL;
+}
+
+static void *
+testmcdbthreads_refcnt (void *arg)
+{
+    struct mcdb m;
+    const char *p = keys;
+    const char * const end = keys + keys_sz;
+    size_t found = 0;
+    memset(&m, '\0', sizeof(m));
+    for (; p < end; p += klen) {
+        if (mode_check)
+            (void)mcdb_mmap_refresh_threadsafe(&map);
+        m.map = mcdb_mmap_thread_registration(&map, MCDB_REGISTER_USE_INCR);
+        if (m.map == NULL)                          {perror("mcdb"); exit(1);}
+        found += mcdb_find(&m, p, klen);
+        (void)mcdb_mmap_thread_registration(&m.map, MCDB_REGISTER_USE_DECR);
+    }
+    *(size_t *)arg = found;
+    testmcdbthreads_finished();
+    return NULL;
+}
+
+static double
+testmcdbthreads_now (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char *argv[])
+{
+    pthread_t *tids;
+    size_t *found;
+    struct stat st;
+    struct timespec ts;
+    double t;
+    unsigned long reopen_ms = 0;
+    unsigned long reopens = 0;
+    uint32_t flags = 0;
+    unsigned int nthreads;
+    unsigned int i;
+    int fd;
+
+    if (argc < 4) return -1;
+    if ((nthreads = (unsigned int)strtoul(argv[3], NULL, 10)) == 0) return -1;
+    if (argc > 4) {
+        if (0 == strcmp(argv[4], "refcnt"))
+            mode_refcnt = 1;
+        else if (0 == strcmp(argv[4], "check"))
+            mode_refcnt = mode_check = 1;
+        else if (0 == strcmp(argv[4], "inotify")) {
+            mode_refcnt = mode_check = 1;
+            flags = MCDB_MMAP_INOTIFY;
+        }
+        else if (0 != strcmp(argv[4], "epoch"))
+            return -1;
+    }
+    if (argc > 5) reopen_ms = strtoul(argv[5], NULL, 10);
+
+    /* open mcdb */
+    map = mcdb_mmap_create_flags(NULL, NULL, argv[1], malloc, free, flags);
+    if (map == NULL)                                {perror("mcdb"); return -1;}
+    mcdb_mmap_prefault(map);
+
+    /* open input file */
+    if ((fd = open(argv[2], O_RDONLY, 0777)) == -1) {perror("open"); return -1;}
+    if (fstat(fd, &st) != 0)                        {perror("fstat");return -1;}
+  #if !defined(_LP64) && !defined(__LP64__)
+    if (st.st_size > (off_t)SIZE_MAX)  {errno=EFBIG; perror("input");return -1;}
+  #endif
+    keys_sz = (size_t)st.st_size / klen * klen;
+    keys = (const char *)mmap(0, keys_sz, PROT_READ, MAP_SHARED, fd, 0);
+    if (keys == MAP_FAILED)                         {perror("mmap"); return -1;}
+    close(fd);
+
+    tids  = malloc(nthreads * sizeof(pthread_t));
+    found = malloc(nthreads * sizeof(size_t));
+    if (tids == NULL || found == NULL)             {perror("malloc");return -1;}
+
+    t = testmcdbthreads_now();
+    for (i = 0; i < nthreads; ++i) {
+        if (pthread_create(tids+i, NULL,
+                           mode_refcnt ? testmcdbthreads_refcnt
+                                       : testmcdbthreads_epoch, found+i) != 0){
+            perror("pthread_create");
+            return -1;
+        }
+    }
+
+    /* replace map while readers run (exercises reclamation of replaced maps)
+     * (map is not modified on disk; mcdb_mmap_reopen_threadsafe() is called
+     *  directly instead of after mcdb_mmap_refresh_check()) */
+    if (reopen_ms) {
+        ts.tv_sec  = (time_t)(reopen_ms / 1000);
+        ts.tv_nsec = (long)(reopen_ms % 1000) * 1000000L;
+        for (;;) {
+            nanosleep(&ts, NULL);
+            pthread_mutex_lock(&nfinished_mutex);
+            i = nfinished;
+            pthread_mutex_unlock(&nfinished_mutex);
+            if (i == nthreads) break;
+            if (!mcdb_mmap_reopen_threadsafe(&map))
+                                                   {perror("reopen");return -1;}
+            ++reopens;
+        }
+    }
+
+    for (i = 0; i < nthreads; ++i)
+        pthread_join(tids[i], NULL);
+    t = testmcdbthreads_now() - t;
+
+    for (i = 1; i < nthreads; ++i) {
+        if (found[i] != found[0]) {
+            fprintf(stderr, "thread %u found %zu != %zu\n",i,found[i],found[0]);
+            return 1;
+        }
+    }
+    printf("%s threads %u lookups %zu found %zu reopens %lu "
+           "sec %.3f lookups/sec %.0f\n",
+           argc > 4 ? argv[4] : "epoch", nthreads,
+           keys_sz / klen * nthreads, found[0], reopens,
+           t, (double)(keys_sz / klen * nthreads) / t);
+
+    mcdb_mmap_destroy(map);
+    free(found);
+    free(tids);
+    return 0;
+}
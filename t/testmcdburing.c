@@ -0,0 +1,165 @@
+/*
+ * testmcdburing - performance test of mcdb_uring lookups vs mmap lookups
+ *
+ * Copyright (c) 2011, Glue Logic LLC. All rights reserved. code()gluelogic.com
+ *
+ *  This file is part of mcdb.
+ *
+ *  mcdb is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mcdb is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with mcdb.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: testmcdburing <mcdb> <keys> [depth [cold]]
+ *   keys   input file of keys of constant len 8 (as for testmcdbrand)
+ *   depth  num lookups in flight with mcdb_uring (default 0: mmap, mcdb_find())
+ *   cold   1: evict mcdb from page cache before test (posix_fadvise() DONTNEED;
+ *             as with 'echo 1 > /proc/sys/vm/drop_caches' for mcdb file only)
+ * prints num found and sum of data lengths (same for all depths) and
+ * lookups/sec */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+#ifndef _XOPEN_SOURCE /* posix_fadvise() */
+#define _XOPEN_SOURCE 600
+#endif
+
+/* large file support needed for open() input file > 2 GB */
+#define PLASMA_FEATURE_ENABLE_LARGEFILE
+#include "plasma/plasma_feature.h"
+
+#include "mcdb.h"
+#include "mcdb_uring.h"
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double
+testmcdburing_now (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char *argv[])
+{
+    const char *p;
+    const char *end;
+    struct stat st;
+    double t;
+    size_t nkeys;
+    size_t found = 0;
+    unsigned long long dsum = 0;
+    unsigned long depth = 0;
+    int fd;
+    const unsigned int klen = 8;
+
+    if (argc < 3) return -1;
+    if (argc > 3) depth = strtoul(argv[3], NULL, 10);
+
+    /* evict mcdb from page cache */
+    if (argc > 4 && argv[4][0] == '1') {
+        if ((fd = open(argv[1], O_RDONLY, 0777)) == -1)
+                                                     {perror("open");return -1;}
+        if ((errno = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED)) != 0)
+                                                  {perror("fadvise");return -1;}
+        close(fd);
+    }
+
+    /* open input file */
+    if ((fd = open(argv[2], O_RDONLY, 0777)) == -1) {perror("open"); return -1;}
+    if (fstat(fd, &st) != 0)                        {perror("fstat");return -1;}
+  #if !defined(_LP64) && !defined(__LP64__)
+    if (st.st_size > (off_t)SIZE_MAX)  {errno=EFBIG; perror("input");return -1;}
+  #endif
+    p = (const char *)mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)                            {perror("mmap"); return -1;}
+    close(fd);
+    posix_madvise((void *)p, (size_t)st.st_size, POSIX_MADV_WILLNEED);
+    nkeys = (size_t)st.st_size / klen;
+    end = p + nkeys * klen;
+
+    if (depth == 0) {
+        struct mcdb m;
+        memset(&m, '\0', sizeof(m));
+        m.map = mcdb_mmap_create(NULL, NULL, argv[1], malloc, free);
+        if (m.map == NULL)                          {perror("mcdb"); return -1;}
+        t = testmcdburing_now();
+        for (; p < end; p += klen) {
+            if (mcdb_find(&m, p, klen)) {
+                ++found;
+                dsum += mcdb_datalen(&m);
+            }
+        }
+        t = testmcdburing_now() - t;
+        mcdb_mmap_destroy(m.map);
+    }
+    else {
+        struct mcdb_uring *u;
+        struct mcdb_uring_req *reqs = calloc(depth, sizeof(*reqs));
+        struct mcdb_uring_req **done = malloc(depth * sizeof(*done));
+        struct mcdb_uring_req **freereqs = malloc(depth * sizeof(*freereqs));
+        unsigned long nfree = depth;
+        unsigned long i;
+        uint32_t n;
+        if (reqs == NULL || done == NULL || freereqs == NULL)
+                                                   {perror("malloc");return -1;}
+        for (i = 0; i < depth; ++i)
+            freereqs[i] = reqs + i;
+        u = mcdb_uring_create(argv[1], (uint32_t)depth, malloc, free);
+        if (u == NULL)                              {perror("mcdb"); return -1;}
+        t = testmcdburing_now();
+        while (p < end || nfree != depth) {
+            for (; nfree != 0 && p < end; p += klen) {
+                struct mcdb_uring_req * const req = freereqs[--nfree];
+                req->key  = p;
+                req->klen = klen;
+                if (mcdb_uring_submit(u, req) != 0) {perror("mcdb"); return -1;}
+            }
+            n = mcdb_uring_complete(u, done, (uint32_t)depth, 1);
+            if (n == 0)                             {perror("mcdb"); return -1;}
+            while (n--) {
+                struct mcdb_uring_req * const req = done[n];
+                if (req->status == MCDB_URING_FOUND) {
+                    ++found;
+                    dsum += req->dlen;
+                }
+                else if (req->status < 0) {
+                    errno = -req->status;           {perror("mcdb"); return -1;}
+                }
+                freereqs[nfree++] = req;
+            }
+        }
+        t = testmcdburing_now() - t;
+        for (i = 0; i < depth; ++i)
+            mcdb_uring_req_free(u, reqs + i);
+        mcdb_uring_destroy(u);
+        free(freereqs);
+        free(done);
+        free(reqs);
+    }
+
+    printf("depth %lu lookups %zu found %zu dsum %llu sec %.3f"
+           " lookups/sec %.0f\n",
+           depth, nkeys, found, dsum, t, (double)nkeys / t);
+    return 0;
+}
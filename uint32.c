@@ -41,6 +41,9 @@ uint32_t uint32_hash_djb(uint32_t, const void * restrict, size_t);
 extern inline
 uint32_t uint32_hash_identity(uint32_t, const void * restrict, size_t);
 uint32_t uint32_hash_identity(uint32_t, const void * restrict, size_t);
+extern inline
+uint32_t uint32_hash_xxh32_key(uint32_t, const void * restrict, size_t);
+uint32_t uint32_hash_xxh32_key(uint32_t, const void * restrict, size_t);
 
 extern inline
 void uint32_to_ascii8uphex(uint32_t, char * restrict);
@@ -64,6 +67,72 @@ uint32_t int32_to_ascii_base10 (int32_t, char * restrict);
 #endif
 
 
+/* xxHash32 (XXH32) hash function by Yann Collet (BSD 2-Clause license)
+ *   https://github.com/Cyan4973/xxHash */
+
+#define UINT32_XXH32_PRIME1 0x9E3779B1u
+#define UINT32_XXH32_PRIME2 0x85EBCA77u
+#define UINT32_XXH32_PRIME3 0xC2B2AE3Du
+#define UINT32_XXH32_PRIME4 0x27D4EB2Fu
+#define UINT32_XXH32_PRIME5 0x165667B1u
+
+#define uint32_rotl(x,r) (((x) << (r)) | ((x) >> (32 - (r))))
+
+/* (compilers optimize to single load (and bswap on big-endian platforms)) */
+#define uint32_strunpack_littleendian(s)                                     \
+  ( ((uint32_t)(s)[0])        | (((uint32_t)(s)[1]) << 8)                    \
+  | (((uint32_t)(s)[2]) << 16)| (((uint32_t)(s)[3]) << 24) )
+
+#define uint32_xxh32_round(acc,s)                                            \
+  ((acc) += uint32_strunpack_littleendian(s) * UINT32_XXH32_PRIME2,          \
+   (acc)  = uint32_rotl((acc), 13),                                          \
+   (acc) *= UINT32_XXH32_PRIME1)
+
+uint32_t
+uint32_hash_xxh32(const uint32_t seed, const void * const restrict vbuf,
+                  const size_t sz)
+{
+    const unsigned char * restrict p = (const unsigned char *)vbuf;
+    const unsigned char * const e = p + sz;
+    uint32_t h;
+
+    if (sz >= 16) {
+        const unsigned char * const limit = e - 16;
+        uint32_t v1 = seed + UINT32_XXH32_PRIME1 + UINT32_XXH32_PRIME2;
+        uint32_t v2 = seed + UINT32_XXH32_PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - UINT32_XXH32_PRIME1;
+        do {
+            uint32_xxh32_round(v1, p);
+            uint32_xxh32_round(v2, p+4);
+            uint32_xxh32_round(v3, p+8);
+            uint32_xxh32_round(v4, p+12);
+        } while ((p += 16) <= limit);
+        h = uint32_rotl(v1, 1)  + uint32_rotl(v2, 7)
+          + uint32_rotl(v3, 12) + uint32_rotl(v4, 18);
+    }
+    else
+        h = seed + UINT32_XXH32_PRIME5;
+
+    h += (uint32_t)sz;
+
+    for (; p + 4 <= e; p += 4) {
+        h += uint32_strunpack_littleendian(p) * UINT32_XXH32_PRIME3;
+        h  = uint32_rotl(h, 17) * UINT32_XXH32_PRIME4;
+    }
+    for (; p < e; ++p) {
+        h += (*p) * UINT32_XXH32_PRIME5;
+        h  = uint32_rotl(h, 11) * UINT32_XXH32_PRIME1;
+    }
+
+    h ^= h >> 15;
+    h *= UINT32_XXH32_PRIME2;
+    h ^= h >> 13;
+    h *= UINT32_XXH32_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
 /* convert string of 8 ASCII hex chars to unsigned 32-bit value
  * (used to convert architecture-independent string data to numerical data)
  * (use when hex chars are known 0..9 A..F a..f) */
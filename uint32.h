@@ -118,6 +118,49 @@ uint32_hash_identity(uint32_t h       __attribute_unused__,
 #endif
 
 
+/* xxHash32 (XXH32) hash function by Yann Collet (BSD 2-Clause license)
+ *   https://github.com/Cyan4973/xxHash
+ * (word-at-a-time; processes 16 bytes per iteration in 4 independent lanes)
+ * (reads input as little-endian 32-bit words on all platforms) */
+
+__attribute_nonnull__()
+__attribute_nothrow__
+__attribute_pure__
+__attribute_warn_unused_result__
+uint32_t
+uint32_hash_xxh32(uint32_t, const void * restrict, size_t);
+PLASMA_ATTR_Pragma_no_side_effect(uint32_hash_xxh32)
+
+/* xxh32 key hash for mcdb (MCDB_HASH_XXH32)
+ * First char of key is folded into seed (h) and remainder of key is hashed
+ * with XXH32, so that key lookup with tag char (tagc + key) hashes to same
+ * value as key stored with leading tag char, without copying tagc + key into
+ * contiguous buffer:  uint32_hash_xxh32(uint32_hash_djb_uchar(h,tagc),key,len)
+ * Unlike uint32_hash_djb(), hash of key cannot be computed incrementally
+ * from partial key buffers. */
+
+__attribute_nonnull__()
+__attribute_nothrow__
+__attribute_pure__
+__attribute_warn_unused_result__
+UINT32_C99INLINE
+uint32_t
+uint32_hash_xxh32_key(uint32_t, const void * restrict, size_t);
+PLASMA_ATTR_Pragma_no_side_effect(uint32_hash_xxh32_key)
+#ifdef UINT32_C99INLINE_FUNCS
+UINT32_C99INLINE
+uint32_t
+uint32_hash_xxh32_key(uint32_t h, const void * const restrict vbuf,
+                      const size_t sz)
+{
+    const unsigned char * const restrict buf = (const unsigned char *)vbuf;
+    return (sz != 0)
+      ? uint32_hash_xxh32(uint32_hash_djb_uchar(h, buf[0]), buf+1, sz-1)
+      : uint32_hash_xxh32(h, buf, 0);
+}
+#endif
+
+
 /* 
  * branchless implementations for comparing two ints and selecting int results
  *